@@ -1,8 +1,12 @@
 #pragma once
 
+#include <atomic>
 #include <functional>
+#include <string>
 #include <utility>
 
+#include <sys/types.h>
+
 #include "Channel.hpp"
 #include "EventLoop.hpp"
 #include "InetAddress.hpp"
@@ -17,29 +21,64 @@
  * Since it's solely for listening, a default ReadCallback (newConnectionCallback) is 
  * provided during construction, which essentially corresponds to the tcpserver's 
  * newConnection method.
+ * 
+ * Accept storms: each readiness event drains up to maxAcceptsPerWakeup_  
+ * pending connections. When the process runs out of descriptors  
+ * (EMFILE/ENFILE) a reserved idle fd is released, the pending connection is  
+ * accepted and closed right away, and the reserve is reopened. The peer sees  
+ * a clean close instead of the listen queue filling up or the process exiting.  
+ * If the reserve cannot be reopened, accepting pauses for kAcceptRetryDelay  
+ * seconds instead of spinning on a listen socket that stays readable.  
+ * 
+ * Unix socket paths: a leftover socket file is only removed when nothing  
+ * accepts on it, and the file this Acceptor bound is removed again when it  
+ * is destroyed.  
  */
 
 class Acceptor : Noncopyable {
 public:
     using NewConnectionCallback = std::function<void(int, const InetAddress&)>;
+    using RejectedAcceptCallback = std::function<void(int)>;   // receives the accept errno
+
+    static constexpr int kDefaultMaxAcceptsPerWakeup = 64;
+    static constexpr double kAcceptRetryDelay = 0.1;
 
     Acceptor(EventLoop* loop, const InetAddress& listenAddr, bool reuseport);
     ~Acceptor() noexcept;
 
     void setNewConnectionCallback(NewConnectionCallback cb) noexcept;
+    void setRejectedAcceptCallback(RejectedAcceptCallback cb) noexcept;
+    void setMaxAcceptsPerWakeup(int n) noexcept { maxAcceptsPerWakeup_ = n > 0 ? n : 1; }
+    [[nodiscard]] uint64_t rejectedAccepts() const noexcept { 
+        return rejectedAccepts_.load(std::memory_order_relaxed); 
+    }
     [[nodiscard]] bool listenning() const noexcept;
+    // The bound address, with the port the kernel chose when bound to port 0
+    [[nodiscard]] InetAddress listenAddress() const;
     void listen();
 
 private:
-    static int createNonblocking();
+    static int createNonblocking(sa_family_t family);
+    static int openIdleFd() noexcept;
+    static void removeStaleSocketFile(const InetAddress& listenAddr);
     void handleRead();
-    void handleAcceptError(int err);
+    bool handleAcceptError(int err);
+    // Returns true when another pending connection can be shed
+    bool shedPendingConnection(int err);
+    void pauseAccepting();
 
     EventLoop* loop_;
     Socket acceptSocket_;
     Channel acceptChannel_;
     NewConnectionCallback NewConnectionCallback_;
     bool listenning_;
+    int idleFd_;
+    int maxAcceptsPerWakeup_;
+    TimerId resumeTimer_;   // set while accepting is paused
+    std::string socketPath_;   // the unix socket file we bound, if any
+    dev_t socketDev_{0};
+    ino_t socketIno_{0};
 
-    std::function<void()> highWaterMarkCallback_;
+    RejectedAcceptCallback rejectedAcceptCallback_;
+    std::atomic<uint64_t> rejectedAccepts_{0};
 };
\ No newline at end of file
@@ -2,13 +2,15 @@
 
 #include <vector>
 #include <string>
+#include <cstdint>
 #include <system_error>
-#include <array>
 
 /*
  * Encapsulates a buffer  
  * The application writes data to the buffer, and the TCP send buffer  
  * uses dual pointers to implement asynchronous data writing.  
+ * readFd() spills into a 64 KiB scratch area shared by all buffers of the  
+ * calling thread, so a Buffer itself stays a few words in size.  
  */  
 
 class Buffer {
@@ -30,13 +32,11 @@ public:
     [[nodiscard]] std::string retrieveAllAsString();
     void append(const char* data, size_t len);
 
-    [[nodiscard]] ssize_t readFd(int fd, std::error_code& ec) noexcept;
-    [[nodiscard]] ssize_t writeFd(int fd, std::error_code& ec) noexcept;
+    // Reads at most maxBytes, which must not be 0 (a 0-byte read looks like EOF)
+    [[nodiscard]] ssize_t readFd(int fd, std::error_code& ec, size_t maxBytes = SIZE_MAX) noexcept;
+    [[nodiscard]] ssize_t writeFd(int fd, std::error_code& ec, size_t maxBytes = SIZE_MAX) noexcept;
 
 private:
-    static constexpr size_t kExtraBufSize = 65536;
-    alignas(64) std::array<char, kExtraBufSize> extrabuf_;
-
     std::vector<char> buffer_;
     size_t readerIndex_;
     size_t writerIndex_;
@@ -54,5 +54,5 @@ private:
 
     void ensureWritableSpace(size_t len);
     void makeSpace(size_t len);
-    void handleReadResult(size_t n, size_t writable) noexcept;
+    void handleReadResult(size_t n, size_t writable, const char* extra) noexcept;
 };
\ No newline at end of file
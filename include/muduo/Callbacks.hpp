@@ -2,14 +2,20 @@
 
 #include <memory>
 #include <functional>
+#include <string>
 
 class Buffer;
-class TcpConnection;
 class Timestamp;
+// The type-erased default: events go to std::function callbacks (TcpConnection.hpp)
+class TcpConnection;
 
 using TcpConnectionPtr = std::shared_ptr<TcpConnection>;
+// Immutable bytes shared by every connection they are sent to (broadcasts)
+using SharedPayload = std::shared_ptr<const std::string>;
 using ConnectionCallback = std::function<void(const TcpConnectionPtr &)>;
 using CloseCallback = std::function<void(const TcpConnectionPtr &)>;
 using WriteCompleteCallback = std::function<void(const TcpConnectionPtr &)>;
 using HighWaterMarkCallback = std::function<void(const TcpConnectionPtr &, size_t)>;
-using MessageCallback = std::function<void(const TcpConnectionPtr &, Buffer *, Timestamp)>;
\ No newline at end of file
+using MessageCallback = std::function<void(const TcpConnectionPtr &, Buffer *, Timestamp)>;
+// Gets the connection by reference, valid for the call; shared_from_this() to keep it
+using BorrowedMessageCallback = std::function<void(TcpConnection &, Buffer *, Timestamp)>;
\ No newline at end of file
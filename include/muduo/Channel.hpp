@@ -54,8 +54,12 @@ public:
     int events() const { return events_; }
     void set_revents(int revt) { revents_ = revt; }
     int index() const { return index_; }
+    // Known to the poller: from the first update() until remove()
+    bool isRegistered() const { return index_ != -1; }
     void set_index(int idx) { index_ = idx; }
     EventLoop* ownerLoop() { return loop_; }
+    // Only legal while the channel is not registered with any poller (after remove())
+    void setOwnerLoop(EventLoop* loop) { loop_ = loop; }
 
     void remove();
 
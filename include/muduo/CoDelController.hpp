@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+#include "Noncopyable.hpp"
+
+/*
+ * CoDel-style overload detector for one EventLoop.  
+ * 
+ * The loop reports the queueing delay of every event it dispatches: input  
+ * that became ready right after the previous poll has waited out the whole  
+ * previous iteration plus the handlers run before it in this one. Once per  
+ * iteration it also reports a sample: the larger of the last event's delay  
+ * and (queueInLoop -> execution of the oldest pending functor). If every  
+ * sample stays above target_ for a whole interval_, the loop is overloaded  
+ * and stays so until a sample drops below target_ again.  
+ * 
+ * While overloaded:  
+ * - shouldShedRequest() sheds every request whose own delay is above  
+ *   target_, so the work still done is the work that can finish in time.  
+ *   Thinning requests out one by one (CoDel's control law) cannot keep up  
+ *   with clients that do not slow down when a request is dropped.  
+ * - shouldShed() follows CoDel's control law: the first call sheds, then  
+ *   the gap between sheds shrinks as interval/sqrt(count). Used for new  
+ *   accepts, which have no delay of their own yet.  
+ * 
+ * beginDispatch()/recordSojourn()/shouldShedRequest() are loop-thread only;  
+ * overloaded()/shouldShed() may be called from any thread.  
+ */
+
+class CoDelController : Noncopyable {
+public:
+    static constexpr int64_t kDefaultTargetUs = 5 * 1000;
+    static constexpr int64_t kDefaultIntervalUs = 100 * 1000;
+
+    CoDelController() = default;
+
+    void enable(int64_t targetUs, int64_t intervalUs) noexcept;
+    [[nodiscard]] bool enabled() const noexcept { return enabled_.load(std::memory_order_relaxed); }
+
+    void beginDispatch(int64_t sojournUs) noexcept { dispatchSojournUs_ = sojournUs; }
+    void recordSojourn(int64_t sojournUs, int64_t nowUs) noexcept;
+
+    [[nodiscard]] bool overloaded() const noexcept { return overloaded_.load(std::memory_order_relaxed); }
+    [[nodiscard]] bool shouldShed();
+    // For a request read by the event being dispatched
+    [[nodiscard]] bool shouldShedRequest() noexcept;
+    [[nodiscard]] int64_t lastSojournUs() const noexcept { return lastSojournUs_.load(std::memory_order_relaxed); }
+    [[nodiscard]] uint64_t shedCount() const noexcept { return shedCount_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic_bool enabled_{false};
+    std::atomic<int64_t> targetUs_{kDefaultTargetUs};
+    std::atomic<int64_t> intervalUs_{kDefaultIntervalUs};
+
+    int64_t firstAboveUs_{0};               // loop thread only
+    int64_t dispatchSojournUs_{0};          // loop thread only
+    std::atomic_bool overloaded_{false};
+    std::atomic<int64_t> lastSojournUs_{0};
+    std::atomic<uint64_t> shedCount_{0};
+
+    std::mutex dropMutex_;                  // guards the control-law state below
+    int64_t dropNextUs_{0};
+    uint32_t dropCount_{0};
+};
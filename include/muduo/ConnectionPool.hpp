@@ -0,0 +1,145 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Callbacks.hpp"
+#include "EventLoop.hpp"
+#include "EventLoopThreadPool.hpp"
+#include "InetAddress.hpp"
+#include "Noncopyable.hpp"
+#include "TcpClient.hpp"
+
+/*
+ * A fixed set of persistent client connections to one server, so callers  
+ * reuse established connections instead of paying a handshake per request:  
+ * - EventLoopThreadPool : The pool's own IO loops  
+ * - clients_     : connectionsPerLoop_ TcpClients on every loop, all with  
+ *                  retry enabled, so a dropped connection comes back by itself  
+ * 
+ * acquire() hands out connected connections round-robin; acquire(loop)  
+ * prefers one owned by the given loop, which lets a handler already running  
+ * on that loop use it without a cross-thread hop.  
+ */  
+
+class ConnectionPool : Noncopyable {
+public:
+    ConnectionPool(EventLoop* baseLoop, const InetAddress& serverAddr, std::string name)
+        : serverAddr_(serverAddr),
+          name_(std::move(name)),
+          threadPool_(std::make_shared<EventLoopThreadPool>(baseLoop, name_)),
+          connectionsPerLoop_(1),
+          next_(0),
+          started_(false) {}
+
+    // Clients are torn down on their own loops, which are still running here
+    ~ConnectionPool() {
+        clients_.clear();
+    }
+
+    void setThreadNum(size_t numThreads) noexcept {
+        threadPool_->setThreadNum(static_cast<int>(numThreads));
+    }
+
+    void setConnectionsPerLoop(size_t n) noexcept {
+        connectionsPerLoop_ = n > 0 ? n : 1;
+    }
+
+    // Seconds, see Connector
+    void setRetryDelays(double initial, double max) noexcept {
+        initRetryDelay_ = initial;
+        maxRetryDelay_ = max;
+    }
+
+    template<typename F>
+    void setConnectionCallback(F&& cb) noexcept {
+        connectionCallback_ = std::forward<F>(cb);
+    }
+
+    template<typename F>
+    void setMessageCallback(F&& cb) noexcept {
+        messageCallback_ = std::forward<F>(cb);
+    }
+
+    template<typename F>
+    void setWriteCompleteCallback(F&& cb) noexcept {
+        writeCompleteCallback_ = std::forward<F>(cb);
+    }
+
+    void start() {
+        if (started_.exchange(true)) {
+            return;
+        }
+        threadPool_->start();
+        for (EventLoop* ioLoop : threadPool_->getAllLoops()) {
+            for (size_t i = 0; i < connectionsPerLoop_; ++i) {
+                auto client = std::make_unique<TcpClient>(
+                    ioLoop, serverAddr_, fmt::format("{}-{}", name_, clients_.size()));
+                client->setConnectionCallback(connectionCallback_);
+                client->setMessageCallback(messageCallback_);
+                client->setWriteCompleteCallback(writeCompleteCallback_);
+                client->setRetryDelays(initRetryDelay_, maxRetryDelay_);
+                client->enableRetry();
+                client->connect();
+                clients_.push_back(std::move(client));
+            }
+        }
+    }
+
+    // Next connected connection in round-robin order; nullptr while none is up
+    [[nodiscard]] TcpConnectionPtr acquire() {
+        const size_t n = clients_.size();
+        const size_t start = next_.fetch_add(1, std::memory_order_relaxed);
+        for (size_t i = 0; i < n; ++i) {
+            TcpConnectionPtr conn = clients_[(start + i) % n]->connection();
+            if (conn && conn->connected()) {
+                return conn;
+            }
+        }
+        return nullptr;
+    }
+
+    // A connected connection living on ioLoop if there is one, any other otherwise
+    [[nodiscard]] TcpConnectionPtr acquire(EventLoop* ioLoop) {
+        for (const auto& client : clients_) {
+            if (client->getLoop() != ioLoop) {
+                continue;
+            }
+            TcpConnectionPtr conn = client->connection();
+            if (conn && conn->connected()) {
+                return conn;
+            }
+        }
+        return acquire();
+    }
+
+    [[nodiscard]] size_t connectedCount() const {
+        size_t count = 0;
+        for (const auto& client : clients_) {
+            TcpConnectionPtr conn = client->connection();
+            count += (conn && conn->connected()) ? 1 : 0;
+        }
+        return count;
+    }
+
+    [[nodiscard]] std::vector<EventLoop*> getAllLoops() const noexcept {
+        return threadPool_->getAllLoops();
+    }
+
+private:
+    const InetAddress serverAddr_;
+    const std::string name_;
+    std::shared_ptr<EventLoopThreadPool> threadPool_;
+    std::vector<std::unique_ptr<TcpClient>> clients_;   // fixed after start()
+    size_t connectionsPerLoop_;
+    double initRetryDelay_{Connector::kDefaultInitRetryDelay};
+    double maxRetryDelay_{Connector::kDefaultMaxRetryDelay};
+    std::atomic<size_t> next_;
+    std::atomic_bool started_;
+
+    ConnectionCallback connectionCallback_;
+    MessageCallback messageCallback_;
+    WriteCompleteCallback writeCompleteCallback_;
+};
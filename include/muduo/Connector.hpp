@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+
+#include "Channel.hpp"
+#include "EventLoop.hpp"
+#include "InetAddress.hpp"
+#include "Noncopyable.hpp"
+#include "Timer.hpp"
+#include "Timestamp.hpp"
+
+/*
+ * Active-open counterpart of Acceptor: issues a non-blocking connect() and  
+ * watches the socket for writability on a temporary Channel. Once SO_ERROR  
+ * reports success the connected fd is handed to newConnectionCallback_.  
+ * 
+ * Failed attempts (refused, unreachable, self-connect, ...) are retried on  
+ * a loop timer with exponential backoff: the delay starts at  
+ * initRetryDelay_ and doubles up to maxRetryDelay_. restart() reconnects  
+ * through the same timer and only resets the delay when the last connection  
+ * stayed up for kMinStableUptime seconds, so a server that accepts and  
+ * closes at once does not get a tight reconnect loop.  
+ * 
+ * start()/stop() may be called from any thread, restart() only from the  
+ * loop thread.  
+ */
+
+class Connector : Noncopyable,
+                  public std::enable_shared_from_this<Connector> {
+public:
+    using NewConnectionCallback = std::function<void(int sockfd)>;
+
+    static constexpr double kDefaultInitRetryDelay = 0.5;
+    static constexpr double kDefaultMaxRetryDelay = 30.0;
+    static constexpr double kMinStableUptime = 5.0;
+
+    Connector(EventLoop* loop, const InetAddress& serverAddr);
+    ~Connector();
+
+    void setNewConnectionCallback(NewConnectionCallback cb) noexcept { newConnectionCallback_ = std::move(cb); }
+    // Seconds; call before start()
+    void setRetryDelays(double initial, double max) noexcept;
+
+    [[nodiscard]] const InetAddress& serverAddress() const noexcept { return serverAddr_; }
+
+    void start();
+    void restart();
+    void stop();
+
+private:
+    enum class State { Disconnected, Connecting, Connected };
+
+    void startInLoop();
+    void stopInLoop();
+    void connect();
+    void connecting(int sockfd);
+    void handleWrite();
+    void handleError();
+    void retry(int sockfd);
+    int removeAndResetChannel();
+
+    EventLoop* loop_;
+    InetAddress serverAddr_;
+    std::atomic_bool connect_;
+    std::atomic<State> state_;
+    std::unique_ptr<Channel> channel_;
+    NewConnectionCallback newConnectionCallback_;
+    double initRetryDelay_;
+    double maxRetryDelay_;
+    double retryDelay_;
+    TimerId retryTimer_;
+    Timestamp connectedAt_;   // when the last attempt succeeded
+};
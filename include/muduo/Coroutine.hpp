@@ -0,0 +1,47 @@
+#pragma once
+
+#include <coroutine>
+#include <exception>
+
+#include "FramePool.hpp"
+#include "Logger.hpp"
+
+/*
+ * Detached coroutine type for writing connection handlers as straight-line  
+ * code instead of callback state machines:  
+ * 
+ *     Task session(TcpConnectionPtr conn) {  
+ *         while (auto line = co_await conn->readUntil("\r\n")) {  
+ *             co_await conn->write(*line);  
+ *         }  
+ *     }  
+ * 
+ * A Task starts eagerly and frees its own frame when it finishes. Frames  
+ * come from the FramePool of the EventLoop running on the calling thread.  
+ * Awaitables live next to what they wait on: TcpConnection::readExactly /  
+ * readUntil / write and EventLoop::sleep. All of them must be awaited from  
+ * the connection's (or loop's) own thread.  
+ */
+
+class Task {
+public:
+    struct promise_type {
+        Task get_return_object() noexcept { return Task{}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+
+        void unhandled_exception() noexcept {
+            try {
+                std::rethrow_exception(std::current_exception());
+            } catch (const std::exception& e) {
+                LOG_ERROR("[Task] Coroutine exited with exception: {}", e.what());
+            } catch (...) {
+                LOG_ERROR("[Task] Coroutine exited with unknown exception");
+            }
+        }
+
+        static void* operator new(size_t size) { return FramePool::allocate(size); }
+        static void operator delete(void* frame) noexcept { FramePool::deallocate(frame); }
+    };
+};
@@ -1,13 +1,19 @@
 #pragma once
 
 #include <atomic>
+#include <chrono>
+#include <coroutine>
 #include <functional>
 #include <memory>
 #include <mutex>
+#include <utility>
 #include <vector>
 
 #include "Noncopyable.hpp"
 #include "Timestamp.hpp"
+#include "Timer.hpp"
+#include "FramePool.hpp"
+#include "CoDelController.hpp"
 #include "CurrentThread.hpp"
 #include "Logger.hpp"
 
@@ -23,15 +29,64 @@
  *                     wakeupFd_ will trigger loop awakening.  
  * - pendingFunctors_: Ensures all tasks are executed within the loop's thread  
  *                     during a single iteration.  
+ * - timerQueue_      : timerfd-backed timers (runAt / runAfter / runEvery).  
+ * - framePool_       : Recycles coroutine frames started on this thread;  
+ *                     co_await loop.sleep(d) suspends on a timer.  
+ * - load counters    : Active connections, queued functors and the recent busy  
+ *                     ratio, read by EventLoopThreadPool's dispatch policies.  
+ * - overload_        : CoDel controller fed with the queueing delay of each  
+ *                     dispatched event once enabled (see CoDelController).  
+ * - mailboxes_       : Lock-free inboxes (see LoopChannel) drained once per  
+ *                     iteration. Producers wake the loop only while it is  
+ *                     parked in poll(); a loop that finds mail right before  
+ *                     polling does not block.  
  */
 
 class Poller;
 class Channel;
+class TimerQueue;
 
 class EventLoop : Noncopyable {
 public:
     using Functor = std::function<void()>;
 
+    struct SleepAwaiter {
+        // Owns the suspended coroutine until its timer fires; a timer deleted
+        // unfired (the loop went away) destroys the frame instead of leaking it
+        struct PendingResume : Noncopyable {
+            explicit PendingResume(std::coroutine_handle<> h) noexcept : handle(h) {}
+            ~PendingResume() {
+                if (handle) handle.destroy();
+            }
+            void resume() { std::exchange(handle, nullptr).resume(); }
+
+            std::coroutine_handle<> handle;
+        };
+
+        EventLoop* loop;
+        double seconds;
+
+        bool await_ready() const noexcept { return seconds <= 0.0; }
+        void await_suspend(std::coroutine_handle<> handle) {
+            loop->runAfter(seconds, [pending = std::make_shared<PendingResume>(handle)] { pending->resume(); });
+        }
+        void await_resume() const noexcept {}
+    };
+
+    // Drained by the loop itself; only empty() may be called from other threads
+    class Mailbox {
+    public:
+        virtual ~Mailbox() = default;
+        virtual bool empty() const noexcept = 0;
+        virtual void drain() = 0;
+    };
+
+    struct LoadStats {
+        int activeConnections;   // including ones dispatched but not yet established
+        size_t pendingFunctors;
+        int busyPermille;   // share of recent wall time spent outside poll()
+    };
+
     EventLoop();
     ~EventLoop();
 
@@ -40,6 +95,19 @@ public:
     void runInLoop(Functor cb);
     void queueInLoop(Functor cb);
 
+    TimerId runAt(Timestamp time, Functor cb);
+    TimerId runAfter(double delay, Functor cb);
+    TimerId runEvery(double interval, Functor cb);
+    void cancel(TimerId timerId);
+
+    [[nodiscard]] SleepAwaiter sleep(double seconds) noexcept { 
+        return SleepAwaiter{this, seconds}; 
+    }
+    template<typename Rep, typename Period>
+    [[nodiscard]] SleepAwaiter sleep(std::chrono::duration<Rep, Period> d) noexcept {
+        return SleepAwaiter{this, std::chrono::duration<double>(d).count()};
+    }
+
     void updateChannel(Channel* channel);
     void removeChannel(Channel* channel);
     bool hasChannel(Channel* channel);
@@ -52,14 +120,42 @@ public:
         return pollReturnTime_; 
     }
 
+    void connectionOpened() noexcept { 
+        activeConnections_.fetch_add(1, std::memory_order_relaxed); 
+    }
+    void connectionClosed() noexcept { 
+        activeConnections_.fetch_sub(1, std::memory_order_relaxed); 
+    }
+    // A connection assigned to this loop but not established on it yet; counted
+    // in loadStats() so a burst of accepts does not pile onto one loop
+    void connectionDispatched() noexcept {
+        dispatchedConnections_.fetch_add(1, std::memory_order_relaxed);
+    }
+    void connectionDispatchDone() noexcept {
+        dispatchedConnections_.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] LoadStats loadStats() const noexcept;
+
+    CoDelController& overloadController() noexcept { return overload_; }
+
+    // Loop thread only
+    void addMailbox(Mailbox* mailbox);
+    void removeMailbox(Mailbox* mailbox);
+    // For mailbox producers, after publishing: wakes the loop if it may block in poll()
+    void wakeupIfPolling() noexcept;
+
 private:
     static const int kPollTimeMs = 10000;
+    static constexpr int64_t kLoadWindowUs = 100 * 1000;
     static __thread EventLoop* t_loopInThisThread;
 
     static int createEventfd();
     void handleRead();
     void wakeup();
-    void doPendingFunctors();
+    int64_t doPendingFunctors();
+    bool hasMail() const noexcept;
+    void accountBusyTime(int64_t busyStartUs, int64_t busyEndUs) noexcept;
 
     std::atomic_bool looping_;
     std::atomic_bool quit_;
@@ -68,8 +164,24 @@ private:
     std::unique_ptr<Poller> poller_;
     int wakeupFd_;
     std::unique_ptr<Channel> wakeupChannel_;
+    std::unique_ptr<TimerQueue> timerQueue_;
+    FramePool framePool_;
     std::vector<Channel*> activeChannels_;
     std::atomic_bool callingPendingFunctors_;
     std::vector<Functor> pendingFunctors_;
+    int64_t pendingSinceUs_{0};
     std::mutex mutex_;
+    CoDelController overload_;
+    std::vector<Mailbox*> mailboxes_;
+    std::atomic_bool polling_{false};
+    std::atomic_bool wakeupPending_{false};
+
+    std::atomic_int activeConnections_{0};
+    std::atomic_int dispatchedConnections_{0};
+    std::atomic<size_t> pendingCount_{0};
+    std::atomic_int busyPermille_{0};
+    std::atomic<int64_t> idleSinceUs_{0};
+    int64_t windowStartUs_{0};
+    int64_t windowBusyUs_{0};
+    int64_t lastBusyUs_{0};   // the previous iteration, for the overload controller
 };
\ No newline at end of file
@@ -5,37 +5,77 @@
 #include <vector>
 #include <memory>
 #include <atomic>
+#include <utility>
 
 #include "Noncopyable.hpp"
 #include "EventLoop.hpp"
 #include "EventLoopThread.hpp"
+#include "InetAddress.hpp"
 
 /*
- * getNextLoop: Retrieves the next subloop object via round-robin scheduling  
+ * getNextLoop: Retrieves the next subloop object according to the dispatch policy  
+ * - kRoundRobin       : Plain rotation (default)  
+ * - kLeastConnections : Loop with the fewest active connections  
+ * - kPowerOfTwoChoices: Samples two loops, keeps the less loaded one  
+ *                       (busy ratio, queued functors, connections)  
+ * - kConsistentHash   : Peer host hashed onto a ring of virtual nodes, so a  
+ *                       client host keeps landing on the same loop. The  
+ *                       key is the IPv4 or IPv6 address (IPv4-mapped IPv6  
+ *                       counts as IPv4) or a named unix peer's path;  
+ *                       unnamed unix peers, the usual case, rotate as with  
+ *                       kRoundRobin  
+ * A custom LoopSelector overrides the built-in policies.  
  * One loop per thread  
  */
 
 class EventLoopThreadPool : Noncopyable {
 public:
     using ThreadInitCallback = std::function<void(EventLoop*)>;
+    using LoopSelector = std::function<EventLoop*(const std::vector<EventLoop*>&, const InetAddress&)>;
+
+    enum class DispatchPolicy {
+        kRoundRobin,
+        kLeastConnections,
+        kPowerOfTwoChoices,
+        kConsistentHash
+    };
 
     EventLoopThreadPool(EventLoop* baseLoop, std::string name);
     ~EventLoopThreadPool();
 
     void setThreadNum(int numThreads) noexcept;
+    void setDispatchPolicy(DispatchPolicy policy) noexcept { policy_ = policy; }
+    void setLoopSelector(LoopSelector selector) noexcept { selector_ = std::move(selector); }
     void start(const ThreadInitCallback& cb = {});
 
     [[nodiscard]] EventLoop* getNextLoop() noexcept;
+    // Counts the connection on the returned loop (EventLoop::connectionDispatched);
+    // the caller calls connectionDispatchDone() there once it is established or dropped
+    [[nodiscard]] EventLoop* getLoopFor(const InetAddress& peerAddr);
     [[nodiscard]] std::vector<EventLoop*> getAllLoops() const noexcept;
     [[nodiscard]] bool started() const noexcept;
     [[nodiscard]] const std::string& name() const noexcept;
+    [[nodiscard]] DispatchPolicy dispatchPolicy() const noexcept { return policy_; }
 
 private:
+    static constexpr int kVirtualNodesPerLoop = 64;
+
+    EventLoop* selectLoopFor(const InetAddress& peerAddr);
+    EventLoop* roundRobinLoop() noexcept;
+    EventLoop* leastConnectionsLoop() noexcept;
+    EventLoop* powerOfTwoLoop() noexcept;
+    // nullptr when the peer has no host to hash
+    EventLoop* consistentHashLoop(const InetAddress& peerAddr) const noexcept;
+    void buildHashRing();
+
     EventLoop* baseLoop_;
     std::string name_;
     std::atomic_bool started_;
     int numThreads_;
     std::atomic_uint next_;
+    DispatchPolicy policy_;
+    LoopSelector selector_;
     std::vector<std::unique_ptr<EventLoopThread>> threads_;
     std::vector<EventLoop*> loops_;
-};
\ No newline at end of file
+    std::vector<std::pair<uint64_t, EventLoop*>> ring_;
+};
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "Noncopyable.hpp"
+
+/*
+ * Per-loop recycler for coroutine frames and connection objects.  
+ * 
+ * Frames are rounded up to 128-byte size classes and kept on intrusive  
+ * free lists after the coroutine finishes, so steady-state request  
+ * handling does not touch the global allocator. Every block carries a  
+ * small header naming its pool: a frame released on another thread (e.g.  
+ * after its connection migrated) goes back to the global heap instead.  
+ * 
+ * Each EventLoop owns one pool and binds it to its thread on construction.  
+ * PoolAllocator plugs it into std::allocate_shared(), which is how  
+ * TcpServer recycles TcpConnection objects across accepts.  
+ * 
+ * Blocks are kBlockAlignment (cache line) aligned. allocate() places the  
+ * header right before the pointer it returns, which is aligned as asked, up  
+ * to kBlockAlignment; a cache-line aligned object gets a line of its own  
+ * for the header, everything else only the 16 bytes it needs.  
+ */
+
+class FramePool : Noncopyable {
+public:
+    static constexpr size_t kBlockAlignment = 64;
+
+    FramePool() = default;
+    ~FramePool();
+
+    void bindToThisThread() noexcept;
+    void unbindFromThisThread() noexcept;
+
+    // alignment: a power of two, at most kBlockAlignment
+    static void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+    static void deallocate(void* frame) noexcept;
+
+private:
+    struct FreeBlock { FreeBlock* next; };
+    // offset: from the start of the block to the pointer handed out
+    struct alignas(std::max_align_t) Header { FramePool* pool; uint32_t sizeClass; uint32_t offset; };
+
+    static constexpr size_t kGranularity = 128;
+    static constexpr size_t kNumClasses = 32;            // frames up to 4 KiB are pooled
+    static constexpr size_t kMaxCachedPerClass = 1024;
+
+    static void* newBlock(size_t size);
+    static void deleteBlock(void* block) noexcept;
+    void* take(size_t sizeClass);
+    bool give(void* block, size_t sizeClass) noexcept;
+
+    std::array<FreeBlock*, kNumClasses> freeLists_{};
+    std::array<size_t, kNumClasses> cached_{};
+};
+
+// Allocator over the calling thread's FramePool, e.g. for std::allocate_shared()
+template<typename T>
+struct PoolAllocator {
+    using value_type = T;
+
+    static_assert(alignof(T) <= FramePool::kBlockAlignment, "FramePool blocks are cache-line aligned");
+
+    PoolAllocator() noexcept = default;
+    template<typename U>
+    PoolAllocator(const PoolAllocator<U>&) noexcept {}
+
+    T* allocate(size_t n) { return static_cast<T*>(FramePool::allocate(n * sizeof(T), alignof(T))); }
+    void deallocate(T* p, size_t) noexcept { FramePool::deallocate(p); }
+
+    template<typename U>
+    bool operator==(const PoolAllocator<U>&) const noexcept { return true; }
+};
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Buffer.hpp"
+#include "HttpRequest.hpp"
+
+/*
+ * Incremental HTTP/1.x request parser working directly on a connection's  
+ * input Buffer. parse() scans from where the previous call stopped, so a  
+ * request arriving in many small reads is looked at once, not re-parsed  
+ * from its first byte each time. Positions are kept as offsets from  
+ * Buffer::peek(), which stay valid while the Buffer grows or compacts; the  
+ * string_views of request() are built once the request is complete.  
+ * 
+ * Bodies come with Content-Length (viewed in place) or chunked transfer  
+ * encoding (de-chunked into chunkedBody_). After a complete request the  
+ * caller retrieves requestLength() bytes and calls reset(); whatever  
+ * follows in the Buffer is the next pipelined request.  
+ */
+
+class HttpParser {
+public:
+    enum class Result { kNeedMore, kComplete, kError };
+
+    static constexpr size_t kMaxHeaderBytes = 64 * 1024;
+    static constexpr size_t kMaxBodyBytes = 8 * 1024 * 1024;
+
+    Result parse(const Buffer& buf);
+    void reset() noexcept;
+
+    // Valid after kComplete, until the Buffer is modified
+    [[nodiscard]] const HttpRequest& request() const noexcept { return request_; }
+    [[nodiscard]] size_t requestLength() const noexcept { return pos_; }
+    // Status to answer with after kError (400, 413, 431, 501, 505)
+    [[nodiscard]] int errorStatus() const noexcept { return errorStatus_; }
+
+private:
+    enum class Stage { kRequestLine, kHeaders, kBody, kChunkSize, kChunkData, kTrailers, kDone };
+
+    struct Span {
+        uint32_t offset{0};
+        uint32_t length{0};
+    };
+
+    Result fail(int status) noexcept;
+    // kNeedMore, or 431 once the unfinished line is longer than kMaxHeaderBytes
+    Result incompleteLine(size_t readable) noexcept;
+    // Next line starting at pos_, without its line ending; false if incomplete
+    bool nextLine(const char* base, size_t readable, Span* line) noexcept;
+    bool parseRequestLine(const char* base, Span line);
+    bool parseHeader(const char* base, Span line);
+    Result finishHeaders(const char* base);
+    bool parseChunkSize(const char* base, Span line);
+    void materialize(const char* base);
+
+    Stage stage_{Stage::kRequestLine};
+    size_t pos_{0};
+    int errorStatus_{0};
+
+    Span method_;
+    Span target_;
+    int version_{11};
+    std::vector<std::pair<Span, Span>> headers_;
+    bool chunked_{false};
+    size_t contentLength_{0};
+    size_t bodyOffset_{0};
+    size_t chunkRemaining_{0};
+    size_t trailersOffset_{0};
+    std::string chunkedBody_;
+
+    HttpRequest request_;
+};
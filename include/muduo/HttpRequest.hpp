@@ -0,0 +1,73 @@
+#pragma once
+
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/*
+ * A parsed HTTP/1.x request. Every field is a view into the connection's  
+ * input Buffer (a chunked body into the parser's own storage), so a request  
+ * is only valid inside the HttpServer callback that receives it; copy what  
+ * has to outlive it.  
+ */
+
+class HttpRequest {
+public:
+    using Header = std::pair<std::string_view, std::string_view>;
+
+    [[nodiscard]] std::string_view method() const noexcept { return method_; }
+    [[nodiscard]] std::string_view target() const noexcept { return target_; }
+    [[nodiscard]] std::string_view path() const noexcept { return path_; }
+    [[nodiscard]] std::string_view query() const noexcept { return query_; }
+    [[nodiscard]] std::string_view body() const noexcept { return body_; }
+    [[nodiscard]] const std::vector<Header>& headers() const noexcept { return headers_; }
+    // 10 for HTTP/1.0, 11 for HTTP/1.1
+    [[nodiscard]] int version() const noexcept { return version_; }
+
+    // Case-insensitive; empty when absent
+    [[nodiscard]] std::string_view header(std::string_view name) const noexcept {
+        for (const auto& [key, value] : headers_) {
+            if (equalsIgnoreCase(key, name)) {
+                return value;
+            }
+        }
+        return {};
+    }
+
+    // HTTP/1.1 keeps the connection open unless told otherwise, HTTP/1.0 the reverse
+    [[nodiscard]] bool keepAlive() const noexcept {
+        const std::string_view connection = header("Connection");
+        if (version_ >= 11) {
+            return !equalsIgnoreCase(connection, "close");
+        }
+        return equalsIgnoreCase(connection, "keep-alive");
+    }
+
+    static bool equalsIgnoreCase(std::string_view a, std::string_view b) noexcept {
+        if (a.size() != b.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < a.size(); ++i) {
+            if (toLowerAscii(a[i]) != toLowerAscii(b[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Only A-Z: or-ing 0x20 into anything else would also match '@' with '`'
+    static constexpr char toLowerAscii(char c) noexcept {
+        return c >= 'A' && c <= 'Z' ? static_cast<char>(c | 0x20) : c;
+    }
+
+private:
+    friend class HttpParser;
+
+    std::string_view method_;
+    std::string_view target_;
+    std::string_view path_;
+    std::string_view query_;
+    std::string_view body_;
+    std::vector<Header> headers_;
+    int version_{11};
+};
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/*
+ * An HTTP/1.1 response filled in by the HttpServer callback and serialized  
+ * by appendTo() straight into the connection's batched output.  
+ * 
+ * The body is sent with Content-Length, or with chunked transfer encoding  
+ * when built through appendChunk(). Connection: close is added and the  
+ * connection shut down once sent when closeConnection() is set, either by  
+ * the handler or because the request did not ask for keep-alive.  
+ */
+
+class HttpResponse {
+public:
+    explicit HttpResponse(bool closeConnection = false) : closeConnection_(closeConnection) {}
+
+    void setStatus(int code, std::string_view reason = {}) {
+        statusCode_ = code;
+        reason_ = reason.empty() ? std::string(defaultReason(code)) : std::string(reason);
+    }
+    void setCloseConnection(bool on) noexcept { closeConnection_ = on; }
+    void setContentType(std::string_view type) { addHeader("Content-Type", type); }
+    void addHeader(std::string_view name, std::string_view value) { headers_.emplace_back(name, value); }
+
+    void setBody(std::string body) {
+        body_ = std::move(body);
+        chunked_ = false;
+    }
+    // Switches to chunked transfer encoding; every call becomes one chunk
+    void appendChunk(std::string_view data);
+
+    [[nodiscard]] int statusCode() const noexcept { return statusCode_; }
+    [[nodiscard]] bool closeConnection() const noexcept { return closeConnection_; }
+
+    // includeBody == false for HEAD: headers describe the body that is left out
+    void appendTo(std::string& output, bool includeBody = true) const;
+
+    static std::string_view defaultReason(int code) noexcept;
+
+private:
+    int statusCode_{200};
+    std::string reason_{"OK"};
+    bool closeConnection_;
+    bool chunked_{false};
+    std::vector<std::pair<std::string, std::string>> headers_;
+    std::string body_;
+};
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <functional>
+#include <string>
+
+#include "Callbacks.hpp"
+#include "EventLoop.hpp"
+#include "HttpParser.hpp"
+#include "HttpRequest.hpp"
+#include "HttpResponse.hpp"
+#include "InetAddress.hpp"
+#include "Noncopyable.hpp"
+#include "TcpServer.hpp"
+
+/*
+ * HTTP/1.1 server layered on TcpServer.  
+ * 
+ * Each connection owns an HttpParser that works on its input Buffer in  
+ * place. One message callback handles every complete request found in the  
+ * Buffer (pipelining): the handler runs synchronously, so responses come  
+ * out in request order, and all of them are serialized into one string and  
+ * sent together. Keep-alive follows the request's version and Connection  
+ * header; a malformed request gets its error status, the connection is  
+ * shut down and anything the client sends after it is discarded.  
+ * 
+ * The parser is the connection's context (TcpConnection::setContext).  
+ */
+
+class HttpServer : Noncopyable {
+public:
+    using HttpCallback = std::function<void(const HttpRequest&, HttpResponse*)>;
+
+    HttpServer(EventLoop* loop,
+               const InetAddress& listenAddr,
+               std::string name,
+               TcpServer::Option option = TcpServer::Option::kNoReusePort);
+
+    void setHttpCallback(HttpCallback cb) noexcept { httpCallback_ = std::move(cb); }
+    void setThreadNum(size_t numThreads) noexcept { server_.setThreadNum(numThreads); }
+    // Dispatch policy, backpressure, rate limits, ... are set on the TcpServer
+    [[nodiscard]] TcpServer& tcpServer() noexcept { return server_; }
+
+    void start() { server_.start(); }
+
+private:
+    void onConnection(const TcpConnectionPtr& conn);
+    void onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp receiveTime);
+
+    TcpServer server_;
+    HttpCallback httpCallback_;
+};
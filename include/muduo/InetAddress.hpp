@@ -1,26 +1,51 @@
 #pragma once
 
 #include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 #include <string>
 #include <string_view>
 #include <system_error>
 
 /*  
- * Encapsulates the IPv4 address structure  
+ * Encapsulates a socket address: IPv4, or AF_UNIX for same-host peers.  
+ * 
+ * Unix addresses come from fromUnixPath(); a leading '@' selects the Linux  
+ * abstract namespace (no file on disk, gone with the last socket). For them  
+ * toIp() returns the path ("@name" when abstract), toPort() returns 0 and  
+ * toIpPort() returns "unix:<path>". Accepted unix peers are usually  
+ * unnamed, i.e. have an empty path.  
  */  
 
 class InetAddress {
 public:
     explicit InetAddress(uint16_t port = 0, std::string_view ip = "127.0.0.1");
     explicit InetAddress(const sockaddr_in& addr) noexcept;
+    InetAddress(const sockaddr* addr, socklen_t len) noexcept;
+
+    [[nodiscard]] static InetAddress fromUnixPath(std::string_view path);
     
     [[nodiscard]] std::string toIp() const;
     [[nodiscard]] uint16_t toPort() const noexcept;
     [[nodiscard]] std::string toIpPort() const;
+
+    [[nodiscard]] sa_family_t family() const noexcept { return addr_.ss_family; }
+    [[nodiscard]] bool isUnix() const noexcept { return family() == AF_UNIX; }
+    [[nodiscard]] bool isAbstractUnix() const noexcept;
     
-    [[nodiscard]] const sockaddr_in* getSockAddr() const noexcept { return &addr_; }
-    void setSockAddr(const sockaddr_in& addr) noexcept { addr_ = addr; }
+    // IPv4 view; only meaningful when family() == AF_INET
+    [[nodiscard]] const sockaddr_in* getSockAddr() const noexcept { 
+        return reinterpret_cast<const sockaddr_in*>(&addr_); 
+    }
+    [[nodiscard]] const sockaddr* sockAddr() const noexcept { 
+        return reinterpret_cast<const sockaddr*>(&addr_); 
+    }
+    [[nodiscard]] socklen_t sockLen() const noexcept { return len_; }
+
+    void setSockAddr(const sockaddr_in& addr) noexcept;
+    void setSockAddr(const sockaddr* addr, socklen_t len) noexcept;
 
 private:
-    sockaddr_in addr_{};
-};
\ No newline at end of file
+    sockaddr_storage addr_{};
+    socklen_t len_{sizeof(sockaddr_in)};
+};
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "Callbacks.hpp"
+#include "EventLoop.hpp"
+#include "InetAddress.hpp"
+#include "Noncopyable.hpp"
+#include "RespCodec.hpp"
+#include "TcpServer.hpp"
+
+/*
+ * In-memory key/value server speaking RESP2/RESP3, sharded by IO loop.  
+ * 
+ * Every loop owns one shard of the keyspace and is the only thread that  
+ * touches it, so the data path takes no locks. A key's owner is picked by  
+ * hashing it; commands for keys owned by the connection's own loop run  
+ * inline, the rest are collected per owner shard and handed over with one  
+ * runInLoop() per owner and loop iteration. The owner runs the batch and  
+ * returns all replies to the origin loop in one functor as well.  
+ * 
+ * Each command gets a sequence number on arrival and replies are released  
+ * strictly in that order, so pipelining behaves as in Redis even when keys  
+ * span shards. All replies that are ready after a read are written with a  
+ * single send().  
+ * 
+ * Commands: PING, ECHO, HELLO [2|3], SELECT 0, CONFIG (empty reply), QUIT,  
+ * GET, SET, DEL, EXISTS, INCR, DECR. Multi-key DEL/EXISTS need all keys in  
+ * one shard (CROSSSLOT otherwise), like a Redis cluster node.  
+ * 
+ * Connections must stay on the loop they were accepted on: do not combine  
+ * with migrateConnection() or auto rebalancing.  
+ */
+
+class KvServer : Noncopyable {
+public:
+    KvServer(EventLoop* loop,
+             const InetAddress& listenAddr,
+             std::string name,
+             TcpServer::Option option = TcpServer::Option::kNoReusePort);
+
+    void setThreadNum(size_t numThreads) noexcept { server_.setThreadNum(numThreads); }
+    [[nodiscard]] TcpServer& tcpServer() noexcept { return server_; }
+
+    void start();
+
+private:
+    // Commands from kGet on take a key and run on the key's shard
+    enum class Command : uint8_t {
+        kUnknown, kPing, kEcho, kHello, kSelect, kConfig, kQuit,
+        kGet, kSet, kDel, kExists, kIncr, kDecr
+    };
+
+    struct StringHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view s) const noexcept { return std::hash<std::string_view>{}(s); }
+    };
+
+    using Store = std::unordered_map<std::string, std::string, StringHash, std::equal_to<>>;
+
+    // The connection's context; touched only by the loop of its connection
+    struct Session {
+        std::weak_ptr<TcpConnection> conn;
+        RespParser parser;
+        int protocol{2};
+        bool quit{false};          // QUIT or protocol error: close once replies are out
+        bool shutdownSent{false};
+        uint64_t nextSeq{0};       // given to the next command read
+        uint64_t nextToSend{0};    // sequence number whose reply goes out next
+        std::map<uint64_t, std::string> ready;   // replies waiting for earlier ones
+        std::string output;
+
+        void deliver(uint64_t seq, std::string reply);
+        void flush();
+    };
+
+    struct Request {
+        std::shared_ptr<Session> session;
+        uint64_t seq;
+        Command command;
+        int protocol;
+        std::vector<std::string> args;
+    };
+
+    struct Reply {
+        std::shared_ptr<Session> session;
+        uint64_t seq;
+        std::string data;
+    };
+
+    struct Shard {
+        EventLoop* loop{nullptr};
+        size_t index{0};
+        Store store;                                // owner loop only
+        std::vector<std::vector<Request>> outbox;   // by owner shard, origin loop only
+        bool flushQueued{false};
+    };
+
+    using ShardList = std::vector<std::shared_ptr<Shard>>;
+
+    void onConnection(const TcpConnectionPtr& conn);
+    void onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp receiveTime);
+    [[nodiscard]] Shard* shardOf(EventLoop* loop) const noexcept;
+
+    static Command lookupCommand(std::string_view name) noexcept;
+    // Runs one command against store (nullptr for commands needing no key)
+    static void execute(Command command, const std::vector<std::string_view>& args,
+                        Store* store, Session* session, RespWriter& writer);
+    static void flushOutbox(const std::shared_ptr<const ShardList>& shards, size_t origin);
+    static void runBatch(const std::shared_ptr<Shard>& owner, const std::shared_ptr<Shard>& origin,
+                         std::vector<Request> batch);
+
+    TcpServer server_;
+    std::shared_ptr<const ShardList> shards_;          // fixed after start()
+    std::unordered_map<EventLoop*, Shard*> shardByLoop_;
+};
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "EventLoop.hpp"
+#include "Noncopyable.hpp"
+
+/*
+ * Bounded single-producer/single-consumer channel from one EventLoop to  
+ * another, for pipelines where loop A steadily feeds loop B.  
+ * 
+ * tryPush() moves a message into a fixed ring of slots: no allocation, no  
+ * lock, and no eventfd write unless the consumer loop is parked in poll()  
+ * (see EventLoop::wakeupIfPolling). The consumer drains the ring once per  
+ * loop iteration, handing each message to the handler, up to one ring's  
+ * worth per iteration so a busy producer cannot starve its other work.  
+ * 
+ * Backpressure: tryPush() fails when the ring is full. The producer then  
+ * gets its writable callback, on the producer loop, as soon as the consumer  
+ * has freed slots again.  
+ * 
+ * T must be default constructible and movable; a drained slot is reset to  
+ * T{} so it does not hold on to resources. tryPush() must only be called  
+ * from the producer loop's thread. Positions grow monotonically (head  
+ * written by the producer, tail by the consumer) on separate cache lines.  
+ * Both loops must outlive the channel; it may be destroyed from any thread.  
+ */
+
+template<typename T>
+class LoopChannel : Noncopyable, private EventLoop::Mailbox {
+public:
+    using Handler = std::function<void(T&)>;
+    using WritableCallback = std::function<void()>;
+
+    LoopChannel(EventLoop* producer, EventLoop* consumer, size_t capacity, Handler handler)
+        : producer_(producer),
+          consumer_(consumer),
+          slots_(std::bit_ceil(std::max<size_t>(capacity, 2))),
+          mask_(slots_.size() - 1),
+          handler_(std::move(handler)) {
+        consumer_->runInLoop([this] { consumer_->addMailbox(this); });
+    }
+
+    ~LoopChannel() override {
+        if (consumer_->isInLoopThread()) {
+            consumer_->removeMailbox(this);
+        } else {
+            std::promise<void> done;
+            consumer_->queueInLoop([this, &done] {
+                consumer_->removeMailbox(this);
+                done.set_value();
+            });
+            done.get_future().wait();
+        }
+    }
+
+    // Producer side; runs on the producer loop after a failed tryPush()
+    void setWritableCallback(WritableCallback cb) { *writableCallback_ = std::move(cb); }
+
+    // Producer loop only; false (value untouched) when the ring is full
+    bool tryPush(T& value) {
+        const uint64_t head = head_.load(std::memory_order_relaxed);
+        if (head - cachedTail_ == slots_.size()) {
+            cachedTail_ = tail_.load(std::memory_order_acquire);
+            if (head - cachedTail_ == slots_.size()) {
+                // Ask for a callback, then look again in case the consumer freed slots meanwhile
+                producerWaiting_.store(true, std::memory_order_seq_cst);
+                cachedTail_ = tail_.load(std::memory_order_seq_cst);
+                if (head - cachedTail_ == slots_.size()) {
+                    return false;
+                }
+                producerWaiting_.store(false, std::memory_order_relaxed);
+            }
+        }
+        slots_[head & mask_] = std::move(value);
+        head_.store(head + 1, std::memory_order_release);
+        consumer_->wakeupIfPolling();
+        return true;
+    }
+
+    bool tryPush(T&& value) { return tryPush(value); }
+
+    [[nodiscard]] size_t capacity() const noexcept { return slots_.size(); }
+
+private:
+    bool empty() const noexcept override {
+        return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_relaxed);
+    }
+
+    void drain() override {
+        uint64_t tail = tail_.load(std::memory_order_relaxed);
+        const uint64_t head = head_.load(std::memory_order_acquire);
+        if (head == tail) {
+            return;
+        }
+        for (const uint64_t end = tail + std::min<uint64_t>(head - tail, slots_.size()); tail != end; ++tail) {
+            T& slot = slots_[tail & mask_];
+            handler_(slot);
+            slot = T{};
+        }
+        tail_.store(tail, std::memory_order_seq_cst);
+        if (producerWaiting_.load(std::memory_order_seq_cst) &&
+            producerWaiting_.exchange(false, std::memory_order_relaxed)) {
+            // Held weakly: the channel may be gone by the time the producer loop gets to it
+            producer_->queueInLoop([weak = std::weak_ptr<WritableCallback>(writableCallback_)] {
+                if (auto cb = weak.lock(); cb && *cb) (*cb)();
+            });
+        }
+    }
+
+    EventLoop* const producer_;
+    EventLoop* const consumer_;
+    std::vector<T> slots_;
+    const size_t mask_;
+    Handler handler_;
+    std::shared_ptr<WritableCallback> writableCallback_{std::make_shared<WritableCallback>()};
+
+    alignas(64) std::atomic<uint64_t> head_{0};   // producer
+    uint64_t cachedTail_{0};                      // producer's last look at tail_
+    alignas(64) std::atomic<uint64_t> tail_{0};   // consumer
+    alignas(64) std::atomic<bool> producerWaiting_{false};
+};
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Buffer.hpp"
+
+/*
+ * RESP (Redis serialization protocol), versions 2 and 3.  
+ * 
+ * RespParser reads client commands, either multibulk arrays of bulk strings  
+ * (*2\r\n$3\r\nGET\r\n$1\r\nk\r\n) or inline commands (GET k\r\n), in place  
+ * from a Buffer. Like HttpParser it resumes where the previous call stopped  
+ * and keeps offsets from Buffer::peek(); args() are views into the Buffer,  
+ * valid until the command is retrieved.  
+ * 
+ * RespWriter appends replies for the protocol version the client chose with  
+ * HELLO: RESP3-only types (null, map, boolean, double) fall back to their  
+ * RESP2 encodings when protocol() == 2.  
+ * 
+ * RespCodec::valueLength() measures one complete reply of any type, for  
+ * clients that only need to frame replies. It walks nested aggregates  
+ * without recursion, so a hostile reply cannot exhaust the stack.  
+ */
+
+class RespParser {
+public:
+    enum class Result { kNeedMore, kComplete, kError };
+
+    static constexpr size_t kMaxArgs = 1024 * 1024;
+    static constexpr size_t kMaxBulkLength = 512 * 1024 * 1024;
+    static constexpr size_t kMaxInlineLength = 64 * 1024;
+
+    Result parse(const Buffer& buf);
+    void reset() noexcept;
+
+    // Valid after kComplete, until the Buffer is modified
+    [[nodiscard]] const std::vector<std::string_view>& args() const noexcept { return args_; }
+    [[nodiscard]] size_t requestLength() const noexcept { return pos_; }
+    [[nodiscard]] const char* error() const noexcept { return error_; }
+
+private:
+    enum class Stage { kStart, kBulkHeader, kBulkData, kDone };
+
+    struct Span {
+        size_t offset;
+        size_t length;
+    };
+
+    Result fail(const char* message) noexcept;
+    // Offset of the '\r' ending the line starting at pos_, or npos
+    size_t findLineEnd(const char* base, size_t readable) const noexcept;
+    Result parseInline(const char* base, size_t readable);
+
+    Stage stage_{Stage::kStart};
+    size_t pos_{0};
+    size_t argsExpected_{0};
+    size_t bulkLength_{0};
+    std::vector<Span> spans_;
+    std::vector<std::string_view> args_;
+    const char* error_{nullptr};
+};
+
+class RespWriter {
+public:
+    explicit RespWriter(std::string& out, int protocol = 2) noexcept : out_(out), protocol_(protocol) {}
+
+    [[nodiscard]] int protocol() const noexcept { return protocol_; }
+    void setProtocol(int protocol) noexcept { protocol_ = protocol; }
+
+    void simple(std::string_view s);
+    void error(std::string_view message);
+    void integer(int64_t value);
+    void bulk(std::string_view s);
+    void null();
+    void boolean(bool value);
+    void number(double value);
+    void arrayHeader(size_t count);
+    void mapHeader(size_t pairs);
+
+private:
+    std::string& out_;
+    int protocol_;
+};
+
+class RespCodec {
+public:
+    // Bytes of the first complete value at data, 0 if incomplete, -1 if malformed
+    static ptrdiff_t valueLength(const char* data, size_t len) noexcept;
+};
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "Callbacks.hpp"
+#include "EventLoop.hpp"
+#include "InetAddress.hpp"
+#include "Noncopyable.hpp"
+#include "RpcCodec.hpp"
+#include "TcpClient.hpp"
+#include "Timer.hpp"
+
+/*
+ * Client side of the binary RPC layer: one TcpClient connection carrying  
+ * any number of concurrent calls.  
+ * 
+ * call() assigns a call id, arms a deadline on a loop timer and queues the  
+ * request; all requests issued during one loop iteration go out in a  
+ * single send(). Each reply is matched by call id, in whatever order the  
+ * server completes them. A call ends exactly once: with the reply, with  
+ * kTimeout when its timer fires first, with kDisconnected when the  
+ * connection is lost (or was not up when the call was made), or with  
+ * kTooLarge, without sending anything, when the request would not fit a  
+ * frame.  
+ * 
+ * call() may be used from any thread; callbacks run on the client's loop  
+ * and the payload view is only valid during the callback.  
+ */
+
+class RpcClient : Noncopyable {
+public:
+    using ResponseCallback = std::function<void(RpcStatus, std::string_view payload)>;
+
+    static constexpr double kDefaultTimeout = 5.0;
+
+    RpcClient(EventLoop* loop, const InetAddress& serverAddr, std::string name);
+    ~RpcClient();
+
+    void connect() { client_.connect(); }
+    void disconnect() { client_.disconnect(); }
+    void enableRetry() noexcept { client_.enableRetry(); }
+
+    template<typename F>
+    void setConnectionCallback(F&& cb) noexcept {
+        connectionCallback_ = std::forward<F>(cb);
+    }
+
+    void call(std::string_view method, std::string_view payload, ResponseCallback cb,
+              double timeoutSeconds = kDefaultTimeout);
+
+    // Loop thread only
+    [[nodiscard]] size_t inFlight() const noexcept { return pending_.size(); }
+
+private:
+    struct PendingCall {
+        ResponseCallback callback;
+        TimerId deadline;
+    };
+
+    void callInLoop(std::string_view method, std::string_view payload, ResponseCallback cb, double timeoutSeconds);
+    void onConnection(const TcpConnectionPtr& conn);
+    void onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp receiveTime);
+    void expire(uint64_t callId);
+    void failAll(RpcStatus status);
+    void flush();
+    void teardownInLoop();
+
+    EventLoop* loop_;
+    TcpClient client_;
+
+    // Loop thread only
+    TcpConnectionPtr conn_;
+    uint64_t nextCallId_;
+    std::unordered_map<uint64_t, PendingCall> pending_;
+    std::string pendingOutput_;
+    bool flushQueued_;
+    std::shared_ptr<void> lifeline_{std::make_shared<char>()};
+
+    ConnectionCallback connectionCallback_;
+};
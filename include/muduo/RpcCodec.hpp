@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "Buffer.hpp"
+
+/*
+ * Wire format of the binary RPC layer, one length-prefixed frame per call  
+ * or reply (integers in network byte order):  
+ * 
+ *    0  uint32  length of the rest of the frame  
+ *    4  uint8   kind (RpcFrameKind)  
+ *    5  uint8   status (RpcStatus, replies only)  
+ *    6  uint16  method name length (requests only)  
+ *    8  uint64  call id, echoed in the reply  
+ *   16  method name, then payload  
+ * 
+ * decode() reads a frame straight from a Buffer without copying: method and  
+ * payload are views into it, valid until the frame is retrieved.  
+ */
+
+enum class RpcFrameKind : uint8_t { kRequest = 0, kResponse = 1 };
+
+enum class RpcStatus : uint8_t {
+    kOk = 0,
+    kNoSuchMethod = 1,
+    kHandlerError = 2,   // the handler called Responder::fail()
+    kTimeout = 3,        // client side: deadline expired
+    kDisconnected = 4,   // client side: connection lost or never up
+    kBadFrame = 5,
+    kTooLarge = 6        // method name over 65535 bytes or frame over kMaxFrameSize; nothing was sent
+};
+
+struct RpcFrame {
+    RpcFrameKind kind{RpcFrameKind::kRequest};
+    RpcStatus status{RpcStatus::kOk};
+    uint64_t callId{0};
+    std::string_view method;
+    std::string_view payload;
+    size_t size{0};   // bytes to retrieve from the Buffer
+};
+
+class RpcCodec {
+public:
+    enum class DecodeResult { kNeedMore, kFrame, kError };
+
+    static constexpr size_t kHeaderSize = 16;
+    static constexpr size_t kMaxFrameSize = 16 * 1024 * 1024;
+
+    static DecodeResult decode(const Buffer& buf, RpcFrame* frame) noexcept;
+    // Whether a frame with this method and payload can be encoded and decoded by the peer
+    [[nodiscard]] static bool fits(std::string_view method, std::string_view payload) noexcept {
+        return method.size() <= UINT16_MAX && payload.size() <= kMaxFrameSize - (kHeaderSize - 4) - method.size();
+    }
+    // Both require fits(method, payload)
+    static void appendRequest(std::string& out, uint64_t callId, std::string_view method, std::string_view payload);
+    static void appendResponse(std::string& out, uint64_t callId, RpcStatus status, std::string_view payload);
+};
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "Callbacks.hpp"
+#include "EventLoop.hpp"
+#include "InetAddress.hpp"
+#include "Noncopyable.hpp"
+#include "RpcCodec.hpp"
+#include "TcpClient.hpp"
+#include "TcpServer.hpp"
+#include "Timer.hpp"
+#include "Timestamp.hpp"
+
+/*
+ * L7 load balancer for the binary RPC protocol (see RpcCodec).  
+ * 
+ * Every request frame is routed on its own: a routing key taken from the  
+ * frame (the method name unless setKeyExtractor() says otherwise) is hashed  
+ * onto a ring of virtual nodes, and the first backend clockwise that is up  
+ * and below its load bound takes it. The bound is consistent hashing with  
+ * bounded loads: no backend gets more than loadFactor times the average  
+ * number of calls in flight (1.25 by default), so a hot key spills over to  
+ * the next backends on the ring instead of overloading one.  
+ * 
+ * Each IO loop owns a small pool of persistent connections to every  
+ * backend (setConnectionsPerBackend, 1 by default) and load counters of its  
+ * own. A client's requests only ever use the connections of the client's  
+ * loop, so forwarding needs no locks and no cross-thread hops. Calls from  
+ * many clients are multiplexed on those connections by rewriting the call  
+ * id to one unique within the loop and back on the reply. Everything bound  
+ * for one connection during a read goes out with one send().  
+ * 
+ * The per-loop state is built by the server's thread init callback, on each  
+ * IO loop before the server listens, so every client connection finds its  
+ * loop's state in place.  
+ * 
+ * A call whose backend connection drops, or that finds no backend up,  
+ * fails with RpcStatus::kDisconnected. One the backend has not answered  
+ * within the call timeout (setCallTimeout, 5 s by default) fails with  
+ * RpcStatus::kTimeout; a reply that arrives later is dropped. Deadlines are  
+ * checked every quarter of the timeout, so a call may run up to 25% over.  
+ */
+
+class RpcProxy : Noncopyable {
+public:
+    // Returns a view into the frame; only valid during the call
+    using KeyExtractor = std::function<std::string_view(const RpcFrame&)>;
+
+    static constexpr int kVirtualNodesPerBackend = 64;
+    static constexpr double kDefaultCallTimeout = 5.0;
+
+    RpcProxy(EventLoop* loop,
+             const InetAddress& listenAddr,
+             std::vector<InetAddress> backends,
+             std::string name,
+             TcpServer::Option option = TcpServer::Option::kNoReusePort);
+    ~RpcProxy();
+
+    // Before start()
+    void setThreadNum(size_t numThreads) noexcept { server_.setThreadNum(numThreads); }
+    void setKeyExtractor(KeyExtractor extractor) noexcept { keyExtractor_ = std::move(extractor); }
+    void setConnectionsPerBackend(size_t n) noexcept { connectionsPerBackend_ = std::max<size_t>(n, 1); }
+    void setLoadFactor(double factor) noexcept { loadFactor_ = std::max(factor, 1.0); }
+    void setCallTimeout(double seconds) noexcept { callTimeout_ = std::max(seconds, 0.001); }
+    // Runs on each IO loop after the proxy's own per-loop setup
+    template<typename F>
+    void setThreadInitCallback(F&& cb) noexcept {
+        threadInitCallback_ = std::forward<F>(cb);
+    }
+    // Do not replace its thread init callback; use the one above
+    [[nodiscard]] TcpServer& tcpServer() noexcept { return server_; }
+
+    void start();
+
+private:
+    struct PendingCall {
+        TcpConnectionPtr client;
+        uint64_t callId;
+        size_t backend;
+        TcpConnection* upstream;
+    };
+
+    // Bytes for several connections, collected during one callback and sent once each
+    class OutputBatch {
+    public:
+        std::string& to(const TcpConnectionPtr& conn);
+        void flush();
+
+    private:
+        std::vector<std::pair<TcpConnectionPtr, std::string>> entries_;
+        std::unordered_map<TcpConnection*, size_t> index_;
+    };
+
+    // Everything a loop uses to forward; touched by that loop only
+    struct LoopState {
+        std::vector<std::vector<std::unique_ptr<TcpClient>>> clients;   // [backend][i]
+        std::vector<std::vector<TcpConnectionPtr>> upstreams;           // connected ones, [backend][j]
+        std::vector<size_t> nextUpstream;
+        std::vector<size_t> inFlight;
+        size_t totalInFlight{0};
+        uint64_t nextCallId{1};
+        std::unordered_map<uint64_t, PendingCall> pending;
+        // (deadline, proxy call id) in issue order; answered ids are skipped when swept
+        std::deque<std::pair<Timestamp, uint64_t>> deadlines;
+        TimerId sweepTimer;
+        OutputBatch output;
+    };
+
+    void initLoop(EventLoop* ioLoop);
+    void expireCalls(LoopState* state);
+    void onClientMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp receiveTime);
+    void onUpstreamConnection(LoopState* state, size_t backend, const TcpConnectionPtr& conn);
+    void onUpstreamMessage(LoopState* state, const TcpConnectionPtr& conn, Buffer* buf);
+    // Backend for key, or npos when none is up
+    size_t pickBackend(const LoopState& state, std::string_view key) const noexcept;
+    void buildRing();
+
+    // Filled by initLoop() while server_ starts its loops (one at a time), fixed
+    // before it listens; emptied on each loop by ~RpcProxy(), before server_ stops them
+    std::unordered_map<EventLoop*, std::unique_ptr<LoopState>> loopStates_;
+    TcpServer server_;
+    const std::string name_;
+    const std::vector<InetAddress> backends_;
+    std::vector<std::pair<uint64_t, size_t>> ring_;   // (hash, backend), sorted
+    KeyExtractor keyExtractor_;
+    size_t connectionsPerBackend_{1};
+    double loadFactor_{1.25};
+    double callTimeout_{kDefaultCallTimeout};
+    std::function<void(EventLoop*)> threadInitCallback_;
+};
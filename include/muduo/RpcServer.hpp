@@ -0,0 +1,89 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "Callbacks.hpp"
+#include "EventLoop.hpp"
+#include "InetAddress.hpp"
+#include "Noncopyable.hpp"
+#include "RpcCodec.hpp"
+#include "TcpServer.hpp"
+
+/*
+ * Request/response RPC on top of TcpServer, many calls in flight per  
+ * connection (see RpcCodec for the frame format).  
+ * 
+ * A handler receives the request payload and a Responder. It may reply  
+ * right away or keep the Responder and reply later from any thread, so  
+ * replies can complete out of order; the call id ties each one to its  
+ * request. The payload view is only valid during the handler call. A reply  
+ * too large for one frame reaches the caller as kTooLarge instead.  
+ * 
+ * Replies are not written one by one: they are appended to the  
+ * connection's session and flushed with a single send() at the end of the  
+ * loop iteration.  
+ * 
+ * The session is the connection's context (TcpConnection::setContext);  
+ * Responders share it, so a late reply outlives the connection safely.  
+ */
+
+class RpcServer : Noncopyable {
+    struct Session;
+
+public:
+    class Responder {
+    public:
+        void reply(std::string_view payload) const;
+        void fail(std::string_view message = {}) const { send(RpcStatus::kHandlerError, message); }
+        [[nodiscard]] uint64_t callId() const noexcept { return callId_; }
+
+    private:
+        friend class RpcServer;
+
+        Responder(std::shared_ptr<Session> session, uint64_t callId) noexcept
+            : session_(std::move(session)), callId_(callId) {}
+        void send(RpcStatus status, std::string_view payload) const;
+
+        std::shared_ptr<Session> session_;
+        uint64_t callId_;
+    };
+
+    using MethodHandler = std::function<void(std::string_view payload, const Responder&)>;
+
+    RpcServer(EventLoop* loop,
+              const InetAddress& listenAddr,
+              std::string name,
+              TcpServer::Option option = TcpServer::Option::kNoReusePort);
+
+    // Before start()
+    void registerMethod(std::string name, MethodHandler handler);
+    void setThreadNum(size_t numThreads) noexcept { server_.setThreadNum(numThreads); }
+    [[nodiscard]] TcpServer& tcpServer() noexcept { return server_; }
+
+    void start() { server_.start(); }
+
+private:
+    struct Session : std::enable_shared_from_this<Session> {
+        std::weak_ptr<TcpConnection> conn;
+        std::string pendingOutput;   // loop thread only
+        bool flushQueued{false};
+
+        void queueReply(uint64_t callId, RpcStatus status, std::string_view payload);
+        void flush();
+    };
+
+    struct StringHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view s) const noexcept { return std::hash<std::string_view>{}(s); }
+    };
+
+    void onConnection(const TcpConnectionPtr& conn);
+    void onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp receiveTime);
+
+    TcpServer server_;
+    std::unordered_map<std::string, MethodHandler, StringHash, std::equal_to<>> methods_;
+};
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "Buffer.hpp"
+#include "Channel.hpp"
+#include "EventLoop.hpp"
+#include "Noncopyable.hpp"
+#include "ShmRing.hpp"
+#include "Timestamp.hpp"
+
+/*
+ * The descriptors one side of a shared-memory link needs: the memfd holding  
+ * both rings, the eventfd this side waits on and the one it rings for the  
+ * peer. createPair() builds both sides; the second one is usually handed to  
+ * another process, either inherited over fork() or with sendOver() /  
+ * receiveFrom() through a unix socket (SCM_RIGHTS).  
+ */
+
+class ShmEndpoint : Noncopyable {
+public:
+    static constexpr size_t kDefaultRingCapacity = 1 << 20;
+
+    ShmEndpoint() noexcept = default;
+    ShmEndpoint(int memfd, int localDoorbell, int peerDoorbell, int side) noexcept
+        : memfd_(memfd), localDoorbell_(localDoorbell), peerDoorbell_(peerDoorbell), side_(side) {}
+    ShmEndpoint(ShmEndpoint&& other) noexcept { swap(other); }
+    ShmEndpoint& operator=(ShmEndpoint&& other) noexcept {
+        ShmEndpoint(std::move(other)).swap(*this);
+        return *this;
+    }
+    ~ShmEndpoint() noexcept;
+
+    [[nodiscard]] static std::pair<ShmEndpoint, ShmEndpoint> createPair(size_t ringCapacity = kDefaultRingCapacity);
+    [[nodiscard]] static ShmEndpoint receiveFrom(int unixSocket);
+    void sendOver(int unixSocket) const;
+
+    [[nodiscard]] bool valid() const noexcept { return memfd_ >= 0; }
+    [[nodiscard]] int memfd() const noexcept { return memfd_; }
+    [[nodiscard]] int localDoorbell() const noexcept { return localDoorbell_; }
+    [[nodiscard]] int peerDoorbell() const noexcept { return peerDoorbell_; }
+    // Side 0 writes ring 1 and reads ring 0, side 1 the other way round
+    [[nodiscard]] int side() const noexcept { return side_; }
+
+private:
+    void swap(ShmEndpoint& other) noexcept {
+        std::swap(memfd_, other.memfd_);
+        std::swap(localDoorbell_, other.localDoorbell_);
+        std::swap(peerDoorbell_, other.peerDoorbell_);
+        std::swap(side_, other.side_);
+    }
+
+    int memfd_{-1};
+    int localDoorbell_{-1};
+    int peerDoorbell_{-1};
+    int side_{0};
+};
+
+/*
+ * A byte-stream connection to a co-located process over a pair of ShmRings,  
+ * for when even an AF_UNIX syscall and copy per message is too much.  
+ * Sending copies straight into the outbound ring; the peer's eventfd is only  
+ * written when its ring was empty before, so a busy peer takes no syscall.  
+ * 
+ * The interface mirrors TcpConnection: the same callback shapes over an  
+ * ShmConnectionPtr, an input Buffer handed to the message callback and  
+ * send()/shutdown(). Handlers written as generic lambdas (auto& conn) run  
+ * unchanged on either transport. Output that does not fit in the ring waits  
+ * in outputBuffer_ until the peer frees space and rings back. One wakeup  
+ * reads about one ring's worth before calling the message callback; if  
+ * more is waiting the connection rings its own doorbell to come back.  
+ * A ring header that does not match the mapping, or positions further  
+ * apart than the capacity, close the connection as a protocol error.  
+ * 
+ * Closing: shutdown() marks the outbound ring closed once it is flushed; a  
+ * side that finds its inbound ring closed and drained closes too. The  
+ * death of the peer process is not detected.  
+ */
+
+class ShmConnection : Noncopyable,
+                      public std::enable_shared_from_this<ShmConnection> {
+public:
+    using ShmConnectionPtr = std::shared_ptr<ShmConnection>;
+    using ConnectionCallback = std::function<void(const ShmConnectionPtr&)>;
+    using MessageCallback = std::function<void(const ShmConnectionPtr&, Buffer*, Timestamp)>;
+    using WriteCompleteCallback = std::function<void(const ShmConnectionPtr&)>;
+    using CloseCallback = std::function<void(const ShmConnectionPtr&)>;
+
+    ShmConnection(EventLoop* loop, std::string name, ShmEndpoint endpoint);
+    ~ShmConnection();
+
+    [[nodiscard]] EventLoop* getLoop() const noexcept { return loop_; }
+    [[nodiscard]] const std::string& name() const noexcept { return name_; }
+    [[nodiscard]] bool connected() const noexcept { return state_ == State::Connected; }
+
+    void send(std::string_view data);
+    void shutdown();
+
+    void setConnectionCallback(ConnectionCallback cb) noexcept { connectionCallback_ = std::move(cb); }
+    void setMessageCallback(MessageCallback cb) noexcept { messageCallback_ = std::move(cb); }
+    void setWriteCompleteCallback(WriteCompleteCallback cb) noexcept { writeCompleteCallback_ = std::move(cb); }
+    void setCloseCallback(CloseCallback cb) noexcept { closeCallback_ = std::move(cb); }
+
+    // Loop thread; starts watching the doorbell
+    void connectEstablished();
+
+private:
+    enum class State : uint8_t { Connecting, Connected, Disconnecting, Disconnected };
+
+    void handleDoorbell(Timestamp receiveTime);
+    void sendInLoop(const char* data, size_t len);
+    void shutdownInLoop();
+    bool flushOutput();
+    void ringPeer() const noexcept;
+    void handleClose();
+    void connectDestroyed();
+
+    EventLoop* loop_;
+    const std::string name_;
+    ShmEndpoint endpoint_;
+    void* region_;
+    size_t regionSize_;
+    ShmRing inbox_;
+    ShmRing outbox_;
+    std::unique_ptr<Channel> channel_;
+    std::atomic<State> state_;
+    bool shutdownPending_;
+
+    Buffer inputBuffer_;
+    Buffer outputBuffer_;
+
+    ConnectionCallback connectionCallback_;
+    MessageCallback messageCallback_;
+    WriteCompleteCallback writeCompleteCallback_;
+    CloseCallback closeCallback_;
+};
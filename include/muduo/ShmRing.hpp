@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "Buffer.hpp"
+
+/*
+ * Single-producer/single-consumer byte ring placed in memory shared by two  
+ * processes. The header keeps monotonically increasing byte positions  
+ * (head written by the producer, tail by the consumer) on separate cache  
+ * lines; the data area follows, its size a power of two.  
+ * 
+ * ShmRing itself owns nothing: it is a view over a region set up once with  
+ * initialize(). Wakeups are left to the caller:  
+ * - write() reports when the consumer had drained everything before, i.e.  
+ *   may be idle and needs a doorbell; a busy consumer is never signalled  
+ * - readInto() reports when the producer asked (requestSpace()) to be  
+ *   signalled once room frees up  
+ * Both rely on seq_cst publish-then-check so no wakeup is lost.  
+ * 
+ * The header is writable by the peer, so positions read from it are  
+ * checked: a head/tail distance beyond the capacity makes write() and  
+ * readInto() return kProtocolError instead of copying out of bounds.  
+ */
+
+class ShmRing {
+public:
+    static constexpr size_t kProtocolError = static_cast<size_t>(-1);
+
+    [[nodiscard]] static size_t roundCapacity(size_t capacity) noexcept;
+    [[nodiscard]] static size_t regionSize(size_t capacity) noexcept;
+    static void initialize(void* region, size_t capacity) noexcept;
+
+    explicit ShmRing(void* region = nullptr) noexcept;
+
+    // Whether a region of regionSize bytes holds a ring whose header agrees with it
+    [[nodiscard]] static bool validate(const void* region, size_t regionSize) noexcept;
+
+    // Producer side; returns the number of bytes copied in, or kProtocolError
+    size_t write(const char* data, size_t len, bool& notifyConsumer) noexcept;
+    void requestSpace() noexcept;
+    void close() noexcept;
+
+    // Consumer side; appends everything readable to buf, or returns kProtocolError
+    size_t readInto(Buffer& buf, bool& notifyProducer);
+    [[nodiscard]] bool empty() const noexcept;
+    [[nodiscard]] bool closed() const noexcept;
+
+    [[nodiscard]] size_t capacity() const noexcept { return capacity_; }
+
+private:
+    struct Header {
+        alignas(64) std::atomic<uint64_t> head;
+        alignas(64) std::atomic<uint64_t> tail;
+        alignas(64) std::atomic<uint32_t> producerWaiting;
+        std::atomic<uint32_t> closed;
+        uint64_t capacity;
+    };
+
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared rings need address-free atomics");
+
+    Header* header_;
+    char* data_;
+    size_t capacity_;
+    size_t mask_;
+};
@@ -32,10 +32,7 @@ public:
     [[nodiscard]] int fd() const noexcept { return sockfd_; }
 
     void bindAddress(const InetAddress& localaddr) {
-        const auto* addr = localaddr.getSockAddr();
-        if (::bind(sockfd_, 
-                  reinterpret_cast<const sockaddr*>(addr),
-                  sizeof(sockaddr_in)) != 0)
+        if (::bind(sockfd_, localaddr.sockAddr(), localaddr.sockLen()) != 0)
         {
             LOG_FATAL("Bind failed on fd: %d", sockfd_);
         }
@@ -49,7 +46,7 @@ public:
     }
 
     int accept(InetAddress* peeraddr) noexcept {
-        sockaddr_in addr{};
+        sockaddr_storage addr{};
         socklen_t len = sizeof(addr);
         
         const int connfd = ::accept4(sockfd_,
@@ -58,7 +55,7 @@ public:
                                     SOCK_NONBLOCK | SOCK_CLOEXEC);
         if (connfd >= 0)
         {
-            peeraddr->setSockAddr(addr);
+            peeraddr->setSockAddr(reinterpret_cast<const sockaddr*>(&addr), len);
         }
         return connfd;
     }
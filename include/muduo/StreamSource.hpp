@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+
+#include "Buffer.hpp"
+
+/*
+ * Pull-based producer for responses too large to hand to send() at once.  
+ * TcpConnection::sendStream() keeps asking produce() for more whenever its  
+ * output buffer drains below the stream's low-water mark, so a stream of any  
+ * length holds at most about two low-water marks of memory.  
+ * 
+ * produce() runs on the connection's loop thread:  
+ * - appends at most maxBytes to out and returns true while more will follow  
+ * - returns false once the stream is finished (out may still get a tail)  
+ * - returning true without appending means "nothing ready yet": pumping  
+ *   stops until the producer calls TcpConnection::resumeStream()  
+ * cancel() is called instead of further produce() calls when the  
+ * connection closes before the stream finished.  
+ */
+
+class StreamSource {
+public:
+    virtual ~StreamSource() = default;
+
+    virtual bool produce(Buffer& out, size_t maxBytes) = 0;
+    virtual void cancel() noexcept {}
+};
+
+using StreamSourcePtr = std::shared_ptr<StreamSource>;
@@ -0,0 +1,199 @@
+#pragma once
+
+#include <atomic>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+
+#include "Callbacks.hpp"
+#include "Connector.hpp"
+#include "EventLoop.hpp"
+#include "InetAddress.hpp"
+#include "Logger.hpp"
+#include "Noncopyable.hpp"
+#include "TcpConnection.hpp"
+
+/*
+ * Client-side counterpart of TcpServer, owning at most one connection:  
+ * - Connector     : Performs the non-blocking connect with retry backoff  
+ * - connection_   : The established TcpConnection, living on loop_  
+ * 
+ * With enableRetry() a connection that closes while the client still wants  
+ * to be connected is re-established through Connector::restart().  
+ * 
+ * Destruction may happen on any thread; off the loop thread the destructor  
+ * waits until loop_ has detached the connection from this client, so loop_  
+ * must still be running. No callback runs once the destructor returns: the  
+ * connection still closing gracefully reports nothing more.  
+ */  
+
+class TcpClient : Noncopyable {
+public:
+    // Seconds a torn-down connection waits for the peer to close before it is forced
+    static constexpr double kShutdownTimeout = 5.0;
+
+    TcpClient(EventLoop* loop, const InetAddress& serverAddr, std::string name)
+        : loop_(loop),
+          connector_(std::make_shared<Connector>(loop, serverAddr)),
+          name_(std::move(name)),
+          namePrefix_(std::make_shared<const std::string>(name_ + "-" + serverAddr.toIpPort())),
+          retry_(false),
+          connect_(false),
+          nextConnId_(1) {
+        connector_->setNewConnectionCallback([this](int sockfd) { newConnection(sockfd); });
+    }
+
+    ~TcpClient() {
+        if (loop_->isInLoopThread()) {
+            teardownInLoop();
+        } else {
+            std::promise<void> done;
+            loop_->queueInLoop([this, &done] {
+                teardownInLoop();
+                done.set_value();
+            });
+            done.get_future().wait();
+        }
+    }
+
+    void connect() {
+        LOG_DEBUG("TcpClient[{}] connecting to {}", name_, connector_->serverAddress().toIpPort());
+        connect_ = true;
+        connector_->start();
+    }
+
+    // Half-closes the current connection; no reconnect follows
+    void disconnect() {
+        connect_ = false;
+        if (TcpConnectionPtr conn = connection()) {
+            conn->shutdown();
+        }
+    }
+
+    // Gives up a connect attempt in progress or a pending retry
+    void stop() {
+        connect_ = false;
+        connector_->stop();
+    }
+
+    void enableRetry() noexcept { retry_ = true; }
+    // Seconds, see Connector
+    void setRetryDelays(double initial, double max) noexcept { connector_->setRetryDelays(initial, max); }
+
+    [[nodiscard]] TcpConnectionPtr connection() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return connection_;
+    }
+
+    [[nodiscard]] EventLoop* getLoop() const noexcept { return loop_; }
+    [[nodiscard]] bool retry() const noexcept { return retry_; }
+    [[nodiscard]] const std::string& name() const noexcept { return name_; }
+
+    template<typename F>
+    void setConnectionCallback(F&& cb) noexcept {
+        connectionCallback_ = std::forward<F>(cb);
+    }
+
+    template<typename F>
+    void setMessageCallback(F&& cb) noexcept {
+        messageCallback_ = std::forward<F>(cb);
+    }
+
+    template<typename F>
+    void setWriteCompleteCallback(F&& cb) noexcept {
+        writeCompleteCallback_ = std::forward<F>(cb);
+    }
+
+private:
+    void newConnection(int sockfd) {
+        sockaddr_storage local{};
+        sockaddr_storage peer{};
+        socklen_t localLen = sizeof(local);
+        socklen_t peerLen = sizeof(peer);
+        if (::getsockname(sockfd, reinterpret_cast<sockaddr*>(&local), &localLen) != 0 ||
+            ::getpeername(sockfd, reinterpret_cast<sockaddr*>(&peer), &peerLen) != 0) {
+            LOG_ERROR("Failed to get addresses for fd: {}", sockfd);
+            ::close(sockfd);
+            return;
+        }
+
+        TcpConnectionPtr conn = std::make_shared<TcpConnection>(
+            loop_, nextConnId_++, namePrefix_, sockfd,
+            InetAddress(reinterpret_cast<const sockaddr*>(&local), localLen),
+            InetAddress(reinterpret_cast<const sockaddr*>(&peer), peerLen)
+        );
+
+        conn->setConnectionCallback(connectionCallback_);
+        conn->setMessageCallback(messageCallback_);
+        conn->setWriteCompleteCallback(writeCompleteCallback_);
+        conn->setCloseCallback([this](const auto& c) { removeConnection(c); });
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            connection_ = conn;
+        }
+        conn->connectEstablished();
+    }
+
+    void removeConnection(const TcpConnectionPtr& conn) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (connection_ == conn) {
+                connection_.reset();
+            }
+        }
+        loop_->queueInLoop([conn] { conn->connectDestroyed(); });
+
+        if (retry_ && connect_) {
+            LOG_DEBUG("TcpClient[{}] reconnecting to {}", name_, connector_->serverAddress().toIpPort());
+            connector_->restart();
+        }
+    }
+
+    // The connection is shut down gracefully, so output already sent still
+    // reaches the peer. A loop timer owns it until the peer has closed it, and
+    // forces the close after kShutdownTimeout; if the loop goes away first the
+    // timer is dropped with it. None of its callbacks point into this client or
+    // its owner any more. connectDestroyed() is queued, so a teardown from
+    // inside one of the connection's own callbacks never frees it under that event
+    void teardownInLoop() {
+        connect_ = false;
+        connector_->stop();
+
+        TcpConnectionPtr conn;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            conn.swap(connection_);
+        }
+        if (!conn) {
+            return;
+        }
+        // The callbacks are swapped out, not destroyed here: the teardown may
+        // run inside one of them
+        loop_->queueInLoop([retired = std::exchange(conn->handler(), CallbackHandler{})] {});
+        conn->setCloseCallback([](const TcpConnectionPtr& c) {
+            c->getLoop()->queueInLoop([c] {
+                c->setCloseCallback(nullptr);
+                c->connectDestroyed();
+            });
+        });
+        conn->shutdown();
+        loop_->runAfter(kShutdownTimeout, [conn] { conn->forceClose(); });
+    }
+
+    EventLoop* loop_;
+    std::shared_ptr<Connector> connector_;
+    const std::string name_;
+    const std::shared_ptr<const std::string> namePrefix_;
+    std::atomic_bool retry_;
+    std::atomic_bool connect_;
+    uint64_t nextConnId_;   // loop thread only
+
+    mutable std::mutex mutex_;
+    TcpConnectionPtr connection_;
+
+    ConnectionCallback connectionCallback_;
+    MessageCallback messageCallback_;
+    WriteCompleteCallback writeCompleteCallback_;
+};
@@ -1,20 +1,35 @@
 #pragma once
 
+#include <algorithm>
 #include <atomic>
+#include <limits>
+#include <coroutine>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <system_error>
 #include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include <sys/uio.h>
 
 #include "Buffer.hpp"
 #include "Callbacks.hpp"
 #include "Channel.hpp"
 #include "EventLoop.hpp"
+#include "FramePool.hpp"
 #include "InetAddress.hpp"
 #include "Logger.hpp"
 #include "Noncopyable.hpp"
 #include "Socket.hpp"
+#include "StreamSource.hpp"
 #include "Timestamp.hpp"
+#include "TokenBucket.hpp"
+#include "WorkStealingPool.hpp"
 
 /*
  * Represents a connected client with a TcpConnection object, all residing in subloops.  
@@ -26,11 +41,159 @@
  * - InputBuffer & OutputBuffer  
  * - Connection state  
  * - Callback functions  
+ * 
+ * migrateTo() moves a live connection to another loop: the source loop  
+ * deregisters the fd, the buffers travel with the object and the target loop  
+ * re-registers it. Work queued on the old loop afterwards is forwarded.  
+ * 
+ * offload() runs a CPU-heavy handler on a WorkStealingPool; its result is  
+ * posted back to the owning loop and sent in the order offload() was called.  
+ * 
+ * Read-side flow control: stopRead()/startRead() pause and resume EPOLLIN  
+ * interest. With setReadBackpressure(high, low) the connection also stops  
+ * reading by itself while outputBuffer_ holds more than `high` bytes and  
+ * resumes once it drains to `low`, so a fast sender cannot grow the buffers  
+ * without bound. Each pause reason is tracked separately; reading resumes  
+ * only when none is left.  
+ * 
+ * Rate limiting: ingress bytes, egress bytes and message dispatches are  
+ * charged to token buckets, per connection and optionally server-wide.  
+ * An empty bucket pauses read or write interest and a loop timer restores  
+ * it once tokens are back, so a throttled connection never busy-polls.  
+ * Like writes, reads are capped at the byte budget left (waiting for at  
+ * least a 1 KiB chunk), so a throttled stream arrives evenly rather than  
+ * in 64 KiB bursts followed by long pauses.  
+ * 
+ * With a shed callback installed, a read that waited too long while the  
+ * owning loop is overloaded (see CoDelController::shouldShedRequest) goes  
+ * to shedCallback_ instead of messageCallback_ (e.g. to answer "busy" and  
+ * drop the request).  
+ * 
+ * Streaming: sendStream() attaches a StreamSource that is pulled for more  
+ * data whenever pending output drains below its low-water mark (256 KiB by  
+ * default), keeping memory bounded for responses of any size. Don't mix  
+ * send() with an active stream, the bytes would interleave. A shared  
+ * payload (broadcast) queued meanwhile goes out between two stream chunks,  
+ * never ahead of data the stream produced before it. A shutdown() waits  
+ * for the stream to finish; a close cancels it.  
+ * 
+ * Shared payloads: sendShared() queues a refcounted immutable payload (e.g.  
+ * one broadcast message going to thousands of connections) without copying  
+ * it. Whatever the socket does not take right away stays queued behind  
+ * outputBuffer_ as a reference into the payload and is written with  
+ * writev(); a plain send() issued meanwhile is queued behind it.  
+ * 
+ * Raw mode: with setRawIoCallbacks() the connection stops reading and  
+ * writing by itself and only reports readiness of its fd, for relays that  
+ * move bytes between sockets without user-space buffers (see TcpProxy).  
+ * The owner drives interest through setRawInterest().  
+ * 
+ * Coroutine handlers (see Coroutine.hpp) use the awaitables below instead of  
+ * messageCallback_: while a read is awaited, incoming bytes go to the  
+ * waiting coroutine; both readers and writers are resumed with a failure  
+ * result when the connection closes. A write suspends while more than the  
+ * write resume mark (64 KiB by default, independent of the high-water  
+ * mark callback) is pending, so a coroutine producer is paced by the peer.  
+ * 
+ * Layout: the Socket and Channel are embedded, so one allocation holds the  
+ * whole connection. The object is cache-line aligned and its first line  
+ * holds what every event touches: the loop, the state and pause flags, the  
+ * socket fd and the channel's fd and event masks. The buffers, the handler  
+ * and the channel's callbacks follow on the next lines. The id, the name and  
+ * the two addresses (about 270 bytes of sockaddr_storage) are only read for  
+ * logging and come last. TcpServer allocates connections from the owning  
+ * loop's FramePool, so accept/close churn recycles the same blocks.  
+ * 
+ * Lifetime: the owner (TcpServer's shard, TcpClient) holds the connection  
+ * while it is registered with its loop and lets go of it only through a  
+ * connectDestroyed() queued on that loop, which runs after the event being  
+ * dispatched. That is what keeps the connection alive during its own  
+ * events, so its channel is not tied and events cost no weak_ptr lock.  
+ * A Handler with onBorrowedMessage() (with CallbackHandler: a borrowed  
+ * message callback) gets the connection by reference and touches no  
+ * refcount at all; it calls shared_from_this() only to retain it. Plain  
+ * onMessage() gets a shared_ptr made for the call.  
+ * 
+ * Context: setContext<T>() attaches one object of any type to the  
+ * connection (one allocation) and getContext<T>() finds it again with a  
+ * pointer comparison, so per-connection application state needs no side  
+ * table. It is destroyed in connectDestroyed() or with the connection.  
+ * 
+ * Handler: connection, message and write-complete events are delivered to  
+ * a Handler object held by value and called directly, so its methods can be  
+ * inlined. TcpConnection uses CallbackHandler, which forwards to the  
+ * std::function callbacks set through setConnectionCallback() and friends.  
+ * A custom Handler (see BasicTcpServer in TcpServer.hpp) provides  
+ *     void onConnection(const Ptr& conn);  
+ *     void onMessage(const Ptr& conn, Buffer* buf, Timestamp receiveTime);  
+ *     void onWriteComplete(const Ptr& conn);   // optional  
+ *     void onBorrowedMessage(Connection& conn, Buffer* buf, Timestamp t);   // optional  
+ * where Ptr is std::shared_ptr<BasicTcpConnection<Handler>>; taking the  
+ * connection as `const auto&` avoids naming the still incomplete type.  
+ * 
+ * TcpConnection itself is a final class deriving from the CallbackHandler  
+ * instantiation, so user code can keep forward-declaring it. The second  
+ * template argument names that derived class: Ptr, shared_from_this() and  
+ * every callback then use std::shared_ptr<TcpConnection>.  
  */  
 
-class TcpConnection : Noncopyable,
-                      public std::enable_shared_from_this<TcpConnection> {
+// The type-erased default Handler: one std::function per event
+struct CallbackHandler {
+    void onConnection(const TcpConnectionPtr& conn) const {
+        if (connectionCallback) connectionCallback(conn);
+    }
+
+    void onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp receiveTime) const {
+        if (messageCallback) messageCallback(conn, buf, receiveTime);
+    }
+
+    void onBorrowedMessage(TcpConnection& conn, Buffer* buf, Timestamp receiveTime) const {
+        borrowedMessageCallback(conn, buf, receiveTime);
+    }
+
+    // A borrowed callback, when set, replaces messageCallback
+    [[nodiscard]] bool wantsBorrowedMessage() const noexcept {
+        return static_cast<bool>(borrowedMessageCallback);
+    }
+
+    void onWriteComplete(const TcpConnectionPtr& conn) const {
+        writeCompleteCallback(conn);
+    }
+
+    // Without a callback there is no point in queueing the notification
+    [[nodiscard]] bool wantsWriteComplete() const noexcept {
+        return static_cast<bool>(writeCompleteCallback);
+    }
+
+    ConnectionCallback connectionCallback;
+    MessageCallback messageCallback;
+    BorrowedMessageCallback borrowedMessageCallback;
+    WriteCompleteCallback writeCompleteCallback;
+};
+
+template<typename Handler, typename Derived = void>
+class BasicTcpConnection;
+
+// The most derived connection type: what shared_from_this() and callbacks see
+template<typename Handler, typename Derived>
+using BasicTcpConnectionSelf =
+    std::conditional_t<std::is_void_v<Derived>, BasicTcpConnection<Handler, Derived>, Derived>;
+
+template<typename Handler, typename Derived>
+class alignas(FramePool::kBlockAlignment) BasicTcpConnection : Noncopyable,
+                           public std::enable_shared_from_this<BasicTcpConnectionSelf<Handler, Derived>> {
 public:
+    using Connection = BasicTcpConnectionSelf<Handler, Derived>;
+    using Ptr = std::shared_ptr<Connection>;
+    using CloseCallback = std::function<void(const Ptr&)>;
+    using HighWaterMarkCallback = std::function<void(const Ptr&, size_t)>;
+    // Receives a request instead of the message handler while the owning loop is shedding load
+    using ShedCallback = std::function<void(const Ptr&, Buffer*, Timestamp)>;
+    // Runs once a migration is over; false if the connection did not move
+    using MigrateCallback = std::function<void(const Ptr&, bool)>;
+    // attached == false on the source loop before a migration, true on the target loop after it
+    using LoopChangeCallback = std::function<void(const Ptr&, bool)>;
+
     enum class State : uint8_t {
         Disconnected,
         Connecting,
@@ -38,69 +201,238 @@ public:
         Disconnecting
     };
 
-    TcpConnection(EventLoop* loop,
-                  std::string name,
-                  int sockfd,
-                  InetAddress localAddr,
-                  InetAddress peerAddr)
+    static constexpr size_t kDefaultStreamLowWaterMark = 256 * 1024;
+    static constexpr size_t kDefaultWriteResumeMark = 64 * 1024;
+
+    enum ReadPauseReason : uint8_t {
+        kPausedByUser = 1 << 0,
+        kPausedByBackpressure = 1 << 1,
+        kPausedByRateLimit = 1 << 2
+    };
+
+    class ReadAwaiter {
+    public:
+        ReadAwaiter(BasicTcpConnection* conn, size_t count, std::string_view delimiter) noexcept
+            : conn_(conn), count_(count), delimiter_(delimiter) {}
+
+        bool await_ready() { return conn_->tryCompleteRead(*this); }
+        void await_suspend(std::coroutine_handle<> handle) noexcept {
+            handle_ = handle;
+            conn_->readWaiter_ = this;
+        }
+        // std::nullopt once the connection closed before the read could complete
+        std::optional<std::string> await_resume() noexcept { return std::move(result_); }
+
+    private:
+        friend BasicTcpConnection;
+
+        BasicTcpConnection* conn_;
+        size_t count_;
+        std::string delimiter_;
+        std::optional<std::string> result_;
+        std::coroutine_handle<> handle_;
+    };
+
+    class WriteAwaiter {
+    public:
+        WriteAwaiter(BasicTcpConnection* conn, std::string_view data) noexcept
+            : conn_(conn), data_(data) {}
+
+        bool await_ready() {
+            if (!conn_->connected()) {
+                ok_ = false;
+                return true;
+            }
+            conn_->sendInLoop(data_.data(), data_.size());
+            return conn_->pendingOutputBytes() < conn_->writeResumeMark_;
+        }
+        void await_suspend(std::coroutine_handle<> handle) noexcept {
+            handle_ = handle;
+            conn_->writeWaiter_ = this;
+        }
+        // false when the connection was closed before the data could drain
+        bool await_resume() const noexcept { return ok_; }
+
+    private:
+        friend BasicTcpConnection;
+
+        BasicTcpConnection* conn_;
+        std::string_view data_;
+        bool ok_{true};
+        std::coroutine_handle<> handle_;
+    };
+
+    BasicTcpConnection(EventLoop* loop,
+                       uint64_t id,
+                       std::shared_ptr<const std::string> namePrefix,
+                       int sockfd,
+                       InetAddress localAddr,
+                       InetAddress peerAddr)
         : loop_(assertLoopNotNull(loop)),
-          name_(std::move(name)),
           state_(State::Connecting),
-          socket_(std::make_unique<Socket>(sockfd)),
-          channel_(std::make_unique<Channel>(loop, sockfd)),
+          socket_(sockfd),
+          channel_(loop, sockfd),
+          id_(id),
+          namePrefix_(std::move(namePrefix)),
           localAddr_(std::move(localAddr)),
           peerAddr_(std::move(peerAddr)) {
 
         configureSocketOptions();
         setupChannelCallbacks();
-        LOG_DEBUG("TcpConnection[{}] constructed at fd={}", name_, sockfd);
+        LOG_DEBUG("TcpConnection[{}] constructed at fd={}", name(), sockfd);
     }
 
-    ~TcpConnection() {
+    ~BasicTcpConnection() {
         LOG_DEBUG("TcpConnection[{}] destroyed fd={} state={}",
-                 name_, channel_->fd(), toString(state_));
+                 name(), channel_.fd(), toString(state_));
+        // An owner that never called connectDestroyed(), or a loop destroyed
+        // while the connection was still closing: the poller must not keep a
+        // pointer to the embedded channel
+        if (channel_.isRegistered()) {
+            LOG_DEBUG("TcpConnection[{}] destroyed while registered", name());
+            channel_.disableAll();
+            channel_.remove();
+        }
+        resetContext();
     }
 
-    EventLoop* getLoop() const noexcept { return loop_; }
-    const std::string& name() const noexcept { return name_; }
+    EventLoop* getLoop() const noexcept { return loop_.load(std::memory_order_acquire); }
+    uint64_t id() const noexcept { return id_; }
+    // "<prefix>#<id>", only formatted the first time somebody asks for it
+    const std::string& name() const {
+        std::call_once(nameOnce_, [this] { name_ = fmt::format("{}#{}", *namePrefix_, id_); });
+        return name_;
+    }
     bool connected() const noexcept { return state_ == State::Connected; }
+    // Closed for good; unlike !connected() not true during a graceful shutdown
+    bool disconnected() const noexcept { return state_ == State::Disconnected; }
 
     void send(std::string_view data) {
         if (state_.load() != State::Connected) {
-            LOG_DEBUG("Attempt to send data on disconnected connection: {}", name_);
+            LOG_DEBUG("Attempt to send data on disconnected connection: {}", name());
             return;
         }
 
-        if (loop_->isInLoopThread()) {
+        EventLoop* loop = getLoop();
+        if (loop->isInLoopThread()) {
             sendInLoop(data.data(), data.size());
         } else {
-            loop_->queueInLoop([this, data = std::string(data)] {
-                sendInLoop(data.data(), data.size());
+            loop->queueInLoop([self = this->shared_from_this(), data = std::string(data)] {
+                self->sendInLoop(data.data(), data.size());
             });
         }
     }
 
 	const InetAddress& peerAddress() const { return peerAddr_; } 
 
+    void sendStream(StreamSourcePtr source, size_t lowWaterMark = kDefaultStreamLowWaterMark) {
+        getLoop()->runInLoop([self = this->shared_from_this(), source = std::move(source), lowWaterMark]() mutable {
+            self->startStreamInLoop(std::move(source), lowWaterMark);
+        });
+    }
+
+    // For a StreamSource that returned without data: its next data is ready
+    void resumeStream() {
+        getLoop()->runInLoop([self = this->shared_from_this()] { self->pumpStream(); });
+    }
+
+    // The payload is referenced, not copied, until it has been written
+    void sendShared(SharedPayload payload) {
+        if (state_.load() != State::Connected || !payload || payload->empty()) {
+            return;
+        }
+
+        EventLoop* loop = getLoop();
+        if (loop->isInLoopThread()) {
+            sendInLoop(payload->data(), payload->size(), &payload);
+        } else {
+            loop->queueInLoop([self = this->shared_from_this(), payload = std::move(payload)] {
+                self->sendInLoop(payload->data(), payload->size(), &payload);
+            });
+        }
+    }
+
+    // Closes right away, dropping output that has not been written yet
+    void forceClose() {
+        const State state = state_.load();
+        if (state == State::Connected || state == State::Disconnecting) {
+            getLoop()->queueInLoop([self = this->shared_from_this()] { self->forceCloseInLoop(); });
+        }
+    }
+
     void shutdown() noexcept {
         if (state_.exchange(State::Disconnecting) == State::Connected) {
-            loop_->runInLoop([this] { shutdownInLoop(); });
+            getLoop()->runInLoop([this] { shutdownInLoop(); });
+        }
+    }
+
+    void startRead() {
+        getLoop()->runInLoop([self = this->shared_from_this()] { self->resumeReadingInLoop(kPausedByUser); });
+    }
+
+    void stopRead() {
+        getLoop()->runInLoop([self = this->shared_from_this()] { self->pauseReadingInLoop(kPausedByUser); });
+    }
+
+    // Loop thread only
+    bool isReading() const noexcept { return channel_.isReading(); }
+
+    // The socket, for raw mode; owned by the connection
+    [[nodiscard]] int fd() const noexcept { return channel_.fd(); }
+
+    // Set before any data arrives, e.g. from the connection callback
+    template<typename R, typename W>
+    void setRawIoCallbacks(R&& onReadable, W&& onWritable) noexcept {
+        rawReadCallback_ = std::forward<R>(onReadable);
+        rawWriteCallback_ = std::forward<W>(onWritable);
+    }
+
+    // Raw mode, loop thread only: which readiness events to report
+    void setRawInterest(bool readable, bool writable) {
+        const State state = state_.load();
+        if (state != State::Connected && state != State::Disconnecting) {
+            return;
+        }
+        if (readable != channel_.isReading()) {
+            readable ? channel_.enableReading() : channel_.disableReading();
+        }
+        if (writable != channel_.isWriting()) {
+            writable ? channel_.enableWriting() : channel_.disableWriting();
         }
     }
 
+    // Pause reading above highMark bytes of pending output, resume at lowMark; 0 disables
+    void setReadBackpressure(size_t highMark, size_t lowMark) noexcept {
+        backpressureHighMark_ = highMark;
+        backpressureLowMark_ = std::min(lowMark, highMark);
+    }
+
+    // Set before connectEstablished()
+    void setHandler(Handler handler) noexcept(std::is_nothrow_move_assignable_v<Handler>) {
+        handler_ = std::move(handler);
+    }
+
+    [[nodiscard]] Handler& handler() noexcept { return handler_; }
+
+    // The setters below are only available with CallbackHandler
     template<typename F>
     void setConnectionCallback(F&& cb) noexcept {
-        connectionCallback_ = std::forward<F>(cb);
+        handler_.connectionCallback = std::forward<F>(cb);
     }
 
     template<typename F>
     void setMessageCallback(F&& cb) noexcept {
-        messageCallback_ = std::forward<F>(cb);
+        handler_.messageCallback = std::forward<F>(cb);
+    }
+
+    template<typename F>
+    void setBorrowedMessageCallback(F&& cb) noexcept {
+        handler_.borrowedMessageCallback = std::forward<F>(cb);
     }
 
     template<typename F>
     void setWriteCompleteCallback(F&& cb) noexcept {
-        writeCompleteCallback_ = std::forward<F>(cb);
+        handler_.writeCompleteCallback = std::forward<F>(cb);
     }
 
     template<typename F>
@@ -108,60 +440,242 @@ public:
         closeCallback_ = std::forward<F>(cb);
     }
 
+    template<typename F>
+    void setShedCallback(F&& cb) noexcept {
+        shedCallback_ = std::forward<F>(cb);
+    }
+
+    template<typename F>
+    void setLoopChangeCallback(F&& cb) noexcept {
+        loopChangeCallback_ = std::forward<F>(cb);
+    }
+
     template<typename F>
     void setHighWaterMarkCallback(F&& cb, size_t mark) noexcept {
         highWaterMarkCallback_ = std::forward<F>(cb);
         highWaterMark_.store(mark, std::memory_order_relaxed);
     }
 
+    // Loop thread only. Replaces any previous context; returns the new one
+    template<typename T, typename... Args>
+    T& setContext(Args&&... args) {
+        resetContext();
+        T* context = new T(std::forward<Args>(args)...);
+        context_ = context;
+        contextType_ = &contextTag<T>;
+        contextDeleter_ = [](void* p) noexcept { delete static_cast<T*>(p); };
+        return *context;
+    }
+
+    // nullptr if there is no context or it is not a T
+    template<typename T>
+    [[nodiscard]] T* getContext() const noexcept {
+        return contextType_ == &contextTag<T> ? static_cast<T*>(context_) : nullptr;
+    }
+
+    void resetContext() noexcept {
+        if (void* context = std::exchange(context_, nullptr)) {
+            contextType_ = nullptr;
+            contextDeleter_(context);
+        }
+    }
+
+    // Bytes moved in either direction since the last takeRecentBytes(); used by the rebalancer
+    uint64_t takeRecentBytes() noexcept {
+        return recentBytes_.exchange(0, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] ReadAwaiter readExactly(size_t count) noexcept { return ReadAwaiter(this, count, {}); }
+    // Result includes the delimiter
+    [[nodiscard]] ReadAwaiter readUntil(std::string_view delimiter) noexcept { return ReadAwaiter(this, 0, delimiter); }
+    // Resumes once pending output is below the write resume mark
+    [[nodiscard]] WriteAwaiter write(std::string_view data) noexcept { return WriteAwaiter(this, data); }
+    // Loop thread only; the pending output above which write() suspends (64 KiB by default)
+    void setWriteResumeMark(size_t bytes) noexcept { writeResumeMark_ = std::max<size_t>(bytes, 1); }
+
+    // task returns the bytes to send; runs on a pool worker, never on the loop.
+    // A task that throws sends nothing and does not hold back later results.
+    // The pool runs tasks inline before start() and after stop(), and stop()
+    // finishes the queued ones, so every offload completes in order.
+    template<typename F>
+    void offload(WorkStealingPool& pool, F&& task) {
+        const uint64_t seq = nextOffloadSeq_.fetch_add(1, std::memory_order_relaxed);
+        pool.submit([self = this->shared_from_this(), seq, task = std::forward<F>(task)]() mutable {
+            std::string result;
+            try {
+                result = task();
+            } catch (const std::exception& e) {
+                LOG_ERROR("TcpConnection[{}] offloaded task threw: {}", self->name(), e.what());
+            } catch (...) {
+                LOG_ERROR("TcpConnection[{}] offloaded task threw unknown exception", self->name());
+            }
+            self->getLoop()->runInLoop([self, seq, result = std::move(result)]() mutable {
+                self->completeOffload(seq, std::move(result));
+            });
+        });
+    }
+
+    // Per-connection limits; call before connectEstablished() or from the loop thread
+    void setRateLimits(const RateLimitConfig& config) {
+        ownLimiters_ = RateLimiters::fromConfig(config);
+    }
+
+    // Buckets shared with other connections (server-wide limits)
+    void setSharedRateLimiters(RateLimiters limiters) noexcept {
+        sharedLimiters_ = std::move(limiters);
+    }
+
+    // Always deferred, also on the owning loop: a caller inside one of this
+    // connection's callbacks must not see it leave the loop under its feet
+    void migrateTo(EventLoop* target, MigrateCallback cb = {}) {
+        getLoop()->queueInLoop([self = this->shared_from_this(), target, cb = std::move(cb)]() mutable {
+            self->detachInLoop(target, std::move(cb));
+        });
+    }
+
     void connectEstablished() {
         state_.store(State::Connected);
-        channel_->tie(shared_from_this());
-        channel_->enableReading();
-        if (connectionCallback_) connectionCallback_(shared_from_this());
+        getLoop()->connectionOpened();
+        channel_.enableReading();
+        handler_.onConnection(this->shared_from_this());
     }
 
     void connectDestroyed() {
-        if (state_.exchange(State::Disconnected) == State::Connected) {
-            channel_->disableAll();
-            if (connectionCallback_) connectionCallback_(shared_from_this());
+        if (!getLoop()->isInLoopThread()) {
+            getLoop()->queueInLoop([self = this->shared_from_this()] { self->connectDestroyed(); });
+            return;
+        }
+        const Ptr self = this->shared_from_this();
+        const bool wasConnected = state_.exchange(State::Disconnected) == State::Connected;
+        cancelStream();
+        resumeWaitersOnClose();
+        if (wasConnected) {
+            channel_.disableAll();
+            handler_.onConnection(self);
         }
-        channel_->remove();
+        resetContext();
+        channel_.remove();
+        getLoop()->connectionClosed();
     }
 
 private:
+    // One writable object per type: its address identifies the context type without RTTI
+    template<typename T>
+    static inline char contextTag;
+
     static EventLoop* assertLoopNotNull(EventLoop* loop) {
         if (!loop) LOG_DEBUG("TcpConnection requires valid EventLoop");
         return loop;
     }
 
     void configureSocketOptions() noexcept {
-        socket_->setTcpNoDelay(Socket::ENABLE);
-        socket_->setKeepAlive(Socket::ENABLE);
+        if (localAddr_.isUnix()) {
+            return;
+        }
+        socket_.setTcpNoDelay(Socket::ENABLE);
+        socket_.setKeepAlive(Socket::ENABLE);
     }
 
     void setupChannelCallbacks() noexcept {
-        channel_->setReadCallback([this](Timestamp t) { handleRead(t); });
-        channel_->setWriteCallback([this] { handleWrite(); });
-        channel_->setCloseCallback([this] { handleClose(); });
-        channel_->setErrorCallback([this] { handleError(); });
+        channel_.setReadCallback([this](Timestamp t) { handleRead(t); });
+        channel_.setWriteCallback([this] { handleWrite(); });
+        channel_.setCloseCallback([this] { handleClose(); });
+        channel_.setErrorCallback([this] { handleError(); });
+    }
+
+    void detachInLoop(EventLoop* target, MigrateCallback cb) {
+        EventLoop* source = getLoop();
+        if (!source->isInLoopThread()) {
+            source->queueInLoop([self = this->shared_from_this(), target, cb = std::move(cb)]() mutable {
+                self->detachInLoop(target, std::move(cb));
+            });
+            return;
+        }
+        if (target == source || state_.load() != State::Connected) {
+            if (cb) cb(this->shared_from_this(), false);
+            return;
+        }
+
+        LOG_DEBUG("TcpConnection[{}] migrating fd={} input={} output={}",
+                 name(), channel_.fd(), inputBuffer_.readableBytes(), pendingOutputBytes());
+
+        if (loopChangeCallback_) loopChangeCallback_(this->shared_from_this(), false);
+
+        // Unsent bytes stay in the kernel socket or in the output queue, so nothing is lost
+        channel_.disableAll();
+        channel_.remove();
+        source->connectionClosed();
+        channel_.setOwnerLoop(target);
+        loop_.store(target, std::memory_order_release);
+
+        target->queueInLoop([self = this->shared_from_this(), cb = std::move(cb)] {
+            self->attachInLoop();
+            if (cb) cb(self, true);
+        });
+    }
+
+    void attachInLoop() {
+        getLoop()->connectionOpened();
+        if (loopChangeCallback_) loopChangeCallback_(this->shared_from_this(), true);
+        if (state_.load() == State::Disconnected) {
+            return;
+        }
+        if (readPauseMask_ == 0) {
+            channel_.enableReading();
+        }
+        if (pendingOutputBytes() > 0) {
+            channel_.enableWriting();
+        }
     }
 
-    void sendInLoop(const void* data, size_t len) noexcept {
-        loop_->isInLoopThread();
+    void completeOffload(uint64_t seq, std::string result) {
+        if (!getLoop()->isInLoopThread()) {
+            getLoop()->queueInLoop([self = this->shared_from_this(), seq, result = std::move(result)]() mutable {
+                self->completeOffload(seq, std::move(result));
+            });
+            return;
+        }
+
+        // Hold early finishers until every earlier offload has been sent
+        offloadResults_.emplace(seq, std::move(result));
+        while (!offloadResults_.empty() && offloadResults_.begin()->first == nextOffloadToSend_) {
+            auto node = offloadResults_.extract(offloadResults_.begin());
+            ++nextOffloadToSend_;
+            if (!node.mapped().empty()) send(node.mapped());
+        }
+    }
+
+    // shared: data is that payload's bytes, keep a reference instead of copying the tail
+    void sendInLoop(const void* data, size_t len, const SharedPayload* shared = nullptr) noexcept {
+        EventLoop* loop = getLoop();
+        if (!loop->isInLoopThread()) {
+            // Posted to the previous owner before a migration; follow the connection
+            if (shared) {
+                loop->queueInLoop([self = this->shared_from_this(), payload = *shared] {
+                    self->sendInLoop(payload->data(), payload->size(), &payload);
+                });
+            } else {
+                loop->queueInLoop([self = this->shared_from_this(),
+                                   data = std::string(static_cast<const char*>(data), len)] {
+                    self->sendInLoop(data.data(), data.size());
+                });
+            }
+            return;
+        }
         
         ssize_t nwrote = 0;
         size_t remaining = len;
         bool error = false;
 
-        if (!channel_->isWriting() && outputBuffer_.readableBytes() == 0) {
-            nwrote = ::write(channel_->fd(), data, len);
+        const size_t budget = egressBudget();
+        if (!channel_.isWriting() && pendingOutputBytes() == 0 && budget > 0) {
+            nwrote = ::write(channel_.fd(), data, std::min(len, budget));
             if (nwrote >= 0) {
+                recentBytes_.fetch_add(nwrote, std::memory_order_relaxed);
+                chargeEgress(static_cast<size_t>(nwrote));
                 remaining = len - nwrote;
-                if (remaining == 0 && writeCompleteCallback_) {
-                    loop_->queueInLoop([this] {
-                        writeCompleteCallback_(shared_from_this());
-                    });
+                if (remaining == 0) {
+                    queueWriteComplete();
                 }
             } else {
                 nwrote = 0;
@@ -173,92 +687,461 @@ private:
         }
 
         if (!error && remaining > 0) {
-            const auto oldLen = outputBuffer_.readableBytes();
-            outputBuffer_.append(static_cast<const char*>(data) + nwrote, remaining);
+            const auto oldLen = pendingOutputBytes();
+            const char* tail = static_cast<const char*>(data) + nwrote;
+            if (shared) {
+                sharedTail_.push_back(SharedSegment{*shared, static_cast<size_t>(nwrote)});
+                sharedTailBytes_ += remaining;
+            } else if (!sharedTail_.empty()) {
+                // Keep the byte order: anything sent after a shared payload queues behind it
+                sharedTail_.push_back(SharedSegment{std::make_shared<const std::string>(tail, remaining), 0});
+                sharedTailBytes_ += remaining;
+            } else {
+                outputBuffer_.append(tail, remaining);
+            }
 
             if (oldLen < highWaterMark_ && 
                 (oldLen + remaining) >= highWaterMark_ &&
                 highWaterMarkCallback_) {
-                loop_->queueInLoop([this, total = oldLen + remaining] {
-                    highWaterMarkCallback_(shared_from_this(), total);
+                getLoop()->queueInLoop([self = this->shared_from_this(), total = oldLen + remaining] {
+                    self->highWaterMarkCallback_(self, total);
                 });
             }
 
-            if (!channel_->isWriting()) {
-                channel_->enableWriting();
+            if (!channel_.isWriting() && !egressTimerArmed_) {
+                channel_.enableWriting();
+            }
+
+            if (backpressureHighMark_ > 0 && pendingOutputBytes() > backpressureHighMark_) {
+                pauseReadingInLoop(kPausedByBackpressure);
             }
         }
     }
 
+    void startStreamInLoop(StreamSourcePtr source, size_t lowWaterMark) {
+        if (!getLoop()->isInLoopThread()) {
+            getLoop()->queueInLoop([self = this->shared_from_this(), source = std::move(source), lowWaterMark]() mutable {
+                self->startStreamInLoop(std::move(source), lowWaterMark);
+            });
+            return;
+        }
+        if (state_ != State::Connected) {
+            source->cancel();
+            return;
+        }
+        cancelStream();
+        streamSource_ = std::move(source);
+        streamLowWaterMark_ = std::max<size_t>(lowWaterMark, 1);
+        pumpStream();
+    }
+
+    void pumpStream() {
+        if (!getLoop()->isInLoopThread()) {
+            getLoop()->queueInLoop([self = this->shared_from_this()] { self->pumpStream(); });
+            return;
+        }
+        while (streamSource_ && pendingOutputBytes() < streamLowWaterMark_) {
+            const size_t before = pendingOutputBytes();
+            bool more;
+            if (sharedTail_.empty()) {
+                more = streamSource_->produce(outputBuffer_, streamLowWaterMark_);
+            } else {
+                // outputBuffer_ is written ahead of the shared payloads (a broadcast
+                // sent meanwhile); the stream's bytes must queue behind them
+                Buffer staging;
+                more = streamSource_->produce(staging, streamLowWaterMark_);
+                if (const size_t n = staging.readableBytes(); n > 0) {
+                    sharedTail_.push_back(SharedSegment{
+                        std::make_shared<const std::string>(staging.retrieveAllAsString()), 0});
+                    sharedTailBytes_ += n;
+                }
+            }
+            if (!more) {
+                streamSource_.reset();
+            } else if (pendingOutputBytes() == before) {
+                break;   // nothing ready, wait for resumeStream()
+            }
+        }
+
+        if (pendingOutputBytes() > 0) {
+            if (!channel_.isWriting() && !egressTimerArmed_) {
+                channel_.enableWriting();
+            }
+        } else if (!streamSource_ && state_ == State::Disconnecting) {
+            shutdownInLoop();
+        }
+    }
+
+    void cancelStream() noexcept {
+        if (StreamSourcePtr source = std::exchange(streamSource_, nullptr)) {
+            source->cancel();
+        }
+    }
+
+    void pauseReadingInLoop(uint8_t reason) {
+        if (!getLoop()->isInLoopThread()) {
+            getLoop()->queueInLoop([self = this->shared_from_this(), reason] { self->pauseReadingInLoop(reason); });
+            return;
+        }
+        readPauseMask_ |= reason;
+        if (channel_.isReading()) {
+            LOG_DEBUG("TcpConnection[{}] pause reading (reasons={:#x})", name(), readPauseMask_);
+            channel_.disableReading();
+        }
+    }
+
+    void resumeReadingInLoop(uint8_t reason) {
+        if (!getLoop()->isInLoopThread()) {
+            getLoop()->queueInLoop([self = this->shared_from_this(), reason] { self->resumeReadingInLoop(reason); });
+            return;
+        }
+        readPauseMask_ &= static_cast<uint8_t>(~reason);
+        const State state = state_.load();
+        if (readPauseMask_ == 0 && !channel_.isReading() &&
+            (state == State::Connected || state == State::Disconnecting)) {
+            LOG_DEBUG("TcpConnection[{}] resume reading", name());
+            channel_.enableReading();
+        }
+    }
+
     void shutdownInLoop() noexcept {
-        loop_->isInLoopThread();
-        if (!channel_->isWriting()) {
-            socket_->shutdownWrite();
+        if (!getLoop()->isInLoopThread()) {
+            getLoop()->queueInLoop([self = this->shared_from_this()] { self->shutdownInLoop(); });
+            return;
+        }
+        if (!channel_.isWriting() && !streamSource_) {
+            socket_.shutdownWrite();
         }
     }
 
     void handleRead(Timestamp receiveTime) noexcept {
-        loop_->isInLoopThread();
+        getLoop()->isInLoopThread();
+        if (rawReadCallback_) {
+            rawReadCallback_();
+            return;
+        }
         
+        const size_t budget = ingressBudget();
+        if (budget == 0) {
+            // A shared bucket drained by another connection since we last looked
+            pauseReadingInLoop(kPausedByRateLimit);
+            armRateLimitTimer(ingressWait(), false);
+            return;
+        }
+
         std::error_code ec;
-        const auto n = inputBuffer_.readFd(channel_->fd(), ec);
+        const auto n = inputBuffer_.readFd(channel_.fd(), ec, budget);
         
         if (n > 0) {
-            if (messageCallback_) {
-                messageCallback_(shared_from_this(), &inputBuffer_, receiveTime);
+            recentBytes_.fetch_add(n, std::memory_order_relaxed);
+            chargeIngress(static_cast<size_t>(n));
+            if (readWaiter_) {
+                resumeReaderIfReady();
+            } else if (shedCallback_ && getLoop()->overloadController().shouldShedRequest()) {
+                shedCallback_(this->shared_from_this(), &inputBuffer_, receiveTime);
+            } else {
+                dispatchMessage(receiveTime);
             }
         } else if (n == 0) {
             handleClose();
         } else {
             LOG_ERROR("Read error[{}] on connection {}: {}", 
-                      ec.value(), name_, ec.message());
+                      ec.value(), name(), ec.message());
             handleError();
         }
     }
 
+    // The owner keeps the connection alive for the whole event, see Lifetime
+    void dispatchMessage(Timestamp receiveTime) {
+        if constexpr (requires(Handler& h, Connection& c, Buffer* b, Timestamp t) { h.onBorrowedMessage(c, b, t); }) {
+            bool borrow = true;
+            if constexpr (requires(const Handler& h) { h.wantsBorrowedMessage(); }) {
+                borrow = handler_.wantsBorrowedMessage();
+            }
+            if (borrow) {
+                handler_.onBorrowedMessage(static_cast<Connection&>(*this), &inputBuffer_, receiveTime);
+                return;
+            }
+        }
+        handler_.onMessage(this->shared_from_this(), &inputBuffer_, receiveTime);
+    }
+
     void handleWrite() noexcept {
-        loop_->isInLoopThread();
+        getLoop()->isInLoopThread();
+        if (rawWriteCallback_) {
+            rawWriteCallback_();
+            return;
+        }
         
-        if (channel_->isWriting()) {
+        if (channel_.isWriting()) {
+            const size_t budget = egressBudget();
+            if (budget == 0) {
+                channel_.disableWriting();
+                armRateLimitTimer(egressWait(), true);
+                return;
+            }
+
             std::error_code ec;
-            const auto n = outputBuffer_.writeFd(channel_->fd(), ec);
+            const auto n = sharedTail_.empty() ? outputBuffer_.writeFd(channel_.fd(), ec, budget)
+                                               : writeWithSharedTail(ec, budget);
             
             if (n > 0) {
-                outputBuffer_.retrieve(n);
-                if (outputBuffer_.readableBytes() == 0) {
-                    channel_->disableWriting();
-                    if (writeCompleteCallback_) {
-                        loop_->queueInLoop([this] {
-                            writeCompleteCallback_(shared_from_this());
-                        });
-                    }
-                    if (state_ == State::Disconnecting) {
+                recentBytes_.fetch_add(n, std::memory_order_relaxed);
+                chargeEgress(static_cast<size_t>(n));
+                retrieveOutput(static_cast<size_t>(n));
+                if ((readPauseMask_ & kPausedByBackpressure) &&
+                    pendingOutputBytes() <= backpressureLowMark_) {
+                    resumeReadingInLoop(kPausedByBackpressure);
+                }
+                if (writeWaiter_ && pendingOutputBytes() < writeResumeMark_) {
+                    std::exchange(writeWaiter_, nullptr)->handle_.resume();
+                }
+                if (streamSource_ && pendingOutputBytes() < streamLowWaterMark_) {
+                    pumpStream();
+                }
+                if (pendingOutputBytes() == 0) {
+                    channel_.disableWriting();
+                    queueWriteComplete();
+                    if (state_ == State::Disconnecting && !streamSource_) {
                         shutdownInLoop();
                     }
                 }
             } else {
                 LOG_ERROR("Write error[{}] on connection {}: {}",
-                         ec.value(), name_, ec.message());
+                         ec.value(), name(), ec.message());
             }
         }
     }
 
+    // Handlers without onWriteComplete() never pay for the queued notification
+    void queueWriteComplete() {
+        if constexpr (requires(Handler& h, const Ptr& conn) { h.onWriteComplete(conn); }) {
+            if constexpr (requires(const Handler& h) { h.wantsWriteComplete(); }) {
+                if (!handler_.wantsWriteComplete()) return;
+            }
+            getLoop()->queueInLoop([self = this->shared_from_this()] { self->handler_.onWriteComplete(self); });
+        }
+    }
+
+    [[nodiscard]] size_t pendingOutputBytes() const noexcept {
+        return outputBuffer_.readableBytes() + sharedTailBytes_;
+    }
+
+    // One writev() of outputBuffer_ followed by as many shared segments as fit
+    ssize_t writeWithSharedTail(std::error_code& ec, size_t maxBytes) noexcept {
+        iovec iov[kMaxWriteIov];
+        int count = 0;
+        size_t total = 0;
+        auto add = [&](const char* base, size_t len) {
+            len = std::min(len, maxBytes - total);
+            iov[count].iov_base = const_cast<char*>(base);
+            iov[count].iov_len = len;
+            ++count;
+            total += len;
+        };
+        if (outputBuffer_.readableBytes() > 0) {
+            add(outputBuffer_.peek(), outputBuffer_.readableBytes());
+        }
+        for (size_t i = sharedTailHead_; i < sharedTail_.size(); ++i) {
+            if (count == kMaxWriteIov || total == maxBytes) break;
+            const SharedSegment& segment = sharedTail_[i];
+            add(segment.payload->data() + segment.offset, segment.payload->size() - segment.offset);
+        }
+
+        const ssize_t n = ::writev(channel_.fd(), iov, count);
+        if (n < 0) {
+            ec.assign(errno, std::system_category());
+            return -1;
+        }
+        return n;
+    }
+
+    void retrieveOutput(size_t n) noexcept {
+        const size_t fromBuffer = std::min(n, outputBuffer_.readableBytes());
+        outputBuffer_.retrieve(fromBuffer);
+        n -= fromBuffer;
+        while (n > 0) {
+            SharedSegment& segment = sharedTail_[sharedTailHead_];
+            const size_t left = segment.payload->size() - segment.offset;
+            const size_t taken = std::min(n, left);
+            segment.offset += taken;
+            sharedTailBytes_ -= taken;
+            n -= taken;
+            if (taken == left) {
+                segment.payload.reset();
+                ++sharedTailHead_;
+            }
+        }
+        if (sharedTailHead_ == sharedTail_.size()) {
+            sharedTail_.clear();
+            sharedTailHead_ = 0;
+        } else if (sharedTailHead_ > kMaxWriteIov && sharedTailHead_ * 2 > sharedTail_.size()) {
+            sharedTail_.erase(sharedTail_.begin(), sharedTail_.begin() + sharedTailHead_);
+            sharedTailHead_ = 0;
+        }
+    }
+
+    size_t egressBudget() {
+        double budget = std::numeric_limits<double>::infinity();
+        for (TokenBucket* bucket : {ownLimiters_.egressBytes.get(), sharedLimiters_.egressBytes.get()}) {
+            if (bucket) budget = std::min(budget, bucket->available());
+        }
+        if (budget < 1.0) return 0;
+        return budget >= static_cast<double>(std::numeric_limits<size_t>::max())
+            ? std::numeric_limits<size_t>::max() : static_cast<size_t>(budget);
+    }
+
+    void chargeEgress(size_t bytes) {
+        for (TokenBucket* bucket : {ownLimiters_.egressBytes.get(), sharedLimiters_.egressBytes.get()}) {
+            if (bucket) bucket->consume(static_cast<double>(bytes));
+        }
+    }
+
+    double egressWait() {
+        double wait = 0.0;
+        for (TokenBucket* bucket : {ownLimiters_.egressBytes.get(), sharedLimiters_.egressBytes.get()}) {
+            // Wait for a reasonably sized chunk rather than trickling out single bytes
+            if (bucket) wait = std::max(wait, bucket->secondsUntilAvailable(std::min(kMinRateLimitChunk, bucket->burst())));
+        }
+        return wait;
+    }
+
+    size_t ingressBudget() {
+        double budget = std::numeric_limits<double>::infinity();
+        for (TokenBucket* bucket : {ownLimiters_.ingressBytes.get(), sharedLimiters_.ingressBytes.get()}) {
+            if (bucket) budget = std::min(budget, bucket->available());
+        }
+        if (budget < 1.0) return 0;
+        return budget >= static_cast<double>(std::numeric_limits<size_t>::max())
+            ? std::numeric_limits<size_t>::max() : static_cast<size_t>(budget);
+    }
+
+    void chargeIngress(size_t bytes) {
+        double wait = 0.0;
+        for (TokenBucket* bucket : {ownLimiters_.ingressBytes.get(), sharedLimiters_.ingressBytes.get()}) {
+            if (bucket) {
+                bucket->consume(static_cast<double>(bytes));
+                wait = std::max(wait, bucket->secondsUntilAvailable(std::min(kMinRateLimitChunk, bucket->burst())));
+            }
+        }
+        for (TokenBucket* bucket : {ownLimiters_.ingressMessages.get(), sharedLimiters_.ingressMessages.get()}) {
+            if (bucket) {
+                bucket->consume(1.0);
+                wait = std::max(wait, bucket->secondsUntilAvailable(1.0));
+            }
+        }
+        if (wait > 0.0) {
+            pauseReadingInLoop(kPausedByRateLimit);
+            armRateLimitTimer(wait, false);
+        }
+    }
+
+    double ingressWait() {
+        double wait = 0.0;
+        for (TokenBucket* bucket : {ownLimiters_.ingressBytes.get(), sharedLimiters_.ingressBytes.get()}) {
+            if (bucket) wait = std::max(wait, bucket->secondsUntilAvailable(std::min(kMinRateLimitChunk, bucket->burst())));
+        }
+        for (TokenBucket* bucket : {ownLimiters_.ingressMessages.get(), sharedLimiters_.ingressMessages.get()}) {
+            if (bucket) wait = std::max(wait, bucket->secondsUntilAvailable(1.0));
+        }
+        return wait;
+    }
+
+    void armRateLimitTimer(double delay, bool egress) {
+        bool& armed = egress ? egressTimerArmed_ : ingressTimerArmed_;
+        if (armed) return;
+        armed = true;
+        getLoop()->runAfter(std::max(delay, kMinRateLimitDelay), [weak = this->weak_from_this(), egress] {
+            if (auto self = weak.lock()) self->onRateLimitTimer(egress);
+        });
+    }
+
+    void onRateLimitTimer(bool egress) {
+        if (!getLoop()->isInLoopThread()) {
+            getLoop()->queueInLoop([self = this->shared_from_this(), egress] { self->onRateLimitTimer(egress); });
+            return;
+        }
+
+        if (egress) {
+            egressTimerArmed_ = false;
+            if (state_.load() != State::Disconnected && pendingOutputBytes() > 0 &&
+                !channel_.isWriting()) {
+                channel_.enableWriting();
+            }
+            return;
+        }
+
+        ingressTimerArmed_ = false;
+        if (const double wait = ingressWait(); wait > 0.0) {
+            armRateLimitTimer(wait, false);
+        } else {
+            resumeReadingInLoop(kPausedByRateLimit);
+        }
+    }
+
     void handleClose() noexcept {
-        loop_->isInLoopThread();
+        getLoop()->isInLoopThread();
         state_.store(State::Disconnected);
-        channel_->disableAll();
+        channel_.disableAll();
 
-        const auto self = shared_from_this();
-        if (connectionCallback_) connectionCallback_(self);
+        const auto self = this->shared_from_this();
+        cancelStream();
+        resumeWaitersOnClose();
+        handler_.onConnection(self);
         if (closeCallback_) closeCallback_(self);
     }
 
+    void forceCloseInLoop() noexcept {
+        const State state = state_.load();
+        if (state == State::Connected || state == State::Disconnecting) {
+            handleClose();
+        }
+    }
+
+    bool tryCompleteRead(ReadAwaiter& reader) {
+        const size_t readable = inputBuffer_.readableBytes();
+        if (!reader.delimiter_.empty()) {
+            const char* begin = inputBuffer_.peek();
+            const char* found = std::search(begin, begin + readable,
+                                            reader.delimiter_.begin(), reader.delimiter_.end());
+            if (found != begin + readable) {
+                reader.result_ = inputBuffer_.retrieveAsString(found - begin + reader.delimiter_.size());
+                return true;
+            }
+        } else if (readable >= reader.count_) {
+            reader.result_ = inputBuffer_.retrieveAsString(reader.count_);
+            return true;
+        }
+        // Not enough data yet; a closed connection completes the read with nullopt
+        return state_.load() == State::Disconnected;
+    }
+
+    // state_ is Disconnected: a pending read completes with what is buffered or nullopt
+    void resumeWaitersOnClose() {
+        resumeReaderIfReady();
+        if (writeWaiter_) {
+            WriteAwaiter* writer = std::exchange(writeWaiter_, nullptr);
+            writer->ok_ = false;
+            writer->handle_.resume();
+        }
+    }
+
+    void resumeReaderIfReady() {
+        if (readWaiter_ && tryCompleteRead(*readWaiter_)) {
+            std::exchange(readWaiter_, nullptr)->handle_.resume();
+        }
+    }
+
     void handleError() noexcept {
-        std::error_code ec = socket_->getSocketError();
+        std::error_code ec = socket_.getSocketError();
         LOG_ERROR("Socket error[{}] on connection {}: {}", 
-                 ec.value(), name_, ec.message());
+                 ec.value(), name(), ec.message());
     }
 
+    static constexpr int kMaxWriteIov = 64;
+    static constexpr double kMinRateLimitChunk = 1024.0;
+    static constexpr double kMinRateLimitDelay = 0.001;
+
     static bool isBlockingError(int err) noexcept {
         return err == EAGAIN || err == EWOULDBLOCK;
     }
@@ -273,23 +1156,67 @@ private:
         }
     }
 
-    EventLoop* loop_;
-    const std::string name_;
+    // Hot: touched by every event. Behind enable_shared_from_this's weak
+    // pointer, these and the channel's fd and event masks fill the first
+    // cache line of the (cache-line aligned) object.
+    std::atomic<EventLoop*> loop_;
     std::atomic<State> state_;
-    
-    std::unique_ptr<Socket> socket_;
-    std::unique_ptr<Channel> channel_;
-    
-    const InetAddress localAddr_;
-    const InetAddress peerAddr_;
-    
+    uint8_t readPauseMask_{0};
+    bool ingressTimerArmed_{false};
+    bool egressTimerArmed_{false};
+    Socket socket_;      // declared before channel_, closes the fd after it is gone
+    Channel channel_;
+
     Buffer inputBuffer_;
     Buffer outputBuffer_;
-    
-    ConnectionCallback connectionCallback_;
-    MessageCallback messageCallback_;
-    WriteCompleteCallback writeCompleteCallback_;
+    size_t sharedTailBytes_{0};
+    ReadAwaiter* readWaiter_{nullptr};
+    WriteAwaiter* writeWaiter_{nullptr};
+    size_t writeResumeMark_{kDefaultWriteResumeMark};
+    StreamSourcePtr streamSource_;
+    size_t streamLowWaterMark_{kDefaultStreamLowWaterMark};
+    size_t backpressureHighMark_{0};
+    size_t backpressureLowMark_{0};
+    std::atomic<size_t> highWaterMark_{64 * 1024 * 1024}; // 64MB
+    std::atomic<uint64_t> recentBytes_{0};
+    Handler handler_;
+    void* context_{nullptr};
+    const char* contextType_{nullptr};
+    void (*contextDeleter_)(void*) noexcept {nullptr};
+
+    struct SharedSegment {
+        SharedPayload payload;
+        size_t offset;   // bytes of payload already written
+    };
+    // Queued behind outputBuffer_, consumed from sharedTailHead_; unlike a
+    // deque an empty vector does not allocate, which keeps accepts cheap
+    std::vector<SharedSegment> sharedTail_;
+    size_t sharedTailHead_{0};
+
     CloseCallback closeCallback_;
     HighWaterMarkCallback highWaterMarkCallback_;
-    std::atomic<size_t> highWaterMark_{64 * 1024 * 1024}; // 64MB
-};
\ No newline at end of file
+    LoopChangeCallback loopChangeCallback_;
+    ShedCallback shedCallback_;
+    std::function<void()> rawReadCallback_;
+    std::function<void()> rawWriteCallback_;
+
+    std::atomic<uint64_t> nextOffloadSeq_{0};
+    uint64_t nextOffloadToSend_{0};
+    std::map<uint64_t, std::string> offloadResults_;
+
+    RateLimiters ownLimiters_;
+    RateLimiters sharedLimiters_;
+
+    // Cold: identity, read for logging and by the rare caller that asks
+    const uint64_t id_;
+    const std::shared_ptr<const std::string> namePrefix_;
+    mutable std::once_flag nameOnce_;
+    mutable std::string name_;
+    const InetAddress localAddr_;
+    const InetAddress peerAddr_;
+};
+
+class TcpConnection final : public BasicTcpConnection<CallbackHandler, TcpConnection> {
+public:
+    using BasicTcpConnection<CallbackHandler, TcpConnection>::BasicTcpConnection;
+};
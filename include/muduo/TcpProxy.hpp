@@ -0,0 +1,63 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "Callbacks.hpp"
+#include "EventLoop.hpp"
+#include "InetAddress.hpp"
+#include "Noncopyable.hpp"
+#include "TcpClient.hpp"
+#include "TcpServer.hpp"
+
+/*
+ * L4 relay: every accepted connection is paired with an outbound connection  
+ * to one backend, and bytes move between the two sockets with splice(2)  
+ * through a pipe per direction, never through user-space buffers.  
+ * 
+ * Both connections run in raw mode (see TcpConnection) on the same loop.  
+ * Backpressure is per direction: once a pipe is full because its  
+ * destination does not drain, the source stops being read and the  
+ * destination is watched for writability instead. An EOF from either peer  
+ * is passed on as a half-close (shutdown of the write side) after the pipe  
+ * has drained, so request/response protocols that rely on half-close keep  
+ * working. When one peer is gone and nothing can reach it anymore, the  
+ * other one is closed as well.  
+ * 
+ * A client whose backend cannot be reached within the connect timeout  
+ * (5s by default) is closed. Sessions live in a side table keyed by the  
+ * inbound connection id, guarded by a mutex because all loops share it.  
+ */
+
+class TcpProxy : Noncopyable {
+public:
+    TcpProxy(EventLoop* loop,
+             const InetAddress& listenAddr,
+             const InetAddress& backendAddr,
+             std::string name,
+             TcpServer::Option option = TcpServer::Option::kNoReusePort);
+
+    void setThreadNum(size_t numThreads) noexcept { server_.setThreadNum(numThreads); }
+    void setConnectTimeout(double seconds) noexcept { connectTimeout_ = seconds; }
+    // Requested pipe capacity per direction (rounded and capped by the kernel)
+    void setPipeSize(size_t bytes) noexcept { pipeSize_ = bytes; }
+    [[nodiscard]] TcpServer& tcpServer() noexcept { return server_; }
+
+    void start() { server_.start(); }
+
+private:
+    struct Session;
+
+    void onConnection(const TcpConnectionPtr& conn);
+    void removeSession(uint64_t id);
+
+    TcpServer server_;
+    const InetAddress backendAddr_;
+    double connectTimeout_{5.0};
+    size_t pipeSize_{256 * 1024};
+
+    std::mutex sessionsMutex_;
+    std::unordered_map<uint64_t, std::shared_ptr<Session>> sessions_;
+};
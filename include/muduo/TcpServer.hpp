@@ -1,10 +1,16 @@
 #pragma once
 
+#include <algorithm>
 #include <atomic>
+#include <condition_variable>
+#include <future>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <string_view>
+#include <type_traits>
 #include <unordered_map>
-#include <sstream>
+#include <vector>
 
 #include "Acceptor.hpp"
 #include "EventLoop.hpp"
@@ -20,7 +26,8 @@
  * - Acceptor      : Listens for new connections, eventually encapsulating them  
  *                   into TcpConnection objects and assigning to subloops  
  * - EventLoopThreadPool : Thread pool for handling I/O operations  
- * - ConnectionMap : Maintains all active connections  
+ * - Shards        : One ConnectionMap per loop, keyed by 64-bit connection id  
+ *                   and only ever touched by the loop that owns it  
  * - etc.  
  * Allows programmers to focus on callback function logic.  
  * 
@@ -34,24 +41,67 @@
  *    inter-loop communication  
  * 5. When Acceptor detects a new connection:  
  *    - Invokes TcpServer::newConnection  
- *    - Selects subloop (*ioLoop) via round-robin scheduling  
+ *    - Selects subloop (*ioLoop) via the pool's dispatch policy  
+ *      (round-robin by default)  
  *    - Constructs TcpConnection object  
- * 6. runInLoop delivers TcpConnection object to subloop  
+ * 6. runInLoop delivers TcpConnection object to subloop, which registers it  
+ *    in its own shard  
  * 7. TcpConnection::connectEstablished() triggers  
  *    TcpConnection::connectionCallback  
+ * 8. On close the subloop drops the connection from its shard and destroys  
+ *    it in place, without a round trip through the baseloop  
+ * 
+ * The listen address may be an AF_UNIX one (InetAddress::fromUnixPath), for  
+ * same-host peers that do not need the TCP/IP stack; everything else works  
+ * the same way.  
+ * 
+ * Overload shedding: enableOverloadShedding() turns on the CoDel controller  
+ * of every loop. While a loop is overloaded, new connections dispatched to  
+ * it are closed right after accept (spaced by CoDel's control law), and  
+ * requests on its connections that waited longer than the target go to the  
+ * shed callback (if one is set).  
+ * 
+ * Fan-out: broadcast() sends one payload to every connection and publish()  
+ * to the subscribers of a topic. The payload is shared, not copied: each  
+ * loop gets a single task that walks its own shard and queues a reference  
+ * to the payload on every connection (see TcpConnection::sendShared).  
+ * Subscriptions live in the shard of the connection's loop, follow it when  
+ * it migrates and go away when it closes.  
+ * 
+ * Migration: migrateConnection() moves a connection to another of this  
+ * server's IO loops (see TcpConnection::migrateTo); any other target is  
+ * refused. The destructor waits for migrations already under way, and a  
+ * connection that arrives after its new loop's shard was emptied is closed.  
+ * 
+ * Optional rebalancing: every interval the baseloop compares the busy ratio  
+ * of the subloops and asks the hottest one to migrate its connection with  
+ * the most recent traffic to the coolest one.  
+ * 
+ * Static dispatch: BasicTcpServer<Handler> copies its Handler into every  
+ * BasicTcpConnection<Handler>, which calls onConnection/onMessage/  
+ * onWriteComplete on it directly instead of through std::function (see  
+ * TcpConnection.hpp for the interface). TcpServer is the type-erased  
+ * BasicTcpServer<CallbackHandler, TcpConnection> with the usual  
+ * setXxxCallback() setters.  
+ * Per-connection state can live in the handler copy itself.  
  */  
 
-class TcpServer : Noncopyable {
+template<typename Handler, typename ConnectionType = BasicTcpConnection<Handler>>
+class BasicTcpServer : Noncopyable {
 public:
+    using Connection = ConnectionType;
+    using ConnectionPtr = std::shared_ptr<Connection>;
+
     enum class Option { kNoReusePort, kReusePort };
 
-    TcpServer(EventLoop* loop,
-              const InetAddress& listenAddr,
-              std::string name,
-              Option option = Option::kNoReusePort)
+    BasicTcpServer(EventLoop* loop,
+                   const InetAddress& listenAddr,
+                   std::string name,
+                   Option option = Option::kNoReusePort)
         : loop_(assertLoopNotNull(loop)),
           ipPort_(listenAddr.toIpPort()),
           name_(std::move(name)),
+          namePrefix_(std::make_shared<const std::string>(name_ + "-" + ipPort_)),
           acceptor_(std::make_unique<Acceptor>(loop, listenAddr, option == Option::kReusePort)),
           threadPool_(std::make_shared<EventLoopThreadPool>(loop, name_)),
           nextConnId_(1),
@@ -62,108 +112,441 @@ public:
         });
     }
 
-    ~TcpServer() {
-        for (auto& [name, conn] : connections_) {
-            TcpConnectionPtr localConn(std::move(conn));
-            localConn->getLoop()->runInLoop(
-                [localConn] { localConn->connectDestroyed(); });
+    ~BasicTcpServer() {
+        if (rebalanceTimer_.valid()) {
+            loop_->cancel(rebalanceTimer_);
         }
+        {
+            std::lock_guard<std::mutex> lock(migratingMutex_);
+            closing_ = true;
+        }
+        // Wait for every loop: until its shard is empty a close there still calls back into this
+        std::vector<std::future<void>> pending;
+        for (auto& [ioLoop, shard] : shards_) {
+            auto done = std::make_shared<std::promise<void>>();
+            pending.push_back(done->get_future());
+            ioLoop->runInLoop([shard = shard, done] {
+                ConnectionMap connections;
+                connections.swap(shard->connections);
+                shard->topics.clear();
+                shard->subscriptions.clear();
+                for (auto& [id, conn] : connections) {
+                    conn->connectDestroyed();
+                }
+                done->set_value();
+            });
+        }
+        for (auto& f : pending) {
+            f.wait();
+        }
+        // A connection detached before its shard was drained is in no shard; its attach still calls back
+        std::unique_lock<std::mutex> lock(migratingMutex_);
+        migrationsDone_.wait(lock, [this] { return migrationsInFlight_ == 0; });
     }
 
     void setThreadNum(size_t numThreads) noexcept {
         threadPool_->setThreadNum(numThreads);
     }
 
+    void setDispatchPolicy(EventLoopThreadPool::DispatchPolicy policy) noexcept {
+        threadPool_->setDispatchPolicy(policy);
+    }
+
+    void setLoopSelector(EventLoopThreadPool::LoopSelector selector) noexcept {
+        threadPool_->setLoopSelector(std::move(selector));
+    }
+
+    // The IO loops connections are spread over, valid after start()
+    [[nodiscard]] std::vector<EventLoop*> getAllLoops() const {
+        return threadPool_->getAllLoops();
+    }
+
+    void setMaxAcceptsPerWakeup(int n) noexcept {
+        acceptor_->setMaxAcceptsPerWakeup(n);
+    }
+
+    void setRejectedAcceptCallback(Acceptor::RejectedAcceptCallback cb) noexcept {
+        acceptor_->setRejectedAcceptCallback(std::move(cb));
+    }
+
+    [[nodiscard]] uint64_t rejectedAccepts() const noexcept {
+        return acceptor_->rejectedAccepts();
+    }
+
+    // Where the server listens; the chosen port when constructed with port 0
+    [[nodiscard]] InetAddress listenAddress() const {
+        return acceptor_->listenAddress();
+    }
+
     template<typename F>
     void setThreadInitCallback(F&& cb) noexcept {
         threadInitCallback_ = std::forward<F>(cb);
     }
 
+    // Copied into each new connection; set before start()
+    void setHandler(Handler handler) noexcept(std::is_nothrow_move_assignable_v<Handler>) {
+        handler_ = std::move(handler);
+    }
+
+    [[nodiscard]] Handler& handler() noexcept { return handler_; }
+
+    // The setters below are only available with CallbackHandler
     template<typename F>
     void setConnectionCallback(F&& cb) noexcept {
-        connectionCallback_ = std::forward<F>(cb);
+        handler_.connectionCallback = std::forward<F>(cb);
     }
 
     template<typename F>
     void setMessageCallback(F&& cb) noexcept {
-        messageCallback_ = std::forward<F>(cb);
+        handler_.messageCallback = std::forward<F>(cb);
+    }
+
+    // Replaces the message callback: the connection is lent for the call, no refcount is taken
+    template<typename F>
+    void setBorrowedMessageCallback(F&& cb) noexcept {
+        handler_.borrowedMessageCallback = std::forward<F>(cb);
     }
 
     template<typename F>
     void setWriteCompleteCallback(F&& cb) noexcept {
-        writeCompleteCallback_ = std::forward<F>(cb);
+        handler_.writeCompleteCallback = std::forward<F>(cb);
+    }
+
+    // Applied to every new connection, see TcpConnection::setReadBackpressure
+    void setReadBackpressure(size_t highMark, size_t lowMark) noexcept {
+        backpressureHighMark_ = highMark;
+        backpressureLowMark_ = lowMark;
+    }
+
+    // Limits given to each connection individually
+    void setConnectionRateLimits(const RateLimitConfig& config) {
+        connectionRateLimits_ = config;
+    }
+
+    // Limits shared by all connections of this server
+    void setServerRateLimits(const RateLimitConfig& config) {
+        serverRateLimiters_ = RateLimiters::fromConfig(config);
+    }
+
+    // Queueing-delay target and interval as in CoDel (defaults 5ms / 100ms)
+    void enableOverloadShedding(double targetSeconds = 0.005, double intervalSeconds = 0.1) noexcept {
+        sheddingTargetUs_ = static_cast<int64_t>(targetSeconds * Timestamp::kMicroSecondsPerSecond);
+        sheddingIntervalUs_ = static_cast<int64_t>(intervalSeconds * Timestamp::kMicroSecondsPerSecond);
+    }
+
+    template<typename F>
+    void setShedCallback(F&& cb) noexcept {
+        shedCallback_ = std::forward<F>(cb);
+    }
+
+    [[nodiscard]] uint64_t shedAccepts() const noexcept {
+        return shedAccepts_.load(std::memory_order_relaxed);
+    }
+
+    // target must be one of this server's IO loops (getAllLoops()); cb, if any, runs
+    // on the connection's loop and is told whether the connection moved
+    void migrateConnection(const ConnectionPtr& conn, EventLoop* target, typename Connection::MigrateCallback cb = {}) {
+        if (!shards_.contains(target)) {
+            LOG_ERROR("TcpServer[{}] cannot migrate {}: target loop is not one of its IO loops", name_, conn->name());
+            if (cb) {
+                conn->getLoop()->runInLoop([conn, cb = std::move(cb)] { cb(conn, false); });
+            }
+            return;
+        }
+        conn->migrateTo(target, std::move(cb));
+    }
+
+    // Any thread, after start()
+    void broadcast(SharedPayload payload) {
+        for (const auto& [ioLoop, shard] : shards_) {
+            ioLoop->runInLoop([shard = shard, payload] {
+                for (const auto& [id, conn] : shard->connections) {
+                    conn->sendShared(payload);
+                }
+            });
+        }
+    }
+
+    void broadcast(std::string_view message) {
+        broadcast(std::make_shared<const std::string>(message));
+    }
+
+    void subscribe(const std::string& topic, const ConnectionPtr& conn) {
+        conn->getLoop()->runInLoop([this, topic, conn] { changeSubscription(topic, conn, true); });
+    }
+
+    void unsubscribe(const std::string& topic, const ConnectionPtr& conn) {
+        conn->getLoop()->runInLoop([this, topic, conn] { changeSubscription(topic, conn, false); });
+    }
+
+    // Any thread, after start()
+    void publish(const std::string& topic, SharedPayload payload) {
+        for (const auto& [ioLoop, shard] : shards_) {
+            ioLoop->runInLoop([shard = shard, topic, payload] {
+                if (auto it = shard->topics.find(topic); it != shard->topics.end()) {
+                    for (const auto& [id, conn] : it->second) {
+                        conn->sendShared(payload);
+                    }
+                }
+            });
+        }
+    }
+
+    void publish(const std::string& topic, std::string_view message) {
+        publish(topic, std::make_shared<const std::string>(message));
+    }
+
+    // Must be called from the baseloop thread, after start()
+    void enableAutoRebalance(double intervalSeconds, int busyGapPermille = kDefaultBusyGapPermille) {
+        if (rebalanceTimer_.valid()) {
+            loop_->cancel(rebalanceTimer_);
+        }
+        rebalanceGapPermille_ = busyGapPermille;
+        rebalanceTimer_ = loop_->runEvery(intervalSeconds, [this] { rebalance(); });
     }
 
     void start() {
         if (!started_.exchange(true)) {
             threadPool_->start(threadInitCallback_);
+            for (EventLoop* ioLoop : threadPool_->getAllLoops()) {
+                shards_.emplace(ioLoop, std::make_shared<Shard>());
+                if (sheddingTargetUs_ > 0) {
+                    ioLoop->overloadController().enable(sheddingTargetUs_, sheddingIntervalUs_);
+                }
+            }
             loop_->runInLoop([this] { acceptor_->listen(); });
         }
     }
 
 private:
-    using ConnectionMap = std::unordered_map<std::string, TcpConnectionPtr>;
+    using ConnectionMap = std::unordered_map<uint64_t, ConnectionPtr>;
+
+    // Owned by exactly one loop; shards_ itself is read-only after start()
+    struct Shard {
+        ConnectionMap connections;
+        std::unordered_map<std::string, ConnectionMap> topics;
+        std::unordered_map<uint64_t, std::vector<std::string>> subscriptions;   // by connection id
+    };
+
+    static constexpr int kDefaultBusyGapPermille = 250;
 
     static EventLoop* assertLoopNotNull(EventLoop* loop) {
         if (!loop) LOG_DEBUG("TcpServer requires valid EventLoop");
         return loop;
     }
 
+    Shard& shardOf(EventLoop* ioLoop) {
+        return *shards_.at(ioLoop);
+    }
+
     void newConnection(int sockfd, const InetAddress& peerAddr) {
-        EventLoop* ioLoop = threadPool_->getNextLoop();
-        
-        std::ostringstream oss;
-        oss << name_ << "-" << ipPort_ << "#" << nextConnId_++;
-        const std::string connName = oss.str();
+        EventLoop* ioLoop = threadPool_->getLoopFor(peerAddr);
+        if (sheddingTargetUs_ > 0 && ioLoop->overloadController().shouldShed()) {
+            shedAccepts_.fetch_add(1, std::memory_order_relaxed);
+            LOG_DEBUG("Shedding new connection from {}", peerAddr.toIpPort());
+            ioLoop->connectionDispatchDone();
+            ::close(sockfd);
+            return;
+        }
+        const uint64_t connId = nextConnId_.fetch_add(1, std::memory_order_relaxed);
 
-        sockaddr_in local;
+        sockaddr_storage local{};
         socklen_t addrlen = sizeof(local);
         if (::getsockname(sockfd, reinterpret_cast<sockaddr*>(&local), &addrlen) != 0) {
             LOG_ERROR("Failed to get local address for fd: {}", sockfd);
+            ioLoop->connectionDispatchDone();
             ::close(sockfd);
             return;
         }
 
-        TcpConnectionPtr conn = std::make_shared<TcpConnection>(
-            ioLoop, connName, sockfd, InetAddress(local), peerAddr
-        );
+        InetAddress localAddr(reinterpret_cast<const sockaddr*>(&local), addrlen);
+        ioLoop->runInLoop([this, ioLoop, connId, sockfd, localAddr = std::move(localAddr), peerAddr] {
+            // Built on its own loop so that the memory comes from, and returns to, that loop's pool
+            ConnectionPtr conn = std::allocate_shared<Connection>(
+                PoolAllocator<Connection>(), ioLoop, connId, namePrefix_, sockfd, localAddr, peerAddr);
 
-        connections_.emplace(connName, conn);
-        conn->setConnectionCallback(connectionCallback_);
-        conn->setMessageCallback(messageCallback_);
-        conn->setWriteCompleteCallback(writeCompleteCallback_);
-        conn->setCloseCallback([this](const auto& c) { removeConnection(c); });
+            conn->setHandler(handler_);
+            conn->setCloseCallback([this](const auto& c) { removeConnection(c); });
+            conn->setLoopChangeCallback([this](const auto& c, bool attached) { onLoopChange(c, attached); });
+            conn->setReadBackpressure(backpressureHighMark_, backpressureLowMark_);
+            conn->setShedCallback(shedCallback_);
+            conn->setRateLimits(connectionRateLimits_);
+            conn->setSharedRateLimiters(serverRateLimiters_);
 
-        ioLoop->runInLoop([conn] { 
-            conn->connectEstablished(); 
+            shardOf(ioLoop).connections.emplace(conn->id(), conn);
+            conn->connectEstablished();
+            ioLoop->connectionDispatchDone();   // now counted as an active connection
         });
     }
 
-    void removeConnection(const TcpConnectionPtr& conn) {
-        loop_->runInLoop([this, conn] { removeConnectionInLoop(conn); });
-    }
-
-    void removeConnectionInLoop(const TcpConnectionPtr& conn) {
+    // Runs on the connection's own loop (closeCallback is invoked from handleClose)
+    void removeConnection(const ConnectionPtr& conn) {
         LOG_DEBUG("Removing connection: {}", conn->name());
-        
-        if (connections_.erase(conn->name()) > 0) {
-            EventLoop* ioLoop = conn->getLoop();
+
+        EventLoop* ioLoop = conn->getLoop();
+        Shard& shard = shardOf(ioLoop);
+        dropSubscriptions(shard, conn->id());
+        if (shard.connections.erase(conn->id()) > 0) {
             ioLoop->queueInLoop([conn] { conn->connectDestroyed(); });
         }
     }
 
+    void onLoopChange(const ConnectionPtr& conn, bool attached) {
+        Shard& shard = shardOf(conn->getLoop());
+        if (attached) {
+            std::vector<std::string> topics;
+            bool closing = false;
+            {
+                std::lock_guard<std::mutex> lock(migratingMutex_);
+                if (auto node = migratingSubscriptions_.extract(conn->id())) {
+                    topics = std::move(node.mapped());
+                }
+                closing = closing_;
+            }
+            // Closed in flight, removeConnection() found it in no shard; or this
+            // loop's shard may already be drained by the destructor. Finish it here.
+            if (conn->disconnected() || closing) {
+                conn->getLoop()->queueInLoop([this, conn] {
+                    conn->connectDestroyed();
+                    migrationFinished();
+                });
+                return;
+            }
+            shard.connections.emplace(conn->id(), conn);
+            for (std::string& topic : topics) {
+                shard.topics[topic].emplace(conn->id(), conn);
+                shard.subscriptions[conn->id()].push_back(std::move(topic));
+            }
+            migrationFinished();
+        } else {
+            shard.connections.erase(conn->id());
+            std::vector<std::string> topics = dropSubscriptions(shard, conn->id());
+            std::lock_guard<std::mutex> lock(migratingMutex_);
+            ++migrationsInFlight_;
+            if (!topics.empty()) {
+                migratingSubscriptions_[conn->id()] = std::move(topics);
+            }
+        }
+    }
+
+    void migrationFinished() {
+        std::lock_guard<std::mutex> lock(migratingMutex_);
+        if (--migrationsInFlight_ == 0) {
+            migrationsDone_.notify_all();
+        }
+    }
+
+    void changeSubscription(const std::string& topic, const ConnectionPtr& conn, bool subscribe) {
+        EventLoop* ioLoop = conn->getLoop();
+        if (!ioLoop->isInLoopThread()) {
+            // Migrated meanwhile; the subscription follows the connection
+            ioLoop->queueInLoop([this, topic, conn, subscribe] { changeSubscription(topic, conn, subscribe); });
+            return;
+        }
+        Shard& shard = shardOf(ioLoop);
+        if (!shard.connections.contains(conn->id())) {
+            return;   // closed or still being attached
+        }
+        std::vector<std::string>& topics = shard.subscriptions[conn->id()];
+        const auto it = std::find(topics.begin(), topics.end(), topic);
+        if (subscribe && it == topics.end()) {
+            topics.push_back(topic);
+            shard.topics[topic].emplace(conn->id(), conn);
+        } else if (!subscribe && it != topics.end()) {
+            topics.erase(it);
+            removeFromTopic(shard, topic, conn->id());
+        }
+        if (topics.empty()) {
+            shard.subscriptions.erase(conn->id());
+        }
+    }
+
+    // Returns the topics the connection was subscribed to
+    static std::vector<std::string> dropSubscriptions(Shard& shard, uint64_t connId) {
+        auto node = shard.subscriptions.extract(connId);
+        if (!node) {
+            return {};
+        }
+        for (const std::string& topic : node.mapped()) {
+            removeFromTopic(shard, topic, connId);
+        }
+        return std::move(node.mapped());
+    }
+
+    static void removeFromTopic(Shard& shard, const std::string& topic, uint64_t connId) {
+        if (auto it = shard.topics.find(topic); it != shard.topics.end()) {
+            it->second.erase(connId);
+            if (it->second.empty()) {
+                shard.topics.erase(it);
+            }
+        }
+    }
+
+    void rebalance() {
+        if (shards_.size() < 2) {
+            return;
+        }
+
+        EventLoop* hot = nullptr;
+        EventLoop* cool = nullptr;
+        int hotBusy = -1;
+        int coolBusy = 1001;
+        for (const auto& [ioLoop, shard] : shards_) {
+            const int busy = ioLoop->loadStats().busyPermille;
+            if (busy > hotBusy) { hot = ioLoop; hotBusy = busy; }
+            if (busy < coolBusy) { cool = ioLoop; coolBusy = busy; }
+        }
+        EventLoop* target = (hotBusy - coolBusy >= rebalanceGapPermille_) ? cool : nullptr;
+
+        // Every loop resets its traffic counters so they always cover one interval;
+        // only the hottest one picks a connection to give away
+        for (const auto& [ioLoop, shard] : shards_) {
+            ioLoop->queueInLoop([shard = shard, target = (ioLoop == hot ? target : nullptr)] {
+                ConnectionPtr heaviest;
+                uint64_t heaviestBytes = 0;
+                for (const auto& [id, conn] : shard->connections) {
+                    const uint64_t bytes = conn->takeRecentBytes();
+                    if (bytes > heaviestBytes) {
+                        heaviest = conn;
+                        heaviestBytes = bytes;
+                    }
+                }
+                if (target && heaviest) {
+                    LOG_DEBUG("Rebalancing {} ({} bytes)", heaviest->name(), heaviestBytes);
+                    heaviest->migrateTo(target);
+                }
+            });
+        }
+    }
+
     EventLoop* loop_;
     const std::string ipPort_;
     const std::string name_;
+    const std::shared_ptr<const std::string> namePrefix_;
     std::unique_ptr<Acceptor> acceptor_;
     std::shared_ptr<EventLoopThreadPool> threadPool_;
     
-    std::atomic_uint nextConnId_;
+    std::atomic<uint64_t> nextConnId_;
     std::atomic_bool started_;
-    ConnectionMap connections_;
+    std::unordered_map<EventLoop*, std::shared_ptr<Shard>> shards_;
+    TimerId rebalanceTimer_;
+    int rebalanceGapPermille_{kDefaultBusyGapPermille};
+    size_t backpressureHighMark_{0};
+    size_t backpressureLowMark_{0};
+    RateLimitConfig connectionRateLimits_;
+    RateLimiters serverRateLimiters_;
+    int64_t sheddingTargetUs_{0};
+    int64_t sheddingIntervalUs_{0};
+    std::atomic<uint64_t> shedAccepts_{0};
+    std::mutex migratingMutex_;   // guards the members below
+    std::unordered_map<uint64_t, std::vector<std::string>> migratingSubscriptions_;
+    size_t migrationsInFlight_{0};   // detached from one loop, not yet attached to the next
+    std::condition_variable migrationsDone_;
+    bool closing_{false};
 
     std::function<void(EventLoop*)> threadInitCallback_;
-    ConnectionCallback connectionCallback_;
-    MessageCallback messageCallback_;
-    WriteCompleteCallback writeCompleteCallback_;
+    Handler handler_;
+    typename Connection::ShedCallback shedCallback_;
 };
+
+using TcpServer = BasicTcpServer<CallbackHandler, TcpConnection>;
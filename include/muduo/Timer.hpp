@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+
+#include "Noncopyable.hpp"
+#include "Timestamp.hpp"
+
+/*
+ * A single scheduled callback: expiration time, optional repeat interval  
+ * and a globally unique sequence number used to tell timers apart after  
+ * their address has been reused.  
+ * 
+ * TimerId is the opaque handle returned by EventLoop::runAt/runAfter/runEvery  
+ * and accepted by EventLoop::cancel.  
+ */
+
+class Timer : Noncopyable {
+public:
+    using TimerCallback = std::function<void()>;
+
+    Timer(TimerCallback cb, Timestamp when, double interval)
+        : callback_(std::move(cb)),
+          expiration_(when),
+          interval_(interval),
+          repeat_(interval > 0.0),
+          sequence_(++numCreated_) {}
+
+    void run() const { callback_(); }
+
+    Timestamp expiration() const noexcept { return expiration_; }
+    bool repeat() const noexcept { return repeat_; }
+    int64_t sequence() const noexcept { return sequence_; }
+
+    void restart(Timestamp now) noexcept {
+        expiration_ = repeat_ ? addTime(now, interval_) : Timestamp();
+    }
+
+private:
+    const TimerCallback callback_;
+    Timestamp expiration_;
+    const double interval_;
+    const bool repeat_;
+    const int64_t sequence_;
+
+    static inline std::atomic<int64_t> numCreated_{0};
+};
+
+class TimerId {
+public:
+    TimerId() noexcept : timer_(nullptr), sequence_(0) {}
+    TimerId(Timer* timer, int64_t seq) noexcept : timer_(timer), sequence_(seq) {}
+
+    bool valid() const noexcept { return timer_ != nullptr; }
+
+    friend class TimerQueue;
+
+private:
+    Timer* timer_;
+    int64_t sequence_;
+};
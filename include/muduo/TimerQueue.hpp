@@ -0,0 +1,54 @@
+#pragma once
+
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "Channel.hpp"
+#include "Noncopyable.hpp"
+#include "Timer.hpp"
+#include "Timestamp.hpp"
+
+/*
+ * Timers owned by one EventLoop, multiplexed onto a single timerfd whose  
+ * Channel is registered with the loop's poller. The timerfd is always armed  
+ * for the earliest expiration; expired timers run inside the loop thread and  
+ * repeating ones are re-inserted.  
+ * 
+ * addTimer/cancel are thread-safe; they hop to the loop via runInLoop.  
+ */
+
+class EventLoop;
+
+class TimerQueue : Noncopyable {
+public:
+    explicit TimerQueue(EventLoop* loop);
+    ~TimerQueue();
+
+    TimerId addTimer(Timer::TimerCallback cb, Timestamp when, double interval);
+    void cancel(TimerId timerId);
+
+private:
+    using Entry = std::pair<Timestamp, Timer*>;
+    using TimerList = std::set<Entry>;
+    using ActiveTimer = std::pair<Timer*, int64_t>;
+    using ActiveTimerSet = std::set<ActiveTimer>;
+
+    static int createTimerfd();
+
+    void addTimerInLoop(Timer* timer);
+    void cancelInLoop(TimerId timerId);
+    void handleRead();
+    std::vector<Entry> getExpired(Timestamp now);
+    void reset(const std::vector<Entry>& expired, Timestamp now);
+    bool insert(Timer* timer);
+    void resetTimerfd(Timestamp expiration);
+
+    EventLoop* loop_;
+    const int timerfd_;
+    Channel timerfdChannel_;
+    TimerList timers_;
+    ActiveTimerSet activeTimers_;
+    bool callingExpiredTimers_;
+    ActiveTimerSet cancelingTimers_;
+};
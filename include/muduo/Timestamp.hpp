@@ -20,6 +20,8 @@ public:
     Timestamp() : mseconds(0) {}
     explicit Timestamp(int64_t _time) : mseconds(_time) {}
 
+    static constexpr int64_t kMicroSecondsPerSecond = 1000 * 1000;
+
     static Timestamp now() {
         auto now = std::chrono::system_clock::now();
         auto duration = now.time_since_epoch();
@@ -49,6 +51,27 @@ public:
 
 	~Timestamp() = default;
 
+    int64_t microSecondsSinceEpoch() const { return mseconds; }
+    bool valid() const { return mseconds > 0; }
+
 private:
     int64_t mseconds;  
 };
+
+inline bool operator<(Timestamp lhs, Timestamp rhs) {
+    return lhs.microSecondsSinceEpoch() < rhs.microSecondsSinceEpoch();
+}
+
+inline bool operator==(Timestamp lhs, Timestamp rhs) {
+    return lhs.microSecondsSinceEpoch() == rhs.microSecondsSinceEpoch();
+}
+
+inline Timestamp addTime(Timestamp timestamp, double seconds) {
+    const auto delta = static_cast<int64_t>(seconds * Timestamp::kMicroSecondsPerSecond);
+    return Timestamp(timestamp.microSecondsSinceEpoch() + delta);
+}
+
+inline double timeDifference(Timestamp high, Timestamp low) {
+    const int64_t diff = high.microSecondsSinceEpoch() - low.microSecondsSinceEpoch();
+    return static_cast<double>(diff) / Timestamp::kMicroSecondsPerSecond;
+}
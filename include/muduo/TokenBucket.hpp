@@ -0,0 +1,71 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+
+#include "Noncopyable.hpp"
+
+/*
+ * Token bucket refilled continuously at ratePerSecond, capped at burst.  
+ * 
+ * consume() may drive the balance negative: ingress is charged after the  
+ * bytes have already been read, and the debt is paid back by waiting  
+ * secondsUntilAvailable() before the next read. Egress asks for a budget up  
+ * front with available() and is charged for what was actually written.  
+ * 
+ * The whole state is one atomic: the time at which the balance is zero  
+ * (in the future while in debt), so the balance at t is (t - zeroAt) *  
+ * rate, capped at burst. Every call is lock-free: a per-connection bucket  
+ * costs an uncontended compare-exchange, and one bucket can still be  
+ * shared by every connection of a TcpServer for server-wide limits.  
+ */
+
+class TokenBucket : Noncopyable {
+public:
+    TokenBucket(double ratePerSecond, double burst);
+
+    void consume(double tokens) noexcept;
+    [[nodiscard]] double available() const noexcept;
+    [[nodiscard]] double secondsUntilAvailable(double tokens) const noexcept;
+
+    [[nodiscard]] double rate() const noexcept { return rate_; }
+    [[nodiscard]] double burst() const noexcept { return burst_; }
+
+private:
+    using Clock = std::chrono::steady_clock;
+    static_assert(std::atomic<double>::is_always_lock_free);
+
+    // Seconds since construction; small values keep the double precise
+    [[nodiscard]] double now() const noexcept;
+    // zeroAt, or later if the bucket has been full since then
+    [[nodiscard]] double effectiveZeroAt(double zeroAt, double now) const noexcept {
+        return std::max(zeroAt, now - burst_ / rate_);
+    }
+
+    const double rate_;
+    const double burst_;
+    const Clock::time_point origin_;
+    std::atomic<double> zeroAt_;
+};
+
+// ratePerSecond == 0 means unlimited
+struct RateLimit {
+    double ratePerSecond = 0.0;
+    double burst = 0.0;
+};
+
+struct RateLimitConfig {
+    RateLimit ingressBytes;
+    RateLimit egressBytes;
+    RateLimit ingressMessages;   // message callbacks dispatched per second
+};
+
+struct RateLimiters {
+    std::shared_ptr<TokenBucket> ingressBytes;
+    std::shared_ptr<TokenBucket> egressBytes;
+    std::shared_ptr<TokenBucket> ingressMessages;
+
+    static RateLimiters fromConfig(const RateLimitConfig& config);
+};
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <atomic>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "EventLoop.hpp"
+#include "EventLoopThreadPool.hpp"
+#include "InetAddress.hpp"
+#include "Logger.hpp"
+#include "Noncopyable.hpp"
+#include "UdpSocket.hpp"
+
+/*
+ * Datagram counterpart of TcpServer. There are no connections, only  
+ * sockets bound to the listen address:  
+ * - kNoReusePort : One UdpSocket on a single IO loop  
+ * - kReusePort   : One SO_REUSEPORT UdpSocket per loop of the thread pool;  
+ *                  the kernel hashes each peer's flow to one of them, so  
+ *                  receiving scales across loops without any hand-off  
+ * 
+ * The message callback runs on the loop owning the socket the datagram  
+ * arrived on; replies through that UdpSocket& are batched with the rest of  
+ * the iteration's output.  
+ */  
+
+class UdpServer : Noncopyable {
+public:
+    enum class Option { kNoReusePort, kReusePort };
+
+    UdpServer(EventLoop* loop,
+              const InetAddress& listenAddr,
+              std::string name,
+              Option option = Option::kNoReusePort)
+        : listenAddr_(listenAddr),
+          name_(std::move(name)),
+          option_(option),
+          threadPool_(std::make_shared<EventLoopThreadPool>(loop, name_)),
+          batchSize_(UdpSocket::kDefaultBatchSize),
+          maxDatagramSize_(UdpSocket::kDefaultMaxDatagramSize),
+          started_(false) {}
+
+    // Every socket is destroyed on its own loop; wait for all of them, since
+    // threadPool_ stops those loops as soon as this returns
+    ~UdpServer() {
+        std::vector<std::future<void>> pending;
+        for (auto& socket : sockets_) {
+            auto done = std::make_shared<std::promise<void>>();
+            pending.push_back(done->get_future());
+            socket->getLoop()->runInLoop([&socket, done] {
+                socket.reset();
+                done->set_value();
+            });
+        }
+        for (auto& f : pending) {
+            f.wait();
+        }
+    }
+
+    void setThreadNum(size_t numThreads) noexcept {
+        threadPool_->setThreadNum(static_cast<int>(numThreads));
+    }
+
+    // Receive batch geometry of every socket; call before start()
+    void setBatch(size_t batchSize, size_t maxDatagramSize) noexcept {
+        batchSize_ = batchSize;
+        maxDatagramSize_ = maxDatagramSize;
+    }
+
+    template<typename F>
+    void setThreadInitCallback(F&& cb) noexcept {
+        threadInitCallback_ = std::forward<F>(cb);
+    }
+
+    void setMessageCallback(UdpSocket::MessageCallback cb) noexcept {
+        messageCallback_ = std::move(cb);
+    }
+
+    void start() {
+        if (started_.exchange(true)) {
+            return;
+        }
+        threadPool_->start(threadInitCallback_);
+
+        std::vector<EventLoop*> loops = threadPool_->getAllLoops();
+        if (option_ == Option::kNoReusePort) {
+            loops.resize(1);
+        }
+        for (EventLoop* ioLoop : loops) {
+            auto socket = std::make_unique<UdpSocket>(ioLoop, listenAddr_, option_ == Option::kReusePort,
+                                                      batchSize_, maxDatagramSize_);
+            socket->setMessageCallback(messageCallback_);
+            ioLoop->runInLoop([s = socket.get()] { s->startReading(); });
+            sockets_.push_back(std::move(socket));
+        }
+        LOG_DEBUG("UdpServer[{}] listening on {} with {} socket(s)", name_, listenAddr_.toIpPort(), sockets_.size());
+    }
+
+    [[nodiscard]] uint64_t datagramsReceived() const noexcept {
+        uint64_t total = 0;
+        for (const auto& socket : sockets_) total += socket->datagramsReceived();
+        return total;
+    }
+
+    [[nodiscard]] uint64_t datagramsDropped() const noexcept {
+        uint64_t total = 0;
+        for (const auto& socket : sockets_) total += socket->datagramsDropped();
+        return total;
+    }
+
+    [[nodiscard]] const std::string& name() const noexcept { return name_; }
+
+private:
+    const InetAddress listenAddr_;
+    const std::string name_;
+    const Option option_;
+    std::shared_ptr<EventLoopThreadPool> threadPool_;
+    std::vector<std::unique_ptr<UdpSocket>> sockets_;   // fixed after start()
+    size_t batchSize_;
+    size_t maxDatagramSize_;
+    std::atomic_bool started_;
+
+    std::function<void(EventLoop*)> threadInitCallback_;
+    UdpSocket::MessageCallback messageCallback_;
+};
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Channel.hpp"
+#include "EventLoop.hpp"
+#include "InetAddress.hpp"
+#include "Noncopyable.hpp"
+#include "Socket.hpp"
+#include "Timestamp.hpp"
+
+/*
+ * A non-blocking UDP socket driven by a Channel on one EventLoop.  
+ * 
+ * Receiving: each readable event drains the socket with recvmmsg() into a  
+ * batch of buffers allocated once up front (batchSize datagrams of  
+ * maxDatagramSize bytes), at most kMaxBatchesPerWakeup batches per event so  
+ * one busy socket cannot starve the rest of the loop. Truncated datagrams  
+ * are dropped and counted.  
+ * 
+ * Sending: sendTo()/send() only queue the datagram; everything queued during  
+ * one loop iteration goes out together through sendmmsg(). When the kernel  
+ * buffer is full the queue waits for writability; beyond  
+ * kMaxPendingDatagrams new datagrams are dropped, as UDP would anyway.  
+ * 
+ * sendTo()/send() may be called from any thread, everything else belongs to  
+ * the loop thread. Destroy the socket on its loop thread, and not while  
+ * another thread is inside sendTo()/send(); work already queued on the loop  
+ * checks lifeline_ and is dropped once the socket is gone.  
+ */
+
+class UdpSocket : Noncopyable {
+public:
+    // peer points into the receive batch: valid during the callback only
+    using MessageCallback = std::function<void(UdpSocket&, std::string_view, const sockaddr_in&, Timestamp)>;
+
+    static constexpr size_t kDefaultBatchSize = 64;
+    static constexpr size_t kDefaultMaxDatagramSize = 2048;
+    static constexpr int kMaxBatchesPerWakeup = 4;
+    static constexpr size_t kMaxPendingDatagrams = 65536;
+
+    UdpSocket(EventLoop* loop,
+              const InetAddress& bindAddr,
+              bool reuseport = false,
+              size_t batchSize = kDefaultBatchSize,
+              size_t maxDatagramSize = kDefaultMaxDatagramSize);
+    ~UdpSocket() noexcept;
+
+    void setMessageCallback(MessageCallback cb) noexcept { messageCallback_ = std::move(cb); }
+
+    // Loop thread; starts delivering datagrams to the message callback
+    void startReading();
+    // Fixes the default peer for send(); datagrams from other peers are filtered by the kernel
+    void connect(const InetAddress& peer);
+
+    void sendTo(const sockaddr_in& peer, std::string_view data);
+    void sendTo(const InetAddress& peer, std::string_view data) { sendTo(*peer.getSockAddr(), data); }
+    void send(std::string_view data);
+
+    [[nodiscard]] EventLoop* getLoop() const noexcept { return loop_; }
+    [[nodiscard]] int fd() const noexcept { return socket_.fd(); }
+    [[nodiscard]] InetAddress localAddress() const;
+
+    [[nodiscard]] uint64_t datagramsReceived() const noexcept { return received_.load(std::memory_order_relaxed); }
+    [[nodiscard]] uint64_t datagramsSent() const noexcept { return sent_.load(std::memory_order_relaxed); }
+    [[nodiscard]] uint64_t datagramsDropped() const noexcept { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    struct PendingDatagram {
+        sockaddr_in peer;   // sin_family == AF_UNSPEC: the connected peer
+        std::string data;
+    };
+
+    static int createNonblocking();
+    void queueDatagram(const sockaddr_in& peer, std::string data);
+    void handleRead(Timestamp receiveTime);
+    void handleWrite();
+    void flushOutput();
+
+    EventLoop* loop_;
+    Socket socket_;
+    Channel channel_;
+    MessageCallback messageCallback_;
+
+    const size_t batchSize_;
+    const size_t maxDatagramSize_;
+    std::vector<char> recvBuffers_;
+    std::vector<iovec> recvIovecs_;
+    std::vector<sockaddr_in> recvAddrs_;
+    std::vector<mmsghdr> recvMsgs_;
+
+    std::vector<PendingDatagram> outQueue_;
+    std::vector<iovec> sendIovecs_;
+    std::vector<mmsghdr> sendMsgs_;
+    bool flushQueued_;
+    // Expires with the socket; queued functors hold a weak_ptr to it
+    std::shared_ptr<void> lifeline_{std::make_shared<char>()};
+
+    std::atomic<uint64_t> received_{0};
+    std::atomic<uint64_t> sent_{0};
+    std::atomic<uint64_t> dropped_{0};
+};
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "Noncopyable.hpp"
+#include "Thread.hpp"
+
+/*
+ * Compute pool for CPU-heavy work that must not run on an IO thread.  
+ * 
+ * - Each worker owns a deque: it pops its own tasks from the front (FIFO,  
+ *   keeps queueing delay fair) while idle workers steal from the back of  
+ *   the others.  
+ * - submit() from a worker thread pushes onto that worker's deque;  
+ *   submissions from other threads (IO loops) are spread round-robin.  
+ * - Idle workers sleep on a condition variable and are only signalled  
+ *   when someone is actually sleeping.  
+ * - A pool is started once. Before start() and after stop(), submit() runs  
+ *   the task inline on the caller; stop() lets the workers finish every  
+ *   queued task first, so no submitted task is ever dropped.  
+ * 
+ * TcpConnection::offload() builds on this to run a handler off-loop and  
+ * post the result back to the owning loop in submission order.  
+ */
+
+class WorkStealingPool : Noncopyable {
+public:
+    using Task = std::function<void()>;
+
+    explicit WorkStealingPool(std::string name = "WorkStealingPool");
+    ~WorkStealingPool();
+
+    void start(int numThreads);
+    void stop();
+    void submit(Task task);
+
+    [[nodiscard]] size_t numThreads() const noexcept { return workers_.size(); }
+    [[nodiscard]] size_t pendingTasks() const noexcept { 
+        return pending_.load(std::memory_order_relaxed); 
+    }
+    [[nodiscard]] const std::string& name() const noexcept { return name_; }
+
+private:
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    enum class State { kIdle, kRunning, kStopped };
+
+    static void runTask(Task& task) noexcept;
+    void workerLoop(size_t index);
+    bool popLocal(size_t index, Task& task);
+    bool steal(size_t thief, Task& task);
+    void push(size_t index, Task task);
+
+    const std::string name_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::vector<std::unique_ptr<Thread>> threads_;
+    std::atomic<State> state_;
+    std::atomic_int submitting_;   // submit() calls between their state check and push
+    std::atomic<size_t> next_;
+    std::atomic<size_t> pending_;
+    std::atomic_int sleeping_;
+    std::mutex sleepMutex_;
+    std::condition_variable sleepCond_;
+};
@@ -1,33 +1,76 @@
 #include <sys/socket.h>
+#include <sys/stat.h>
 #include <cerrno>
+#include <cstring>
+#include <fcntl.h>
 #include <unistd.h>
 
 #include <muduo/Acceptor.hpp>
 
 Acceptor::Acceptor(EventLoop* loop, const InetAddress& listenAddr, bool reuseport)
     : loop_(loop),
-      acceptSocket_(createNonblocking()),
+      acceptSocket_(createNonblocking(listenAddr.family())),
       acceptChannel_(loop, acceptSocket_.fd()),
-      listenning_(false) {
-    acceptSocket_.setReuseAddr(Socket::ENABLE);
-    acceptSocket_.setReusePort(reuseport ? Socket::ENABLE : Socket::DISABLE);
+      listenning_(false),
+      idleFd_(openIdleFd()),
+      maxAcceptsPerWakeup_(kDefaultMaxAcceptsPerWakeup) {
+    const bool socketFile = listenAddr.isUnix() && !listenAddr.isAbstractUnix();
+    if (socketFile) {
+        removeStaleSocketFile(listenAddr);
+    } else if (!listenAddr.isUnix()) {
+        acceptSocket_.setReuseAddr(Socket::ENABLE);
+        acceptSocket_.setReusePort(reuseport ? Socket::ENABLE : Socket::DISABLE);
+    }
     acceptSocket_.bindAddress(listenAddr);
+    if (socketFile) {
+        struct stat st{};
+        if (::lstat(listenAddr.toIp().c_str(), &st) == 0) {
+            socketPath_ = listenAddr.toIp();
+            socketDev_ = st.st_dev;
+            socketIno_ = st.st_ino;
+        }
+    }
     acceptChannel_.setReadCallback([this](Timestamp) { handleRead(); });
 }
 
 Acceptor::~Acceptor() noexcept {
+    if (resumeTimer_.valid()) {
+        loop_->cancel(resumeTimer_);
+    }
     acceptChannel_.disableAll();
     acceptChannel_.remove();
+    if (idleFd_ >= 0) {
+        ::close(idleFd_);
+    }
+    // Our socket file only: another server may have replaced it since
+    struct stat st{};
+    if (!socketPath_.empty() && ::lstat(socketPath_.c_str(), &st) == 0 &&
+        S_ISSOCK(st.st_mode) && st.st_dev == socketDev_ && st.st_ino == socketIno_) {
+        ::unlink(socketPath_.c_str());
+    }
 }
 
 void Acceptor::setNewConnectionCallback(NewConnectionCallback cb) noexcept {
     NewConnectionCallback_ = std::move(cb);
 }
 
+void Acceptor::setRejectedAcceptCallback(RejectedAcceptCallback cb) noexcept {
+    rejectedAcceptCallback_ = std::move(cb);
+}
+
 bool Acceptor::listenning() const noexcept { 
     return listenning_; 
 }
 
+InetAddress Acceptor::listenAddress() const {
+    sockaddr_storage addr{};
+    socklen_t len = sizeof(addr);
+    if (::getsockname(acceptSocket_.fd(), reinterpret_cast<sockaddr*>(&addr), &len) != 0) {
+        return InetAddress();
+    }
+    return InetAddress(reinterpret_cast<const sockaddr*>(&addr), len);
+}
+
 void Acceptor::listen() {
     loop_->isInLoopThread();
     listenning_ = true;
@@ -35,9 +78,9 @@ void Acceptor::listen() {
     acceptChannel_.enableReading();
 }
 
-int Acceptor::createNonblocking() {
+int Acceptor::createNonblocking(sa_family_t family) {
     constexpr int socktype = SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC;
-    int sockfd = ::socket(AF_INET, socktype, IPPROTO_TCP);
+    int sockfd = ::socket(family, socktype, family == AF_UNIX ? 0 : IPPROTO_TCP);
     if (sockfd < 0) {
         char buf[64];
 		strerror_r(errno, buf, sizeof(buf));
@@ -46,39 +89,115 @@ int Acceptor::createNonblocking() {
     return sockfd;
 }
 
+// A socket file left behind by a crashed run would make bind() fail. Only a
+// socket nobody listens on is removed; anything else is left for bind() to report
+void Acceptor::removeStaleSocketFile(const InetAddress& listenAddr) {
+    const std::string path = listenAddr.toIp();
+    struct stat st{};
+    if (::lstat(path.c_str(), &st) != 0 || !S_ISSOCK(st.st_mode)) {
+        return;
+    }
+    const int probe = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (probe < 0) {
+        return;
+    }
+    const bool refused = ::connect(probe, listenAddr.sockAddr(), listenAddr.sockLen()) != 0 &&
+                         errno == ECONNREFUSED;
+    ::close(probe);
+    if (refused) {
+        LOG_DEBUG("Removing stale socket file {}", path);
+        ::unlink(path.c_str());
+    }
+}
+
+int Acceptor::openIdleFd() noexcept {
+    const int fd = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        LOG_ERROR("Acceptor failed to reserve idle fd: {}", strerror(errno));
+    }
+    return fd;
+}
+
 void Acceptor::handleRead() {
     loop_->isInLoopThread();
-    InetAddress peerAddr;
-    int connfd = acceptSocket_.accept(&peerAddr);
-    
-    if (connfd >= 0) {
-        if (NewConnectionCallback_) {
-            NewConnectionCallback_(connfd, peerAddr);
-        } else {
-            ::close(connfd);
-            LOG_DEBUG("No connection callback set, closing fd: %d", connfd);
+
+    for (int i = 0; i < maxAcceptsPerWakeup_; ++i) {
+        InetAddress peerAddr;
+        const int connfd = acceptSocket_.accept(&peerAddr);
+
+        if (connfd >= 0) {
+            if (NewConnectionCallback_) {
+                NewConnectionCallback_(connfd, peerAddr);
+            } else {
+                ::close(connfd);
+                LOG_DEBUG("No connection callback set, closing fd: {}", connfd);
+            }
+            continue;
+        }
+
+        const int err = errno;
+        if (err == EAGAIN || err == EWOULDBLOCK || !handleAcceptError(err)) {
+            break;
         }
-    } else {
-        handleAcceptError(errno);
     }
 }
 
-void Acceptor::handleAcceptError(int err) {
-    constexpr int kEMFILE = EMFILE;
-    constexpr int kENFILE = ENFILE;
-    
-   char buf[64];
+// Returns true when draining the backlog should continue
+bool Acceptor::handleAcceptError(int err) {
+    char buf[64];
     switch (err) {
-    case kEMFILE:
-    case kENFILE:
-		strerror_r(errno, buf, sizeof(buf));
-		LOG_FATAL("Create acceptor socket error: {}", buf);
-        if (highWaterMarkCallback_) {
-            highWaterMarkCallback_();
-        }
-        break;
+    case EMFILE:
+    case ENFILE:
+        return shedPendingConnection(err);
+    case ECONNABORTED:
+    case EINTR:
+    case EPROTO:
+    case EPERM:
+        // The peer gave up or a firewall rule refused it; the next one may be fine
+        LOG_DEBUG("Transient accept error: {}", strerror_r(err, buf, sizeof(buf)));
+        return true;
     default:
-		strerror_r(errno, buf, sizeof(buf));
-		LOG_FATAL("Create acceptor socket error: {}", buf);
+        LOG_ERROR("Accept error[{}]: {}", err, strerror_r(err, buf, sizeof(buf)));
+        return false;
+    }
+}
+
+bool Acceptor::shedPendingConnection(int err) {
+    if (idleFd_ < 0) {
+        // Lost on an earlier shed; descriptors may have been freed since
+        idleFd_ = openIdleFd();
     }
-}
\ No newline at end of file
+    if (idleFd_ < 0) {
+        // Nothing to shed with: stop polling a listen queue we cannot drain
+        pauseAccepting();
+        return false;
+    }
+
+    ::close(idleFd_);
+    const int connfd = ::accept(acceptSocket_.fd(), nullptr, nullptr);
+    if (connfd >= 0) {
+        ::close(connfd);
+        rejectedAccepts_.fetch_add(1, std::memory_order_relaxed);
+        LOG_ERROR("Out of file descriptors, shed a pending connection (total rejected: {})",
+                  rejectedAccepts_.load(std::memory_order_relaxed));
+        if (rejectedAcceptCallback_) {
+            rejectedAcceptCallback_(err);
+        }
+    }
+    idleFd_ = openIdleFd();
+    return connfd >= 0 && idleFd_ >= 0;
+}
+
+void Acceptor::pauseAccepting() {
+    if (resumeTimer_.valid()) {
+        return;
+    }
+    LOG_ERROR("Acceptor out of file descriptors, pausing accepts for {}s", kAcceptRetryDelay);
+    acceptChannel_.disableReading();
+    resumeTimer_ = loop_->runAfter(kAcceptRetryDelay, [this] {
+        resumeTimer_ = TimerId();
+        if (listenning_) {
+            acceptChannel_.enableReading();
+        }
+    });
+}
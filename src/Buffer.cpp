@@ -6,6 +6,12 @@
 #include <muduo/Buffer.hpp>
 #include <muduo/Logger.hpp>
 
+namespace {
+constexpr size_t kExtraBufSize = 65536;
+// Only used for the duration of one readv(), so one per thread is enough
+thread_local char t_extrabuf[kExtraBufSize];
+}
+
 Buffer::Buffer(size_t initialSize) noexcept
     : buffer_(kCheapPrepend + initialSize),
       readerIndex_(kCheapPrepend),
@@ -38,16 +44,17 @@ void Buffer::append(const char* data, size_t len) {
     writerIndex_ += len;
 }
 
-ssize_t Buffer::readFd(int fd, std::error_code& ec) noexcept {
+ssize_t Buffer::readFd(int fd, std::error_code& ec, size_t maxBytes) noexcept {
     struct iovec vec[2];
-    const size_t writable = writableBytes();
+    const size_t writable = std::min(writableBytes(), maxBytes);
+    const size_t extra = std::min(kExtraBufSize, maxBytes - writable);
     
     vec[0].iov_base = beginWrite();
     vec[0].iov_len = writable;
-    vec[1].iov_base = extrabuf_.data();
-    vec[1].iov_len = extrabuf_.size();
+    vec[1].iov_base = t_extrabuf;
+    vec[1].iov_len = extra;
 
-    const int iovcnt = (writable < extrabuf_.size()) ? 2 : 1;
+    const int iovcnt = (writable < kExtraBufSize && extra > 0) ? 2 : 1;
     const ssize_t n = ::readv(fd, vec, iovcnt);
     
     if (n < 0) {
@@ -55,18 +62,17 @@ ssize_t Buffer::readFd(int fd, std::error_code& ec) noexcept {
         return -1;
     }
 
-    handleReadResult(static_cast<size_t>(n), writable);
+    handleReadResult(static_cast<size_t>(n), writable, t_extrabuf);
     return n;
 }
 
-ssize_t Buffer::writeFd(int fd, std::error_code& ec) noexcept {
-    const size_t readable = readableBytes();
+ssize_t Buffer::writeFd(int fd, std::error_code& ec, size_t maxBytes) noexcept {
+    const size_t readable = std::min(readableBytes(), maxBytes);
     const ssize_t n = ::write(fd, peek(), readable);
     if (n < 0) {
         ec.assign(errno, std::system_category());
         return -1;
     }
-    readerIndex_ += static_cast<size_t>(n);  
     return n;
 }
 
@@ -88,11 +94,11 @@ void Buffer::makeSpace(size_t len) {
     }
 }
 
-void Buffer::handleReadResult(size_t n, size_t writable) noexcept {
+void Buffer::handleReadResult(size_t n, size_t writable, const char* extra) noexcept {
     if (n <= writable) {
         writerIndex_ += n;
     } else {
-        writerIndex_ = buffer_.size();
-        append(extrabuf_.data(), n - writable);
+        writerIndex_ += writable;
+        append(extra, n - writable);
     }
 }
\ No newline at end of file
@@ -0,0 +1,58 @@
+#include <chrono>
+#include <cmath>
+
+#include <muduo/CoDelController.hpp>
+
+void CoDelController::enable(int64_t targetUs, int64_t intervalUs) noexcept {
+    targetUs_.store(targetUs, std::memory_order_relaxed);
+    intervalUs_.store(intervalUs, std::memory_order_relaxed);
+    enabled_.store(true, std::memory_order_relaxed);
+}
+
+void CoDelController::recordSojourn(int64_t sojournUs, int64_t nowUs) noexcept {
+    lastSojournUs_.store(sojournUs, std::memory_order_relaxed);
+
+    if (sojournUs < targetUs_.load(std::memory_order_relaxed)) {
+        firstAboveUs_ = 0;
+        if (overloaded_.exchange(false, std::memory_order_relaxed)) {
+            std::lock_guard<std::mutex> lock(dropMutex_);
+            dropCount_ = 0;
+        }
+        return;
+    }
+
+    if (firstAboveUs_ == 0) {
+        firstAboveUs_ = nowUs + intervalUs_.load(std::memory_order_relaxed);
+    } else if (nowUs >= firstAboveUs_) {
+        overloaded_.store(true, std::memory_order_relaxed);
+    }
+}
+
+bool CoDelController::shouldShedRequest() noexcept {
+    if (!overloaded_.load(std::memory_order_relaxed) ||
+        dispatchSojournUs_ < targetUs_.load(std::memory_order_relaxed)) {
+        return false;
+    }
+    shedCount_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool CoDelController::shouldShed() {
+    if (!overloaded_.load(std::memory_order_relaxed)) {
+        return false;
+    }
+
+    const int64_t nowUs = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+
+    std::lock_guard<std::mutex> lock(dropMutex_);
+    if (dropCount_ != 0 && nowUs < dropNextUs_) {
+        return false;
+    }
+
+    ++dropCount_;
+    const auto interval = static_cast<double>(intervalUs_.load(std::memory_order_relaxed));
+    dropNextUs_ = nowUs + static_cast<int64_t>(interval / std::sqrt(static_cast<double>(dropCount_)));
+    shedCount_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
@@ -0,0 +1,207 @@
+#include <sys/socket.h>
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+#include <unistd.h>
+
+#include <muduo/Connector.hpp>
+#include <muduo/Logger.hpp>
+
+namespace {
+
+int socketError(int sockfd) noexcept {
+    int optval = 0;
+    socklen_t optlen = sizeof(optval);
+    if (::getsockopt(sockfd, SOL_SOCKET, SO_ERROR, &optval, &optlen) < 0) {
+        return errno;
+    }
+    return optval;
+}
+
+// A TCP connect to a local port in the ephemeral range can end up connected to itself
+bool isSelfConnect(int sockfd) noexcept {
+    sockaddr_in local{};
+    sockaddr_in peer{};
+    socklen_t len = sizeof(local);
+    if (::getsockname(sockfd, reinterpret_cast<sockaddr*>(&local), &len) != 0) {
+        return false;
+    }
+    len = sizeof(peer);
+    if (::getpeername(sockfd, reinterpret_cast<sockaddr*>(&peer), &len) != 0) {
+        return false;
+    }
+    return local.sin_port == peer.sin_port && local.sin_addr.s_addr == peer.sin_addr.s_addr;
+}
+
+} // namespace
+
+Connector::Connector(EventLoop* loop, const InetAddress& serverAddr)
+    : loop_(loop),
+      serverAddr_(serverAddr),
+      connect_(false),
+      state_(State::Disconnected),
+      initRetryDelay_(kDefaultInitRetryDelay),
+      maxRetryDelay_(kDefaultMaxRetryDelay),
+      retryDelay_(kDefaultInitRetryDelay) {
+    LOG_DEBUG("Connector created for {}", serverAddr_.toIpPort());
+}
+
+Connector::~Connector() {
+    LOG_DEBUG("Connector destroyed for {}", serverAddr_.toIpPort());
+}
+
+void Connector::setRetryDelays(double initial, double max) noexcept {
+    initRetryDelay_ = initial;
+    maxRetryDelay_ = std::max(initial, max);
+    retryDelay_ = initial;
+}
+
+void Connector::start() {
+    connect_ = true;
+    loop_->runInLoop([self = shared_from_this()] { self->startInLoop(); });
+}
+
+void Connector::restart() {
+    loop_->isInLoopThread();
+    connect_ = true;
+    // Only a connection that stayed up a while earns a fresh backoff; a server
+    // that accepts and drops right away is retried ever more slowly
+    const double uptime = timeDifference(Timestamp::now(), connectedAt_);
+    if (uptime >= kMinStableUptime) {
+        retryDelay_ = initRetryDelay_;
+    }
+    retry(-1);
+}
+
+void Connector::stop() {
+    connect_ = false;
+    loop_->queueInLoop([self = shared_from_this()] { self->stopInLoop(); });
+}
+
+void Connector::startInLoop() {
+    if (connect_ && state_ == State::Disconnected) {
+        connect();
+    } else {
+        LOG_DEBUG("Connector to {} not started", serverAddr_.toIpPort());
+    }
+}
+
+void Connector::stopInLoop() {
+    if (retryTimer_.valid()) {
+        loop_->cancel(retryTimer_);
+        retryTimer_ = TimerId();
+    }
+    if (state_ == State::Connecting) {
+        state_ = State::Disconnected;
+        ::close(removeAndResetChannel());
+    }
+}
+
+void Connector::connect() {
+    const sa_family_t family = serverAddr_.family();
+    const int sockfd = ::socket(family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                                family == AF_UNIX ? 0 : IPPROTO_TCP);
+    if (sockfd < 0) {
+        LOG_ERROR("Connector failed to create socket: {}", strerror(errno));
+        retry(-1);
+        return;
+    }
+
+    const int ret = ::connect(sockfd, serverAddr_.sockAddr(), serverAddr_.sockLen());
+    const int err = (ret == 0) ? 0 : errno;
+    switch (err) {
+    case 0:
+    case EINPROGRESS:
+    case EINTR:
+    case EISCONN:
+        connecting(sockfd);
+        break;
+    case EAGAIN:
+    case EADDRINUSE:
+    case EADDRNOTAVAIL:
+    case ECONNREFUSED:
+    case ENETUNREACH:
+    case EHOSTUNREACH:
+    case ETIMEDOUT:
+    case ENOENT:        // unix socket path not created yet
+        retry(sockfd);
+        break;
+    default:
+        LOG_ERROR("Connect to {} failed[{}]: {}", serverAddr_.toIpPort(), err, strerror(err));
+        ::close(sockfd);
+        state_ = State::Disconnected;
+        break;
+    }
+}
+
+void Connector::connecting(int sockfd) {
+    state_ = State::Connecting;
+    channel_ = std::make_unique<Channel>(loop_, sockfd);
+    channel_->setWriteCallback([this] { handleWrite(); });
+    channel_->setErrorCallback([this] { handleError(); });
+    channel_->tie(shared_from_this());
+    channel_->enableWriting();
+}
+
+void Connector::handleWrite() {
+    if (state_ != State::Connecting) {
+        return;
+    }
+
+    const int sockfd = removeAndResetChannel();
+    if (const int err = socketError(sockfd); err != 0) {
+        LOG_DEBUG("Connect to {} failed: {}", serverAddr_.toIpPort(), strerror(err));
+        retry(sockfd);
+    } else if (!serverAddr_.isUnix() && isSelfConnect(sockfd)) {
+        LOG_DEBUG("Self connect to {}, retrying", serverAddr_.toIpPort());
+        retry(sockfd);
+    } else {
+        state_ = State::Connected;
+        connectedAt_ = Timestamp::now();
+        if (connect_ && newConnectionCallback_) {
+            newConnectionCallback_(sockfd);
+        } else {
+            ::close(sockfd);
+        }
+    }
+}
+
+void Connector::handleError() {
+    if (state_ == State::Connecting) {
+        const int sockfd = removeAndResetChannel();
+        LOG_DEBUG("Connector error on {}: {}", serverAddr_.toIpPort(), strerror(socketError(sockfd)));
+        retry(sockfd);
+    }
+}
+
+void Connector::retry(int sockfd) {
+    if (sockfd >= 0) {
+        ::close(sockfd);
+    }
+    state_ = State::Disconnected;
+    if (!connect_) {
+        return;
+    }
+
+    LOG_DEBUG("Retrying {} in {}s", serverAddr_.toIpPort(), retryDelay_);
+    retryTimer_ = loop_->runAfter(retryDelay_, [weak = weak_from_this()] {
+        if (auto self = weak.lock()) {
+            self->retryTimer_ = TimerId();
+            self->startInLoop();
+        }
+    });
+    retryDelay_ = std::min(retryDelay_ * 2, maxRetryDelay_);
+}
+
+// The channel is still inside its own handleEvent, so it is freed on the next pass
+int Connector::removeAndResetChannel() {
+    channel_->disableAll();
+    channel_->remove();
+    const int sockfd = channel_->fd();
+    loop_->queueInLoop([self = shared_from_this()] {
+        if (self->state_ != State::Connecting) {
+            self->channel_.reset();
+        }
+    });
+    return sockfd;
+}
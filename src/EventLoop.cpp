@@ -2,13 +2,23 @@
 #include <unistd.h>
 #include <cerrno>
 #include <cstring>
+#include <algorithm>
+#include <chrono>
 
 #include <muduo/EventLoop.hpp>
 #include <muduo/Channel.hpp>
 #include <muduo/Poller.hpp>
+#include <muduo/TimerQueue.hpp>
 
 __thread EventLoop* EventLoop::t_loopInThisThread = nullptr;
 
+namespace {
+int64_t monotonicUs() noexcept {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+}
+
 EventLoop::EventLoop()
     : looping_(false),
       quit_(false),
@@ -16,6 +26,7 @@ EventLoop::EventLoop()
       poller_(Poller::newDefaultPoller(this)),
       wakeupFd_(createEventfd()),
       wakeupChannel_(new Channel(this, wakeupFd_)),
+      timerQueue_(std::make_unique<TimerQueue>(this)),
       callingPendingFunctors_(false) 
 {
     DEBUG_LOG("[EventLoop] Created @{}", static_cast<void*>(this));
@@ -28,6 +39,7 @@ EventLoop::EventLoop()
 
     wakeupChannel_->setReadCallback([this](Timestamp){ handleRead(); });
     wakeupChannel_->enableReading();
+    framePool_.bindToThisThread();
 }
 
 EventLoop::~EventLoop() {
@@ -35,6 +47,7 @@ EventLoop::~EventLoop() {
     wakeupChannel_->disableAll();
     wakeupChannel_->remove();
     ::close(wakeupFd_);
+    framePool_.unbindFromThisThread();
     t_loopInThisThread = nullptr;
 }
 
@@ -44,15 +57,42 @@ void EventLoop::loop() {
 
     LOG_DEBUG("[EventLoop] Starting loop @{}", static_cast<void*>(this));
 
+    windowStartUs_ = monotonicUs();
+    windowBusyUs_ = 0;
+
     while (!quit_.load(std::memory_order_acquire)) {
         activeChannels_.clear();
-        pollReturnTime_ = poller_->poll(kPollTimeMs, &activeChannels_);
+        idleSinceUs_.store(monotonicUs(), std::memory_order_relaxed);
+        // Announce the sleep before the last look at the mailboxes; a producer
+        // publishing after that look sees polling_ and wakes us
+        polling_.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        pollReturnTime_ = poller_->poll(hasMail() ? 0 : kPollTimeMs, &activeChannels_);
+        polling_.store(false, std::memory_order_relaxed);
+        wakeupPending_.store(false, std::memory_order_relaxed);
+        idleSinceUs_.store(0, std::memory_order_relaxed);
+        const int64_t busyStartUs = monotonicUs();
+        const bool measureDelay = overload_.enabled();
+        int64_t dispatchDelayUs = 0;
 
         for (Channel* channel : activeChannels_) {
             DEBUG_LOG("[EventLoop] Processing channel FD:{}", channel->fd());
+            if (measureDelay) {
+                dispatchDelayUs = lastBusyUs_ + monotonicUs() - busyStartUs;
+                overload_.beginDispatch(dispatchDelayUs);
+            }
             channel->handleEvent(pollReturnTime_);
         }
-        doPendingFunctors(); 
+        const int64_t functorDelayUs = doPendingFunctors(); 
+        for (size_t i = 0; i < mailboxes_.size(); ++i) {
+            mailboxes_[i]->drain();
+        }
+        const int64_t busyEndUs = monotonicUs();
+        accountBusyTime(busyStartUs, busyEndUs);
+        if (measureDelay) {
+            overload_.recordSojourn(std::max(dispatchDelayUs, functorDelayUs), busyEndUs);
+        }
+        lastBusyUs_ = busyEndUs - busyStartUs;
     }
 
     LOG_DEBUG("[EventLoop] Stopped loop @{}", static_cast<void*>(this));
@@ -77,7 +117,12 @@ void EventLoop::runInLoop(Functor cb) {
 void EventLoop::queueInLoop(Functor cb) {
     {
         std::unique_lock<std::mutex> lock(mutex_);
+        if (pendingFunctors_.empty()) {
+            pendingSinceUs_ = monotonicUs();
+        }
         pendingFunctors_.emplace_back(std::move(cb));
+        // Under the lock, or the consumer's fetch_sub could run first and wrap around
+        pendingCount_.fetch_add(1, std::memory_order_relaxed);
     }
 
     if (!isInLoopThread() || callingPendingFunctors_.load()) {
@@ -85,6 +130,42 @@ void EventLoop::queueInLoop(Functor cb) {
     }
 }
 
+void EventLoop::addMailbox(Mailbox* mailbox) {
+    mailboxes_.push_back(mailbox);
+}
+
+void EventLoop::removeMailbox(Mailbox* mailbox) {
+    mailboxes_.erase(std::remove(mailboxes_.begin(), mailboxes_.end(), mailbox), mailboxes_.end());
+}
+
+bool EventLoop::hasMail() const noexcept {
+    return std::any_of(mailboxes_.begin(), mailboxes_.end(), [](const Mailbox* m) { return !m->empty(); });
+}
+
+// Pairs with the fence in loop(): the producer published before its own fence
+void EventLoop::wakeupIfPolling() noexcept {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (polling_.load(std::memory_order_relaxed) && !wakeupPending_.exchange(true, std::memory_order_relaxed)) {
+        wakeup();
+    }
+}
+
+TimerId EventLoop::runAt(Timestamp time, Functor cb) {
+    return timerQueue_->addTimer(std::move(cb), time, 0.0);
+}
+
+TimerId EventLoop::runAfter(double delay, Functor cb) {
+    return runAt(addTime(Timestamp::now(), delay), std::move(cb));
+}
+
+TimerId EventLoop::runEvery(double interval, Functor cb) {
+    return timerQueue_->addTimer(std::move(cb), addTime(Timestamp::now(), interval), interval);
+}
+
+void EventLoop::cancel(TimerId timerId) {
+    timerQueue_->cancel(timerId);
+}
+
 void EventLoop::updateChannel(Channel* channel) { 
     DEBUG_LOG("[EventLoop] Updating channel FD:{}", channel->fd());
     poller_->updateChannel(channel); 
@@ -124,19 +205,54 @@ void EventLoop::wakeup() {
     }
 }
 
-void EventLoop::doPendingFunctors() {
+// Returns how long the oldest functor of this batch waited, in microseconds
+int64_t EventLoop::doPendingFunctors() {
     std::vector<Functor> functors;
+    int64_t queuedSinceUs = 0;
     callingPendingFunctors_.store(true);
 
     {
         std::unique_lock<std::mutex> lock(mutex_);
         functors.swap(pendingFunctors_);
+        queuedSinceUs = pendingSinceUs_;
+        pendingCount_.fetch_sub(functors.size(), std::memory_order_relaxed);
     }
 
+    const int64_t waitedUs = functors.empty() ? 0 : monotonicUs() - queuedSinceUs;
+
     DEBUG_LOG("[EventLoop] Executing {} pending functors", functors.size());
     for (const auto& functor : functors) {
         functor();
     }
 
     callingPendingFunctors_.store(false);
-}
\ No newline at end of file
+    return waitedUs;
+}
+
+EventLoop::LoadStats EventLoop::loadStats() const noexcept {
+    int busy = busyPermille_.load(std::memory_order_relaxed);
+    const int64_t idleSince = idleSinceUs_.load(std::memory_order_relaxed);
+    if (idleSince != 0 && monotonicUs() - idleSince > kLoadWindowUs) {
+        busy = 0;   // parked in poll() for a whole window, the last sample is stale
+    }
+    return LoadStats{activeConnections_.load(std::memory_order_relaxed) +
+                         dispatchedConnections_.load(std::memory_order_relaxed),
+                     pendingCount_.load(std::memory_order_relaxed),
+                     busy};
+}
+
+void EventLoop::accountBusyTime(int64_t busyStartUs, int64_t busyEndUs) noexcept {
+    windowBusyUs_ += busyEndUs - busyStartUs;
+
+    const int64_t elapsed = busyEndUs - windowStartUs_;
+    if (elapsed < kLoadWindowUs) {
+        return;
+    }
+
+    const int sample = static_cast<int>(windowBusyUs_ * 1000 / elapsed);
+    const int previous = busyPermille_.load(std::memory_order_relaxed);
+    busyPermille_.store((previous + sample) / 2, std::memory_order_relaxed);
+
+    windowStartUs_ = busyEndUs;
+    windowBusyUs_ = 0;
+}
@@ -1,14 +1,79 @@
+#include <sys/un.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <random>
 #include <sstream>
 #include <utility>
 
 #include <muduo/EventLoopThreadPool.hpp>
 
+namespace {
+uint64_t mix64(uint64_t x) noexcept {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+// FNV-1a, finished with mix64 so nearby inputs still spread over the ring
+uint64_t hashBytes(const void* data, size_t len) noexcept {
+    uint64_t h = 1469598103934665603ULL;
+    for (const auto* p = static_cast<const unsigned char*>(data); len > 0; --len, ++p) {
+        h = (h ^ *p) * 1099511628211ULL;
+    }
+    return mix64(h);
+}
+
+// What identifies the peer's host: its IPv4 or IPv6 address, never the
+// ephemeral port, which changes on every reconnect. An IPv4-mapped IPv6
+// address hashes like the IPv4 one. A unix peer is identified by its path;
+// false when there is nothing to hash (an unnamed unix peer)
+bool hostKey(const InetAddress& peer, uint64_t* key) noexcept {
+    switch (peer.family()) {
+    case AF_INET:
+        *key = mix64(peer.getSockAddr()->sin_addr.s_addr);
+        return true;
+    case AF_INET6: {
+        const in6_addr& addr = reinterpret_cast<const sockaddr_in6*>(peer.sockAddr())->sin6_addr;
+        if (IN6_IS_ADDR_V4MAPPED(&addr)) {
+            uint32_t v4;
+            std::memcpy(&v4, addr.s6_addr + 12, sizeof(v4));
+            *key = mix64(v4);
+        } else {
+            *key = hashBytes(addr.s6_addr, sizeof(addr.s6_addr));
+        }
+        return true;
+    }
+    case AF_UNIX: {
+        constexpr socklen_t kPathOffset = offsetof(sockaddr_un, sun_path);
+        if (peer.sockLen() <= kPathOffset) {
+            return false;
+        }
+        *key = hashBytes(reinterpret_cast<const sockaddr_un*>(peer.sockAddr())->sun_path,
+                         peer.sockLen() - kPathOffset);
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+int64_t loadScore(const EventLoop::LoadStats& stats) noexcept {
+    return static_cast<int64_t>(stats.busyPermille) * 16 +
+           static_cast<int64_t>(stats.pendingFunctors) * 4 +
+           stats.activeConnections;
+}
+}
+
 EventLoopThreadPool::EventLoopThreadPool(EventLoop* baseLoop, std::string name)
     : baseLoop_(baseLoop),
       name_(std::move(name)),
       started_(false),
       numThreads_(0),
-      next_(0) {}
+      next_(0),
+      policy_(DispatchPolicy::kRoundRobin) {}
 
 EventLoopThreadPool::~EventLoopThreadPool() = default;
 
@@ -32,13 +97,43 @@ void EventLoopThreadPool::start(const ThreadInitCallback& cb) {
     if (numThreads_ == 0 && cb) {
         cb(baseLoop_);
     }
+
+    buildHashRing();
 }
 
 EventLoop* EventLoopThreadPool::getNextLoop() noexcept {
     if (loops_.empty()) {
         return baseLoop_;
     }
-    return loops_[next_.fetch_add(1, std::memory_order_relaxed) % loops_.size()];
+
+    switch (policy_) {
+        case DispatchPolicy::kLeastConnections:  return leastConnectionsLoop();
+        case DispatchPolicy::kPowerOfTwoChoices: return powerOfTwoLoop();
+        default:                                 return roundRobinLoop();
+    }
+}
+
+EventLoop* EventLoopThreadPool::getLoopFor(const InetAddress& peerAddr) {
+    EventLoop* loop = selectLoopFor(peerAddr);
+    loop->connectionDispatched();
+    return loop;
+}
+
+EventLoop* EventLoopThreadPool::selectLoopFor(const InetAddress& peerAddr) {
+    if (loops_.empty()) {
+        return baseLoop_;
+    }
+    if (selector_) {
+        if (EventLoop* loop = selector_(loops_, peerAddr)) {
+            return loop;
+        }
+    }
+    if (policy_ == DispatchPolicy::kConsistentHash) {
+        if (EventLoop* loop = consistentHashLoop(peerAddr)) {
+            return loop;
+        }
+    }
+    return getNextLoop();
 }
 
 std::vector<EventLoop*> EventLoopThreadPool::getAllLoops() const noexcept {
@@ -51,4 +146,63 @@ bool EventLoopThreadPool::started() const noexcept {
 
 const std::string& EventLoopThreadPool::name() const noexcept {
     return name_;
-}
\ No newline at end of file
+}
+
+EventLoop* EventLoopThreadPool::roundRobinLoop() noexcept {
+    return loops_[next_.fetch_add(1, std::memory_order_relaxed) % loops_.size()];
+}
+
+EventLoop* EventLoopThreadPool::leastConnectionsLoop() noexcept {
+    // Start the scan at a rotating offset so ties spread instead of piling on loop 0
+    const size_t n = loops_.size();
+    const size_t start = next_.fetch_add(1, std::memory_order_relaxed) % n;
+
+    EventLoop* best = loops_[start];
+    int bestCount = best->loadStats().activeConnections;
+    for (size_t i = 1; i < n && bestCount > 0; ++i) {
+        EventLoop* candidate = loops_[(start + i) % n];
+        const int count = candidate->loadStats().activeConnections;
+        if (count < bestCount) {
+            best = candidate;
+            bestCount = count;
+        }
+    }
+    return best;
+}
+
+EventLoop* EventLoopThreadPool::powerOfTwoLoop() noexcept {
+    const size_t n = loops_.size();
+    if (n == 1) {
+        return loops_.front();
+    }
+
+    thread_local std::minstd_rand rng{std::random_device{}()};
+    const size_t first = rng() % n;
+    const size_t second = (first + 1 + rng() % (n - 1)) % n;
+
+    EventLoop* a = loops_[first];
+    EventLoop* b = loops_[second];
+    return loadScore(a->loadStats()) <= loadScore(b->loadStats()) ? a : b;
+}
+
+EventLoop* EventLoopThreadPool::consistentHashLoop(const InetAddress& peerAddr) const noexcept {
+    uint64_t key;
+    if (!hostKey(peerAddr, &key)) {
+        return nullptr;
+    }
+    auto it = std::lower_bound(ring_.begin(), ring_.end(), key,
+        [](const auto& node, uint64_t value) { return node.first < value; });
+    return it == ring_.end() ? ring_.front().second : it->second;
+}
+
+void EventLoopThreadPool::buildHashRing() {
+    ring_.clear();
+    ring_.reserve(loops_.size() * kVirtualNodesPerLoop);
+    for (size_t i = 0; i < loops_.size(); ++i) {
+        for (int v = 0; v < kVirtualNodesPerLoop; ++v) {
+            ring_.emplace_back(mix64((static_cast<uint64_t>(i) << 32) | static_cast<uint64_t>(v)), loops_[i]);
+        }
+    }
+    std::sort(ring_.begin(), ring_.end(),
+        [](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; });
+}
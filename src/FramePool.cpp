@@ -0,0 +1,82 @@
+#include <algorithm>
+#include <new>
+
+#include <muduo/FramePool.hpp>
+
+namespace {
+thread_local FramePool* t_framePool = nullptr;
+}
+
+FramePool::~FramePool() {
+    for (FreeBlock* head : freeLists_) {
+        while (head) {
+            FreeBlock* next = head->next;
+            deleteBlock(head);
+            head = next;
+        }
+    }
+}
+
+void FramePool::bindToThisThread() noexcept {
+    t_framePool = this;
+}
+
+void FramePool::unbindFromThisThread() noexcept {
+    if (t_framePool == this) {
+        t_framePool = nullptr;
+    }
+}
+
+void* FramePool::allocate(size_t size, size_t alignment) {
+    // sizeof(Header) and alignment are powers of two, so the larger is a multiple of both
+    const size_t offset = std::max(sizeof(Header), alignment);
+    const size_t total = size + offset;
+    const size_t sizeClass = (total + kGranularity - 1) / kGranularity - 1;
+
+    FramePool* pool = (sizeClass < kNumClasses) ? t_framePool : nullptr;
+    char* block = static_cast<char*>(pool ? pool->take(sizeClass) : newBlock(total));
+
+    auto* header = reinterpret_cast<Header*>(block + offset) - 1;
+    header->pool = pool;
+    header->sizeClass = static_cast<uint32_t>(sizeClass);
+    header->offset = static_cast<uint32_t>(offset);
+    return block + offset;
+}
+
+void FramePool::deallocate(void* frame) noexcept {
+    auto* header = static_cast<Header*>(frame) - 1;
+    FramePool* pool = header->pool;
+    void* block = static_cast<char*>(frame) - header->offset;
+    if (pool && pool == t_framePool && pool->give(block, header->sizeClass)) {
+        return;
+    }
+    deleteBlock(block);
+}
+
+void* FramePool::newBlock(size_t size) {
+    return ::operator new(size, std::align_val_t{kBlockAlignment});
+}
+
+void FramePool::deleteBlock(void* block) noexcept {
+    ::operator delete(block, std::align_val_t{kBlockAlignment});
+}
+
+void* FramePool::take(size_t sizeClass) {
+    if (FreeBlock* block = freeLists_[sizeClass]) {
+        freeLists_[sizeClass] = block->next;
+        --cached_[sizeClass];
+        return block;
+    }
+    return newBlock((sizeClass + 1) * kGranularity);
+}
+
+bool FramePool::give(void* block, size_t sizeClass) noexcept {
+    if (cached_[sizeClass] >= kMaxCachedPerClass) {
+        return false;
+    }
+    auto* freeBlock = static_cast<FreeBlock*>(block);
+    freeBlock->next = freeLists_[sizeClass];
+    freeLists_[sizeClass] = freeBlock;
+    ++cached_[sizeClass];
+    return true;
+}
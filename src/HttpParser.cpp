@@ -0,0 +1,280 @@
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <string_view>
+
+#include <muduo/HttpParser.hpp>
+
+namespace {
+
+std::string_view trim(std::string_view s) noexcept {
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t')) s.remove_suffix(1);
+    return s;
+}
+
+} // namespace
+
+void HttpParser::reset() noexcept {
+    stage_ = Stage::kRequestLine;
+    pos_ = 0;
+    errorStatus_ = 0;
+    method_ = Span{};
+    target_ = Span{};
+    version_ = 11;
+    headers_.clear();
+    chunked_ = false;
+    contentLength_ = 0;
+    bodyOffset_ = 0;
+    chunkRemaining_ = 0;
+    trailersOffset_ = 0;
+    chunkedBody_.clear();
+}
+
+HttpParser::Result HttpParser::fail(int status) noexcept {
+    errorStatus_ = status;
+    return Result::kError;
+}
+
+// A line of the chunked framing is no longer than a header section may be
+HttpParser::Result HttpParser::incompleteLine(size_t readable) noexcept {
+    return readable - pos_ > kMaxHeaderBytes ? fail(431) : Result::kNeedMore;
+}
+
+bool HttpParser::nextLine(const char* base, size_t readable, Span* line) noexcept {
+    const void* found = std::memchr(base + pos_, '\n', readable - pos_);
+    if (!found) {
+        return false;
+    }
+    const size_t end = static_cast<const char*>(found) - base;
+    size_t length = end - pos_;
+    if (length > 0 && base[end - 1] == '\r') {
+        --length;
+    }
+    *line = Span{static_cast<uint32_t>(pos_), static_cast<uint32_t>(length)};
+    pos_ = end + 1;
+    return true;
+}
+
+HttpParser::Result HttpParser::parse(const Buffer& buf) {
+    const char* base = buf.peek();
+    const size_t readable = buf.readableBytes();
+    if (pos_ > readable) {
+        // The Buffer was retrieved behind the parser's back without a reset()
+        return fail(400);
+    }
+
+    while (stage_ != Stage::kDone) {
+        Span line;
+        switch (stage_) {
+        case Stage::kRequestLine:
+            if (!nextLine(base, readable, &line)) {
+                return readable > kMaxHeaderBytes ? fail(431) : Result::kNeedMore;
+            }
+            if (line.length == 0) {
+                // Tolerate stray CRLFs between pipelined requests (RFC 9112 2.2)
+                continue;
+            }
+            if (!parseRequestLine(base, line)) {
+                return errorStatus_ ? Result::kError : fail(400);
+            }
+            stage_ = Stage::kHeaders;
+            break;
+
+        case Stage::kHeaders:
+            if (!nextLine(base, readable, &line)) {
+                return readable > kMaxHeaderBytes ? fail(431) : Result::kNeedMore;
+            }
+            if (line.length == 0) {
+                if (const Result r = finishHeaders(base); r == Result::kError) {
+                    return r;
+                }
+            } else if (!parseHeader(base, line)) {
+                return fail(400);
+            }
+            break;
+
+        case Stage::kBody:
+            if (readable < bodyOffset_ + contentLength_) {
+                return Result::kNeedMore;
+            }
+            pos_ = bodyOffset_ + contentLength_;
+            stage_ = Stage::kDone;
+            break;
+
+        case Stage::kChunkSize:
+            if (!nextLine(base, readable, &line)) {
+                return incompleteLine(readable);
+            }
+            if (!parseChunkSize(base, line)) {
+                return errorStatus_ ? Result::kError : fail(400);
+            }
+            if (chunkRemaining_ == 0) {
+                stage_ = Stage::kTrailers;
+                trailersOffset_ = pos_;
+            } else {
+                stage_ = Stage::kChunkData;
+            }
+            break;
+
+        case Stage::kChunkData:
+            if (chunkRemaining_ > 0) {
+                const size_t n = std::min(chunkRemaining_, readable - pos_);
+                chunkedBody_.append(base + pos_, n);
+                pos_ += n;
+                chunkRemaining_ -= n;
+                if (chunkRemaining_ > 0) {
+                    return Result::kNeedMore;
+                }
+            }
+            if (!nextLine(base, readable, &line)) {
+                return incompleteLine(readable);
+            }
+            if (line.length != 0) {
+                return fail(400);
+            }
+            stage_ = Stage::kChunkSize;
+            break;
+
+        case Stage::kTrailers:
+            if (!nextLine(base, readable, &line)) {
+                return readable - trailersOffset_ > kMaxHeaderBytes ? fail(431) : Result::kNeedMore;
+            }
+            if (pos_ - trailersOffset_ > kMaxHeaderBytes) {
+                return fail(431);
+            }
+            if (line.length == 0) {
+                stage_ = Stage::kDone;
+            }
+            break;
+
+        case Stage::kDone:
+            break;
+        }
+    }
+
+    materialize(base);
+    return Result::kComplete;
+}
+
+bool HttpParser::parseRequestLine(const char* base, Span line) {
+    const std::string_view text(base + line.offset, line.length);
+    const size_t sp1 = text.find(' ');
+    const size_t sp2 = sp1 == std::string_view::npos ? sp1 : text.find(' ', sp1 + 1);
+    if (sp2 == std::string_view::npos || sp1 == 0 || sp2 == sp1 + 1) {
+        return false;
+    }
+
+    const std::string_view version = text.substr(sp2 + 1);
+    if (version == "HTTP/1.1") {
+        version_ = 11;
+    } else if (version == "HTTP/1.0") {
+        version_ = 10;
+    } else if (version.starts_with("HTTP/")) {
+        errorStatus_ = 505;
+        return false;
+    } else {
+        return false;
+    }
+
+    method_ = Span{line.offset, static_cast<uint32_t>(sp1)};
+    target_ = Span{static_cast<uint32_t>(line.offset + sp1 + 1), static_cast<uint32_t>(sp2 - sp1 - 1)};
+    return true;
+}
+
+bool HttpParser::parseHeader(const char* base, Span line) {
+    const std::string_view text(base + line.offset, line.length);
+    const size_t colon = text.find(':');
+    if (colon == std::string_view::npos || colon == 0) {
+        return false;
+    }
+    // No whitespace inside or around the field name (RFC 9112 5.1); a leading
+    // one would be an obsolete line folding
+    if (text.substr(0, colon).find_first_of(" \t") != std::string_view::npos) {
+        return false;
+    }
+    const std::string_view value = trim(text.substr(colon + 1));
+    headers_.emplace_back(Span{line.offset, static_cast<uint32_t>(colon)},
+                          Span{static_cast<uint32_t>(value.data() - base), static_cast<uint32_t>(value.size())});
+    return true;
+}
+
+HttpParser::Result HttpParser::finishHeaders(const char* base) {
+    bool hasLength = false;
+    for (const auto& [name, value] : headers_) {
+        const std::string_view key(base + name.offset, name.length);
+        const std::string_view val(base + value.offset, value.length);
+        if (HttpRequest::equalsIgnoreCase(key, "Transfer-Encoding")) {
+            const size_t comma = val.rfind(',');
+            const std::string_view last = trim(comma == std::string_view::npos ? val : val.substr(comma + 1));
+            if (!HttpRequest::equalsIgnoreCase(last, "chunked")) {
+                return fail(501);
+            }
+            chunked_ = true;
+        } else if (HttpRequest::equalsIgnoreCase(key, "Content-Length")) {
+            size_t length = 0;
+            const auto [end, ec] = std::from_chars(val.data(), val.data() + val.size(), length);
+            if (ec != std::errc() || end != val.data() + val.size() || (hasLength && length != contentLength_)) {
+                return fail(400);
+            }
+            contentLength_ = length;
+            hasLength = true;
+        }
+    }
+
+    // A chunked request must not also carry Content-Length (request smuggling)
+    if (chunked_ && hasLength) {
+        return fail(400);
+    }
+    if (contentLength_ > kMaxBodyBytes) {
+        return fail(413);
+    }
+
+    bodyOffset_ = pos_;
+    if (chunked_) {
+        stage_ = Stage::kChunkSize;
+    } else if (contentLength_ > 0) {
+        stage_ = Stage::kBody;
+    } else {
+        stage_ = Stage::kDone;
+    }
+    return Result::kNeedMore;
+}
+
+bool HttpParser::parseChunkSize(const char* base, Span line) {
+    std::string_view text(base + line.offset, line.length);
+    if (const size_t ext = text.find(';'); ext != std::string_view::npos) {
+        text = text.substr(0, ext);
+    }
+    text = trim(text);
+
+    size_t size = 0;
+    const auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), size, 16);
+    if (text.empty() || ec != std::errc() || end != text.data() + text.size()) {
+        return false;
+    }
+    if (chunkedBody_.size() + size > kMaxBodyBytes) {
+        errorStatus_ = 413;
+        return false;
+    }
+    chunkRemaining_ = size;
+    return true;
+}
+
+void HttpParser::materialize(const char* base) {
+    auto view = [base](Span span) { return std::string_view(base + span.offset, span.length); };
+
+    request_.method_ = view(method_);
+    request_.target_ = view(target_);
+    const size_t question = request_.target_.find('?');
+    request_.path_ = request_.target_.substr(0, question);
+    request_.query_ = question == std::string_view::npos ? std::string_view() : request_.target_.substr(question + 1);
+    request_.version_ = version_;
+
+    request_.headers_.clear();
+    for (const auto& [name, value] : headers_) {
+        request_.headers_.emplace_back(view(name), view(value));
+    }
+    request_.body_ = chunked_ ? std::string_view(chunkedBody_)
+                              : std::string_view(base + bodyOffset_, contentLength_);
+}
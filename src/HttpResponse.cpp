@@ -0,0 +1,66 @@
+#include <iterator>
+
+#include <fmt/format.h>
+
+#include <muduo/HttpResponse.hpp>
+
+void HttpResponse::appendChunk(std::string_view data) {
+    if (!chunked_) {
+        body_.clear();
+        chunked_ = true;
+    }
+    if (data.empty()) {
+        return;   // an empty chunk would end the body early
+    }
+    fmt::format_to(std::back_inserter(body_), "{:x}\r\n", data.size());
+    body_.append(data);
+    body_.append("\r\n");
+}
+
+void HttpResponse::appendTo(std::string& output, bool includeBody) const {
+    auto out = std::back_inserter(output);
+    fmt::format_to(out, "HTTP/1.1 {} {}\r\n", statusCode_, reason_);
+    for (const auto& [name, value] : headers_) {
+        fmt::format_to(out, "{}: {}\r\n", name, value);
+    }
+    if (chunked_) {
+        output.append("Transfer-Encoding: chunked\r\n");
+    } else {
+        fmt::format_to(out, "Content-Length: {}\r\n", body_.size());
+    }
+    output.append(closeConnection_ ? "Connection: close\r\n\r\n" : "Connection: keep-alive\r\n\r\n");
+
+    if (includeBody) {
+        output.append(body_);
+        if (chunked_) {
+            output.append("0\r\n\r\n");
+        }
+    }
+}
+
+std::string_view HttpResponse::defaultReason(int code) noexcept {
+    switch (code) {
+    case 100: return "Continue";
+    case 200: return "OK";
+    case 201: return "Created";
+    case 204: return "No Content";
+    case 301: return "Moved Permanently";
+    case 302: return "Found";
+    case 304: return "Not Modified";
+    case 400: return "Bad Request";
+    case 401: return "Unauthorized";
+    case 403: return "Forbidden";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 408: return "Request Timeout";
+    case 413: return "Content Too Large";
+    case 431: return "Request Header Fields Too Large";
+    case 500: return "Internal Server Error";
+    case 501: return "Not Implemented";
+    case 502: return "Bad Gateway";
+    case 503: return "Service Unavailable";
+    case 504: return "Gateway Timeout";
+    case 505: return "HTTP Version Not Supported";
+    default:  return "Unknown";
+    }
+}
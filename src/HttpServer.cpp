@@ -0,0 +1,73 @@
+#include <muduo/HttpServer.hpp>
+#include <muduo/Logger.hpp>
+
+HttpServer::HttpServer(EventLoop* loop,
+                       const InetAddress& listenAddr,
+                       std::string name,
+                       TcpServer::Option option)
+    : server_(loop, listenAddr, std::move(name), option) {
+    server_.setConnectionCallback([this](const TcpConnectionPtr& conn) { onConnection(conn); });
+    server_.setMessageCallback([this](const TcpConnectionPtr& conn, Buffer* buf, Timestamp t) {
+        onMessage(conn, buf, t);
+    });
+}
+
+void HttpServer::onConnection(const TcpConnectionPtr& conn) {
+    if (conn->connected()) {
+        conn->setContext<HttpParser>();
+    }
+}
+
+void HttpServer::onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp) {
+    HttpParser* parser = conn->getContext<HttpParser>();
+    if (!parser) {
+        buf->retrieveAll();
+        return;
+    }
+
+    std::string output;
+    for (;;) {
+        const HttpParser::Result result = parser->parse(*buf);
+        if (result == HttpParser::Result::kNeedMore) {
+            break;
+        }
+
+        if (result == HttpParser::Result::kError) {
+            LOG_DEBUG("HttpServer bad request on {}: {}", conn->name(), parser->errorStatus());
+            HttpResponse response(true);
+            response.setStatus(parser->errorStatus());
+            response.appendTo(output);
+            conn->send(output);
+            conn->shutdown();
+            // The parser stopped mid-request: drop it so whatever the client
+            // sends after the error is discarded, never parsed from a stale pos_
+            conn->resetContext();
+            buf->retrieveAll();
+            return;
+        }
+
+        const HttpRequest& request = parser->request();
+        HttpResponse response(!request.keepAlive());
+        if (httpCallback_) {
+            httpCallback_(request, &response);
+        } else {
+            response.setStatus(404);
+        }
+        response.appendTo(output, request.method() != "HEAD");
+
+        buf->retrieve(parser->requestLength());
+        parser->reset();
+
+        if (response.closeConnection()) {
+            conn->send(output);
+            conn->shutdown();
+            conn->resetContext();
+            buf->retrieveAll();
+            return;
+        }
+    }
+
+    if (!output.empty()) {
+        conn->send(output);
+    }
+}
@@ -1,18 +1,26 @@
 #include <arpa/inet.h>
 #include <cerrno>
+#include <cstddef>
 #include <cstring>
 #include <stdexcept>
 #include <array>
+#include <algorithm>
 
 #include <muduo/InetAddress.hpp>
 #include <muduo/Logger.hpp>
 
+namespace {
+
+constexpr socklen_t kUnixPathOffset = offsetof(sockaddr_un, sun_path);
+
+} // namespace
+
 InetAddress::InetAddress(uint16_t port, std::string_view ip) {
-    addr_ = {};
-    addr_.sin_family = AF_INET;
-    addr_.sin_port = htons(port);
+    auto* addr4 = reinterpret_cast<sockaddr_in*>(&addr_);
+    addr4->sin_family = AF_INET;
+    addr4->sin_port = htons(port);
 
-    if (inet_pton(AF_INET, ip.data(), &addr_.sin_addr) <= 0) {
+    if (inet_pton(AF_INET, ip.data(), &addr4->sin_addr) <= 0) {
         const auto err = errno;
         LOG_FATAL("InetAddress construction failed - IP: {}, Port: {}, Errno: {} ({})",
             ip, port, err, strerror(err));
@@ -25,11 +33,63 @@ InetAddress::InetAddress(uint16_t port, std::string_view ip) {
     }
 }
 
-InetAddress::InetAddress(const sockaddr_in& addr) noexcept : addr_(addr) {}
+InetAddress::InetAddress(const sockaddr_in& addr) noexcept {
+    setSockAddr(addr);
+}
+
+InetAddress::InetAddress(const sockaddr* addr, socklen_t len) noexcept {
+    setSockAddr(addr, len);
+}
+
+InetAddress InetAddress::fromUnixPath(std::string_view path) {
+    sockaddr_un un{};
+    un.sun_family = AF_UNIX;
+
+    const bool abstract = !path.empty() && path.front() == '@';
+    // Abstract names are not NUL-terminated, filesystem paths are
+    if (path.size() + (abstract ? 0 : 1) > sizeof(un.sun_path)) {
+        LOG_ERROR("Unix socket path too long: {}", path);
+        throw std::system_error(ENAMETOOLONG, std::generic_category(),
+                                "Unix socket path too long: " + std::string(path));
+    }
+
+    std::memcpy(un.sun_path, path.data(), path.size());
+    if (abstract) {
+        un.sun_path[0] = '\0';
+    }
+    const auto len = static_cast<socklen_t>(kUnixPathOffset + path.size() + (abstract ? 0 : 1));
+    return InetAddress(reinterpret_cast<const sockaddr*>(&un), len);
+}
+
+void InetAddress::setSockAddr(const sockaddr_in& addr) noexcept {
+    setSockAddr(reinterpret_cast<const sockaddr*>(&addr), sizeof(addr));
+}
+
+void InetAddress::setSockAddr(const sockaddr* addr, socklen_t len) noexcept {
+    addr_ = {};
+    len_ = std::min<socklen_t>(len, sizeof(addr_));
+    std::memcpy(&addr_, addr, len_);
+}
+
+bool InetAddress::isAbstractUnix() const noexcept {
+    const auto* un = reinterpret_cast<const sockaddr_un*>(&addr_);
+    return isUnix() && len_ > kUnixPathOffset && un->sun_path[0] == '\0';
+}
 
 std::string InetAddress::toIp() const {
+    if (isUnix()) {
+        const auto* un = reinterpret_cast<const sockaddr_un*>(&addr_);
+        if (len_ <= kUnixPathOffset) {
+            return "";
+        }
+        if (isAbstractUnix()) {
+            return "@" + std::string(un->sun_path + 1, len_ - kUnixPathOffset - 1);
+        }
+        return std::string(un->sun_path, strnlen(un->sun_path, len_ - kUnixPathOffset));
+    }
+
     std::array<char, INET_ADDRSTRLEN> buf{};
-    if (const char* ret = inet_ntop(AF_INET, &addr_.sin_addr, buf.data(), buf.size()); 
+    if (const char* ret = inet_ntop(AF_INET, &getSockAddr()->sin_addr, buf.data(), buf.size()); 
         ret != nullptr) {
         return buf.data();
     }
@@ -37,9 +97,12 @@ std::string InetAddress::toIp() const {
 }
 
 uint16_t InetAddress::toPort() const noexcept {
-    return ntohs(addr_.sin_port);
+    return isUnix() ? 0 : ntohs(getSockAddr()->sin_port);
 }
 
 std::string InetAddress::toIpPort() const {
+    if (isUnix()) {
+        return "unix:" + toIp();
+    }
     return toIp() + ":" + std::to_string(toPort());
-}
\ No newline at end of file
+}
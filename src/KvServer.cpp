@@ -0,0 +1,394 @@
+#include <array>
+#include <charconv>
+#include <limits>
+#include <strings.h>
+
+#include <muduo/KvServer.hpp>
+#include <muduo/Logger.hpp>
+
+namespace {
+
+size_t ownerOf(std::string_view key, size_t shardCount) noexcept {
+    return std::hash<std::string_view>{}(key) % shardCount;
+}
+
+bool parseInt64(std::string_view s, int64_t* value) noexcept {
+    const auto [ptr, ec] = std::from_chars(s.data(), s.data() + s.size(), *value);
+    return ec == std::errc() && ptr == s.data() + s.size() && !s.empty();
+}
+
+bool equalsIgnoreCase(std::string_view a, std::string_view b) noexcept {
+    return a.size() == b.size() && ::strncasecmp(a.data(), b.data(), a.size()) == 0;
+}
+
+void wrongArity(RespWriter& writer, std::string_view name) {
+    std::string message = "ERR wrong number of arguments for '";
+    for (char c : name) {
+        message += static_cast<char>(::tolower(static_cast<unsigned char>(c)));
+    }
+    message += "' command";
+    writer.error(message);
+}
+
+} // namespace
+
+KvServer::KvServer(EventLoop* loop,
+                   const InetAddress& listenAddr,
+                   std::string name,
+                   TcpServer::Option option)
+    : server_(loop, listenAddr, std::move(name), option) {
+    server_.setConnectionCallback([this](const TcpConnectionPtr& conn) { onConnection(conn); });
+    server_.setMessageCallback([this](const TcpConnectionPtr& conn, Buffer* buf, Timestamp t) {
+        onMessage(conn, buf, t);
+    });
+}
+
+void KvServer::start() {
+    if (shards_) {
+        return;
+    }
+    server_.start();
+
+    auto shards = std::make_shared<ShardList>();
+    const std::vector<EventLoop*> loops = server_.getAllLoops();
+    for (EventLoop* ioLoop : loops) {
+        auto shard = std::make_shared<Shard>();
+        shard->loop = ioLoop;
+        shard->index = shards->size();
+        shard->outbox.resize(loops.size());
+        shardByLoop_.emplace(ioLoop, shard.get());
+        shards->push_back(std::move(shard));
+    }
+    shards_ = std::move(shards);
+}
+
+KvServer::Shard* KvServer::shardOf(EventLoop* loop) const noexcept {
+    auto it = shardByLoop_.find(loop);
+    return it == shardByLoop_.end() ? nullptr : it->second;
+}
+
+void KvServer::onConnection(const TcpConnectionPtr& conn) {
+    if (conn->connected()) {
+        auto& session = conn->setContext<std::shared_ptr<Session>>(std::make_shared<Session>());
+        session->conn = conn;
+    }
+}
+
+void KvServer::onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp) {
+    const auto* context = conn->getContext<std::shared_ptr<Session>>();
+    Shard* local = shardOf(conn->getLoop());
+    if (!context || !local || (*context)->quit) {
+        buf->retrieveAll();
+        return;
+    }
+    // Remote commands share it: their replies may arrive after the connection is gone
+    const std::shared_ptr<Session>& session = *context;
+
+    const ShardList& shards = *shards_;
+    bool queuedRemote = false;
+    for (;;) {
+        const RespParser::Result result = session->parser.parse(*buf);
+        if (result == RespParser::Result::kNeedMore) {
+            break;
+        }
+
+        if (result == RespParser::Result::kError) {
+            LOG_DEBUG("KvServer protocol error on {}: {}", conn->name(), session->parser.error());
+            std::string reply;
+            RespWriter(reply, session->protocol).error(session->parser.error());
+            session->deliver(session->nextSeq++, std::move(reply));
+            session->quit = true;
+            buf->retrieveAll();
+            session->parser.reset();
+            break;
+        }
+
+        const std::vector<std::string_view>& args = session->parser.args();
+        const Command command = lookupCommand(args[0]);
+        const uint64_t seq = session->nextSeq++;
+
+        // Pick the shard holding the keys; connection-level commands stay local
+        size_t owner = local->index;
+        bool crossSlot = false;
+        if (command >= Command::kGet && args.size() >= 2) {
+            owner = ownerOf(args[1], shards.size());
+            for (size_t i = 2; i < args.size() && (command == Command::kDel || command == Command::kExists); ++i) {
+                crossSlot |= ownerOf(args[i], shards.size()) != owner;
+            }
+        }
+
+        if (crossSlot) {
+            std::string reply;
+            RespWriter(reply, session->protocol).error("CROSSSLOT Keys in request don't hash to the same slot");
+            session->deliver(seq, std::move(reply));
+        } else if (owner == local->index) {
+            Store* store = command >= Command::kGet ? &local->store : nullptr;
+            if (seq == session->nextToSend) {
+                // Nothing outstanding ahead of it: encode straight into the output
+                RespWriter writer(session->output, session->protocol);
+                execute(command, args, store, session.get(), writer);
+                ++session->nextToSend;
+            } else {
+                std::string reply;
+                RespWriter writer(reply, session->protocol);
+                execute(command, args, store, session.get(), writer);
+                session->deliver(seq, std::move(reply));
+            }
+        } else {
+            local->outbox[owner].push_back(
+                Request{session, seq, command, session->protocol, std::vector<std::string>(args.begin(), args.end())});
+            queuedRemote = true;
+        }
+
+        buf->retrieve(session->parser.requestLength());
+        session->parser.reset();
+        if (session->quit) {
+            buf->retrieveAll();
+            break;
+        }
+    }
+
+    session->flush();
+
+    if (queuedRemote && !local->flushQueued) {
+        local->flushQueued = true;
+        local->loop->queueInLoop([shards = shards_, origin = local->index] { flushOutbox(shards, origin); });
+    }
+}
+
+void KvServer::flushOutbox(const std::shared_ptr<const ShardList>& shards, size_t origin) {
+    const std::shared_ptr<Shard>& from = (*shards)[origin];
+    from->flushQueued = false;
+    for (size_t i = 0; i < from->outbox.size(); ++i) {
+        if (from->outbox[i].empty()) {
+            continue;
+        }
+        std::vector<Request> batch;
+        batch.swap(from->outbox[i]);
+        const std::shared_ptr<Shard>& owner = (*shards)[i];
+        owner->loop->runInLoop([owner, from, batch = std::move(batch)]() mutable {
+            runBatch(owner, from, std::move(batch));
+        });
+    }
+}
+
+void KvServer::runBatch(const std::shared_ptr<Shard>& owner, const std::shared_ptr<Shard>& origin,
+                        std::vector<Request> batch) {
+    std::vector<Reply> replies;
+    replies.reserve(batch.size());
+    std::vector<std::string_view> args;
+    for (Request& request : batch) {
+        args.assign(request.args.begin(), request.args.end());
+        std::string data;
+        RespWriter writer(data, request.protocol);
+        execute(request.command, args, &owner->store, nullptr, writer);
+        replies.push_back(Reply{std::move(request.session), request.seq, std::move(data)});
+    }
+
+    origin->loop->runInLoop([replies = std::move(replies)]() mutable {
+        for (Reply& reply : replies) {
+            reply.session->deliver(reply.seq, std::move(reply.data));
+        }
+        // One send per session; flush() is a no-op once the output is drained
+        for (Reply& reply : replies) {
+            reply.session->flush();
+        }
+    });
+}
+
+void KvServer::Session::deliver(uint64_t seq, std::string reply) {
+    if (seq != nextToSend) {
+        ready.emplace(seq, std::move(reply));
+        return;
+    }
+    output += reply;
+    ++nextToSend;
+    for (auto it = ready.begin(); it != ready.end() && it->first == nextToSend; it = ready.erase(it)) {
+        output += it->second;
+        ++nextToSend;
+    }
+}
+
+void KvServer::Session::flush() {
+    const TcpConnectionPtr connection = conn.lock();
+    if (!connection) {
+        output.clear();
+        return;
+    }
+    if (!output.empty()) {
+        connection->send(output);
+        output.clear();
+    }
+    if (quit && !shutdownSent && nextToSend == nextSeq) {
+        shutdownSent = true;
+        connection->shutdown();
+    }
+}
+
+KvServer::Command KvServer::lookupCommand(std::string_view name) noexcept {
+    static constexpr std::array<std::pair<std::string_view, Command>, 12> kCommands{{
+        {"GET", Command::kGet},     {"SET", Command::kSet},       {"PING", Command::kPing},
+        {"INCR", Command::kIncr},   {"DECR", Command::kDecr},     {"DEL", Command::kDel},
+        {"EXISTS", Command::kExists}, {"ECHO", Command::kEcho},   {"HELLO", Command::kHello},
+        {"SELECT", Command::kSelect}, {"CONFIG", Command::kConfig}, {"QUIT", Command::kQuit},
+    }};
+    for (const auto& [commandName, command] : kCommands) {
+        if (equalsIgnoreCase(name, commandName)) {
+            return command;
+        }
+    }
+    return Command::kUnknown;
+}
+
+void KvServer::execute(Command command, const std::vector<std::string_view>& args,
+                       Store* store, Session* session, RespWriter& writer) {
+    const size_t argc = args.size();
+    switch (command) {
+    case Command::kPing:
+        if (argc > 2) {
+            wrongArity(writer, args[0]);
+        } else if (argc == 2) {
+            writer.bulk(args[1]);
+        } else {
+            writer.simple("PONG");
+        }
+        break;
+
+    case Command::kEcho:
+        argc == 2 ? writer.bulk(args[1]) : wrongArity(writer, args[0]);
+        break;
+
+    case Command::kHello: {
+        int64_t version = session->protocol;
+        if (argc >= 2 && (!parseInt64(args[1], &version) || version < 2 || version > 3)) {
+            writer.error("NOPROTO unsupported protocol version");
+            break;
+        }
+        // The reply already uses the protocol just chosen
+        session->protocol = static_cast<int>(version);
+        writer.setProtocol(session->protocol);
+        writer.mapHeader(5);
+        writer.bulk("server");
+        writer.bulk("muduo");
+        writer.bulk("version");
+        writer.bulk("7.0.0");
+        writer.bulk("proto");
+        writer.integer(version);
+        writer.bulk("mode");
+        writer.bulk("standalone");
+        writer.bulk("role");
+        writer.bulk("master");
+        break;
+    }
+
+    case Command::kSelect:
+        if (argc != 2) {
+            wrongArity(writer, args[0]);
+        } else if (args[1] == "0") {
+            writer.simple("OK");
+        } else {
+            writer.error("ERR DB index is out of range");
+        }
+        break;
+
+    case Command::kConfig:
+        writer.arrayHeader(0);
+        break;
+
+    case Command::kQuit:
+        writer.simple("OK");
+        session->quit = true;
+        break;
+
+    case Command::kGet:
+        if (argc != 2) {
+            wrongArity(writer, args[0]);
+        } else if (auto it = store->find(args[1]); it != store->end()) {
+            writer.bulk(it->second);
+        } else {
+            writer.null();
+        }
+        break;
+
+    case Command::kSet: {
+        if (argc < 3 || argc > 4) {
+            wrongArity(writer, args[0]);
+            break;
+        }
+        const bool nx = argc == 4 && equalsIgnoreCase(args[3], "NX");
+        const bool xx = argc == 4 && equalsIgnoreCase(args[3], "XX");
+        if (argc == 4 && !nx && !xx) {
+            writer.error("ERR syntax error");
+            break;
+        }
+        auto it = store->find(args[1]);
+        if ((nx && it != store->end()) || (xx && it == store->end())) {
+            writer.null();
+        } else {
+            if (it != store->end()) {
+                it->second.assign(args[2]);
+            } else {
+                store->emplace(std::string(args[1]), std::string(args[2]));
+            }
+            writer.simple("OK");
+        }
+        break;
+    }
+
+    case Command::kDel:
+    case Command::kExists: {
+        if (argc < 2) {
+            wrongArity(writer, args[0]);
+            break;
+        }
+        int64_t count = 0;
+        for (size_t i = 1; i < argc; ++i) {
+            auto it = store->find(args[i]);
+            if (it != store->end()) {
+                ++count;
+                if (command == Command::kDel) {
+                    store->erase(it);
+                }
+            }
+        }
+        writer.integer(count);
+        break;
+    }
+
+    case Command::kIncr:
+    case Command::kDecr: {
+        if (argc != 2) {
+            wrongArity(writer, args[0]);
+            break;
+        }
+        auto it = store->find(args[1]);
+        int64_t value = 0;
+        if (it != store->end() && !parseInt64(it->second, &value)) {
+            writer.error("ERR value is not an integer or out of range");
+            break;
+        }
+        const int64_t delta = command == Command::kIncr ? 1 : -1;
+        if ((delta > 0 && value == std::numeric_limits<int64_t>::max()) ||
+            (delta < 0 && value == std::numeric_limits<int64_t>::min())) {
+            writer.error("ERR increment or decrement would overflow");
+            break;
+        }
+        value += delta;
+        if (it != store->end()) {
+            it->second = std::to_string(value);
+        } else {
+            store->emplace(std::string(args[1]), std::to_string(value));
+        }
+        writer.integer(value);
+        break;
+    }
+
+    case Command::kUnknown: {
+        std::string message = "ERR unknown command '";
+        message.append(args[0].substr(0, 128));
+        message += "'";
+        writer.error(message);
+        break;
+    }
+    }
+}
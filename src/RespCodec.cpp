@@ -0,0 +1,283 @@
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <iterator>
+
+#include <fmt/format.h>
+
+#include <muduo/RespCodec.hpp>
+
+namespace {
+
+constexpr size_t npos = static_cast<size_t>(-1);
+
+bool parseInteger(const char* begin, const char* end, int64_t* value) noexcept {
+    const auto [ptr, ec] = std::from_chars(begin, end, *value);
+    return ec == std::errc() && ptr == end && begin != end;
+}
+
+} // namespace
+
+void RespParser::reset() noexcept {
+    stage_ = Stage::kStart;
+    pos_ = 0;
+    argsExpected_ = 0;
+    bulkLength_ = 0;
+    spans_.clear();
+    error_ = nullptr;
+}
+
+RespParser::Result RespParser::fail(const char* message) noexcept {
+    error_ = message;
+    return Result::kError;
+}
+
+size_t RespParser::findLineEnd(const char* base, size_t readable) const noexcept {
+    const void* found = std::memchr(base + pos_, '\r', readable - pos_);
+    if (!found) {
+        return npos;
+    }
+    const size_t cr = static_cast<const char*>(found) - base;
+    return cr + 1 < readable ? cr : npos;
+}
+
+RespParser::Result RespParser::parse(const Buffer& buf) {
+    const char* base = buf.peek();
+    const size_t readable = buf.readableBytes();
+
+    while (stage_ != Stage::kDone) {
+        switch (stage_) {
+        case Stage::kStart: {
+            if (pos_ == readable) {
+                return Result::kNeedMore;
+            }
+            if (base[pos_] != '*') {
+                const size_t lineStart = pos_;
+                const Result result = parseInline(base, readable);
+                if (result == Result::kNeedMore && pos_ != lineStart) {
+                    continue; // blank line skipped, look at what follows
+                }
+                return result;
+            }
+            const size_t cr = findLineEnd(base, readable);
+            if (cr == npos) {
+                return readable - pos_ > kMaxInlineLength ? fail("ERR Protocol error: too big mbulk count string")
+                                                          : Result::kNeedMore;
+            }
+            int64_t count = 0;
+            if (!parseInteger(base + pos_ + 1, base + cr, &count) || base[cr + 1] != '\n' ||
+                count > static_cast<int64_t>(kMaxArgs)) {
+                return fail("ERR Protocol error: invalid multibulk length");
+            }
+            pos_ = cr + 2;
+            argsExpected_ = count > 0 ? static_cast<size_t>(count) : 0;
+            spans_.clear();
+            spans_.reserve(argsExpected_);
+            if (argsExpected_ == 0) {
+                // Empty command (*0 or *-1): nothing to run, swallow it
+                stage_ = Stage::kStart;
+                if (pos_ == readable) {
+                    return Result::kNeedMore;
+                }
+                continue;
+            }
+            stage_ = Stage::kBulkHeader;
+            break;
+        }
+
+        case Stage::kBulkHeader: {
+            const size_t cr = findLineEnd(base, readable);
+            if (cr == npos) {
+                return Result::kNeedMore;
+            }
+            int64_t length = 0;
+            if (base[pos_] != '$' || !parseInteger(base + pos_ + 1, base + cr, &length) ||
+                base[cr + 1] != '\n' || length < 0 || length > static_cast<int64_t>(kMaxBulkLength)) {
+                return fail("ERR Protocol error: invalid bulk length");
+            }
+            pos_ = cr + 2;
+            bulkLength_ = static_cast<size_t>(length);
+            stage_ = Stage::kBulkData;
+            break;
+        }
+
+        case Stage::kBulkData:
+            if (readable - pos_ < bulkLength_ + 2) {
+                return Result::kNeedMore;
+            }
+            if (base[pos_ + bulkLength_] != '\r' || base[pos_ + bulkLength_ + 1] != '\n') {
+                return fail("ERR Protocol error: bulk string not terminated");
+            }
+            spans_.push_back(Span{pos_, bulkLength_});
+            pos_ += bulkLength_ + 2;
+            stage_ = spans_.size() == argsExpected_ ? Stage::kDone : Stage::kBulkHeader;
+            break;
+
+        case Stage::kDone:
+            break;
+        }
+    }
+
+    args_.clear();
+    for (const Span& span : spans_) {
+        args_.emplace_back(base + span.offset, span.length);
+    }
+    return Result::kComplete;
+}
+
+RespParser::Result RespParser::parseInline(const char* base, size_t readable) {
+    const void* found = std::memchr(base + pos_, '\n', readable - pos_);
+    if (!found) {
+        return readable - pos_ > kMaxInlineLength ? fail("ERR Protocol error: too big inline request")
+                                                  : Result::kNeedMore;
+    }
+    const size_t lf = static_cast<const char*>(found) - base;
+    const size_t end = (lf > pos_ && base[lf - 1] == '\r') ? lf - 1 : lf;
+
+    spans_.clear();
+    size_t i = pos_;
+    while (i < end) {
+        while (i < end && (base[i] == ' ' || base[i] == '\t')) ++i;
+        const size_t start = i;
+        while (i < end && base[i] != ' ' && base[i] != '\t') ++i;
+        if (i > start) {
+            spans_.push_back(Span{start, i - start});
+        }
+    }
+    pos_ = lf + 1;
+
+    if (spans_.empty()) {
+        return Result::kNeedMore;
+    }
+    stage_ = Stage::kDone;
+    args_.clear();
+    for (const Span& span : spans_) {
+        args_.emplace_back(base + span.offset, span.length);
+    }
+    return Result::kComplete;
+}
+
+void RespWriter::simple(std::string_view s) {
+    out_ += '+';
+    out_ += s;
+    out_ += "\r\n";
+}
+
+void RespWriter::error(std::string_view message) {
+    out_ += '-';
+    out_ += message;
+    out_ += "\r\n";
+}
+
+void RespWriter::integer(int64_t value) {
+    fmt::format_to(std::back_inserter(out_), ":{}\r\n", value);
+}
+
+void RespWriter::bulk(std::string_view s) {
+    fmt::format_to(std::back_inserter(out_), "${}\r\n", s.size());
+    out_ += s;
+    out_ += "\r\n";
+}
+
+void RespWriter::null() {
+    out_ += protocol_ >= 3 ? "_\r\n" : "$-1\r\n";
+}
+
+void RespWriter::boolean(bool value) {
+    if (protocol_ >= 3) {
+        out_ += value ? "#t\r\n" : "#f\r\n";
+    } else {
+        integer(value ? 1 : 0);
+    }
+}
+
+void RespWriter::number(double value) {
+    if (protocol_ >= 3) {
+        fmt::format_to(std::back_inserter(out_), ",{}\r\n", value);
+    } else {
+        bulk(fmt::format("{}", value));
+    }
+}
+
+void RespWriter::arrayHeader(size_t count) {
+    fmt::format_to(std::back_inserter(out_), "*{}\r\n", count);
+}
+
+void RespWriter::mapHeader(size_t pairs) {
+    if (protocol_ >= 3) {
+        fmt::format_to(std::back_inserter(out_), "%{}\r\n", pairs);
+    } else {
+        arrayHeader(pairs * 2);
+    }
+}
+
+// Iterative, so nesting depth costs neither stack nor memory: an aggregate
+// header just adds its elements to the values still to be measured
+ptrdiff_t RespCodec::valueLength(const char* data, size_t len) noexcept {
+    size_t total = 0;
+    size_t pending = 1;
+    while (pending > 0) {
+        const char* value = data + total;
+        const size_t left = len - total;
+        if (left == 0) {
+            return 0;
+        }
+        const void* found = std::memchr(value, '\r', left);
+        if (!found) {
+            return 0;
+        }
+        const size_t cr = static_cast<const char*>(found) - value;
+        if (cr + 1 >= left) {
+            return 0;
+        }
+        if (value[cr + 1] != '\n') {
+            return -1;
+        }
+        const size_t headerLength = cr + 2;
+        --pending;
+
+        switch (value[0]) {
+        case '+': case '-': case ':': case '_': case '#': case ',': case '(':
+            total += headerLength;
+            break;
+
+        case '$': case '!': case '=': {
+            int64_t length = 0;
+            if (!parseInteger(value + 1, value + cr, &length)) {
+                return -1;
+            }
+            if (length < 0) {
+                total += headerLength; // RESP2 null bulk
+                break;
+            }
+            if (static_cast<uint64_t>(length) + 2 > left - headerLength) {
+                return 0;
+            }
+            total += headerLength + static_cast<size_t>(length) + 2;
+            break;
+        }
+
+        case '*': case '%': case '~': case '>': case '|': {
+            int64_t count = 0;
+            if (!parseInteger(value + 1, value + cr, &count)) {
+                return -1;
+            }
+            total += headerLength;
+            if (count <= 0) {
+                break; // empty, or a RESP2 null array
+            }
+            // Every element takes at least one byte, so more than are left cannot be complete yet
+            const uint64_t elements = static_cast<uint64_t>(count) * (value[0] == '%' || value[0] == '|' ? 2 : 1);
+            if (static_cast<uint64_t>(count) > len || pending + elements > len - total) {
+                return 0;
+            }
+            pending += static_cast<size_t>(elements);
+            break;
+        }
+
+        default:
+            return -1;
+        }
+    }
+    return static_cast<ptrdiff_t>(total);
+}
@@ -0,0 +1,142 @@
+#include <future>
+
+#include <muduo/RpcClient.hpp>
+#include <muduo/Logger.hpp>
+
+RpcClient::RpcClient(EventLoop* loop, const InetAddress& serverAddr, std::string name)
+    : loop_(loop),
+      client_(loop, serverAddr, std::move(name)),
+      nextCallId_(1),
+      flushQueued_(false) {
+    client_.setConnectionCallback([this](const TcpConnectionPtr& conn) { onConnection(conn); });
+    client_.setMessageCallback([this](const TcpConnectionPtr& conn, Buffer* buf, Timestamp t) {
+        onMessage(conn, buf, t);
+    });
+}
+
+// Same contract as TcpClient: any thread, as long as the loop still runs
+RpcClient::~RpcClient() {
+    if (loop_->isInLoopThread()) {
+        teardownInLoop();
+    } else {
+        std::promise<void> done;
+        loop_->queueInLoop([this, &done] {
+            teardownInLoop();
+            done.set_value();
+        });
+        done.get_future().wait();
+    }
+}
+
+void RpcClient::teardownInLoop() {
+    if (conn_) {
+        // The connection may outlive us inside TcpClient's teardown; detach it
+        conn_->setMessageCallback([](const TcpConnectionPtr&, Buffer* buf, Timestamp) { buf->retrieveAll(); });
+        conn_->setConnectionCallback([](const TcpConnectionPtr&) {});
+        conn_.reset();
+    }
+    failAll(RpcStatus::kDisconnected);
+}
+
+void RpcClient::call(std::string_view method, std::string_view payload, ResponseCallback cb, double timeoutSeconds) {
+    if (loop_->isInLoopThread()) {
+        callInLoop(method, payload, std::move(cb), timeoutSeconds);
+    } else {
+        // The client may be destroyed on its loop before this runs
+        loop_->queueInLoop([this, alive = std::weak_ptr<void>(lifeline_), method = std::string(method),
+                            payload = std::string(payload), cb = std::move(cb), timeoutSeconds]() mutable {
+            if (alive.expired()) {
+                cb(RpcStatus::kDisconnected, {});
+                return;
+            }
+            callInLoop(method, payload, std::move(cb), timeoutSeconds);
+        });
+    }
+}
+
+void RpcClient::callInLoop(std::string_view method, std::string_view payload, ResponseCallback cb, double timeoutSeconds) {
+    if (!RpcCodec::fits(method, payload)) {
+        LOG_ERROR("RpcClient::call - {} byte method / {} byte payload exceeds the frame limit",
+                  method.size(), payload.size());
+        cb(RpcStatus::kTooLarge, {});
+        return;
+    }
+    if (!conn_) {
+        cb(RpcStatus::kDisconnected, {});
+        return;
+    }
+
+    const uint64_t callId = nextCallId_++;
+    const TimerId deadline = loop_->runAfter(timeoutSeconds, [this, callId] { expire(callId); });
+    pending_.emplace(callId, PendingCall{std::move(cb), deadline});
+
+    RpcCodec::appendRequest(pendingOutput_, callId, method, payload);
+    if (!flushQueued_) {
+        flushQueued_ = true;
+        // The client may be destroyed on this thread before the flush runs
+        loop_->queueInLoop([this, alive = std::weak_ptr<void>(lifeline_)] {
+            if (!alive.expired()) flush();
+        });
+    }
+}
+
+void RpcClient::flush() {
+    flushQueued_ = false;
+    if (conn_ && !pendingOutput_.empty()) {
+        conn_->send(pendingOutput_);
+    }
+    pendingOutput_.clear();
+}
+
+void RpcClient::onConnection(const TcpConnectionPtr& conn) {
+    if (conn->connected()) {
+        conn_ = conn;
+    } else {
+        conn_.reset();
+        pendingOutput_.clear();
+        failAll(RpcStatus::kDisconnected);
+    }
+    if (connectionCallback_) connectionCallback_(conn);
+}
+
+void RpcClient::onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp) {
+    RpcFrame frame;
+    for (;;) {
+        const RpcCodec::DecodeResult result = RpcCodec::decode(*buf, &frame);
+        if (result == RpcCodec::DecodeResult::kNeedMore) {
+            break;
+        }
+        if (result == RpcCodec::DecodeResult::kError || frame.kind != RpcFrameKind::kResponse) {
+            LOG_ERROR("RpcClient bad frame on {}, closing", conn->name());
+            buf->retrieveAll();
+            conn->shutdown();
+            return;
+        }
+
+        // A reply after the deadline finds nothing to complete
+        if (auto it = pending_.find(frame.callId); it != pending_.end()) {
+            PendingCall call = std::move(it->second);
+            pending_.erase(it);
+            loop_->cancel(call.deadline);
+            call.callback(frame.status, frame.payload);
+        }
+        buf->retrieve(frame.size);
+    }
+}
+
+void RpcClient::expire(uint64_t callId) {
+    if (auto it = pending_.find(callId); it != pending_.end()) {
+        PendingCall call = std::move(it->second);
+        pending_.erase(it);
+        call.callback(RpcStatus::kTimeout, {});
+    }
+}
+
+void RpcClient::failAll(RpcStatus status) {
+    std::unordered_map<uint64_t, PendingCall> calls;
+    calls.swap(pending_);
+    for (auto& [callId, call] : calls) {
+        loop_->cancel(call.deadline);
+        call.callback(status, {});
+    }
+}
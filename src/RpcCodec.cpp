@@ -0,0 +1,71 @@
+#include <endian.h>
+#include <cstring>
+
+#include <muduo/RpcCodec.hpp>
+
+namespace {
+
+void appendFrame(std::string& out, RpcFrameKind kind, RpcStatus status, uint64_t callId,
+                 std::string_view method, std::string_view payload) {
+    char header[RpcCodec::kHeaderSize];
+    const uint32_t length = htobe32(static_cast<uint32_t>(RpcCodec::kHeaderSize - 4 + method.size() + payload.size()));
+    const uint16_t methodLength = htobe16(static_cast<uint16_t>(method.size()));
+    const uint64_t id = htobe64(callId);
+    std::memcpy(header, &length, 4);
+    header[4] = static_cast<char>(kind);
+    header[5] = static_cast<char>(status);
+    std::memcpy(header + 6, &methodLength, 2);
+    std::memcpy(header + 8, &id, 8);
+
+    out.reserve(out.size() + sizeof(header) + method.size() + payload.size());
+    out.append(header, sizeof(header));
+    out.append(method);
+    out.append(payload);
+}
+
+} // namespace
+
+RpcCodec::DecodeResult RpcCodec::decode(const Buffer& buf, RpcFrame* frame) noexcept {
+    const size_t readable = buf.readableBytes();
+    if (readable < 4) {
+        return DecodeResult::kNeedMore;
+    }
+
+    const char* data = buf.peek();
+    uint32_t length = 0;
+    std::memcpy(&length, data, 4);
+    length = be32toh(length);
+    if (length < kHeaderSize - 4 || length > kMaxFrameSize) {
+        return DecodeResult::kError;
+    }
+    if (readable < 4 + static_cast<size_t>(length)) {
+        return DecodeResult::kNeedMore;
+    }
+
+    uint16_t methodLength = 0;
+    uint64_t callId = 0;
+    std::memcpy(&methodLength, data + 6, 2);
+    std::memcpy(&callId, data + 8, 8);
+    methodLength = be16toh(methodLength);
+
+    const size_t bodyLength = length - (kHeaderSize - 4);
+    if (methodLength > bodyLength || static_cast<uint8_t>(data[4]) > static_cast<uint8_t>(RpcFrameKind::kResponse)) {
+        return DecodeResult::kError;
+    }
+
+    frame->kind = static_cast<RpcFrameKind>(data[4]);
+    frame->status = static_cast<RpcStatus>(data[5]);
+    frame->callId = be64toh(callId);
+    frame->method = std::string_view(data + kHeaderSize, methodLength);
+    frame->payload = std::string_view(data + kHeaderSize + methodLength, bodyLength - methodLength);
+    frame->size = 4 + static_cast<size_t>(length);
+    return DecodeResult::kFrame;
+}
+
+void RpcCodec::appendRequest(std::string& out, uint64_t callId, std::string_view method, std::string_view payload) {
+    appendFrame(out, RpcFrameKind::kRequest, RpcStatus::kOk, callId, method, payload);
+}
+
+void RpcCodec::appendResponse(std::string& out, uint64_t callId, RpcStatus status, std::string_view payload) {
+    appendFrame(out, RpcFrameKind::kResponse, status, callId, {}, payload);
+}
@@ -0,0 +1,270 @@
+#include <endian.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <future>
+
+#include <fmt/format.h>
+
+#include <muduo/Logger.hpp>
+#include <muduo/RpcProxy.hpp>
+
+namespace {
+
+constexpr size_t npos = static_cast<size_t>(-1);
+// Offset of the call id in a frame, see RpcCodec
+constexpr size_t kCallIdOffset = 8;
+
+uint64_t mix64(uint64_t x) noexcept {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+// Appends a frame as it arrived, with its call id replaced
+void appendWithCallId(std::string& out, const char* frame, size_t size, uint64_t callId) {
+    const size_t start = out.size();
+    out.append(frame, size);
+    const uint64_t id = htobe64(callId);
+    std::memcpy(out.data() + start + kCallIdOffset, &id, sizeof(id));
+}
+
+} // namespace
+
+std::string& RpcProxy::OutputBatch::to(const TcpConnectionPtr& conn) {
+    auto [it, inserted] = index_.try_emplace(conn.get(), entries_.size());
+    if (inserted) {
+        entries_.emplace_back(conn, std::string());
+    }
+    return entries_[it->second].second;
+}
+
+void RpcProxy::OutputBatch::flush() {
+    for (auto& [conn, bytes] : entries_) {
+        conn->send(bytes);
+    }
+    entries_.clear();
+    index_.clear();
+}
+
+RpcProxy::RpcProxy(EventLoop* loop,
+                   const InetAddress& listenAddr,
+                   std::vector<InetAddress> backends,
+                   std::string name,
+                   TcpServer::Option option)
+    : server_(loop, listenAddr, name, option),
+      name_(std::move(name)),
+      backends_(std::move(backends)) {
+    server_.setMessageCallback([this](const TcpConnectionPtr& conn, Buffer* buf, Timestamp t) {
+        onClientMessage(conn, buf, t);
+    });
+    server_.setThreadInitCallback([this](EventLoop* ioLoop) { initLoop(ioLoop); });
+    buildRing();
+}
+
+RpcProxy::~RpcProxy() {
+    // A TcpClient must be torn down on its own loop while that loop still runs,
+    // and server_ stops the IO loops when it goes; so empty every state first
+    std::vector<std::future<void>> pending;
+    for (auto& [ioLoop, state] : loopStates_) {
+        auto done = std::make_shared<std::promise<void>>();
+        pending.push_back(done->get_future());
+        ioLoop->runInLoop([ioLoop, raw = state.get(), done] {
+            ioLoop->cancel(raw->sweepTimer);
+            // Moved out first: their disconnect callbacks still update the state
+            auto clients = std::move(raw->clients);
+            clients.clear();
+            for (auto& upstreams : raw->upstreams) {
+                upstreams.clear();   // client messages keep arriving until server_ is gone
+            }
+            done->set_value();
+        });
+    }
+    for (auto& f : pending) {
+        f.wait();
+    }
+}
+
+void RpcProxy::buildRing() {
+    ring_.clear();
+    ring_.reserve(backends_.size() * kVirtualNodesPerBackend);
+    for (size_t i = 0; i < backends_.size(); ++i) {
+        const uint64_t base = std::hash<std::string>{}(backends_[i].toIpPort());
+        for (int v = 0; v < kVirtualNodesPerBackend; ++v) {
+            ring_.emplace_back(mix64(base + static_cast<uint64_t>(v)), i);
+        }
+    }
+    std::sort(ring_.begin(), ring_.end(),
+        [](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; });
+}
+
+void RpcProxy::start() {
+    server_.start();
+}
+
+void RpcProxy::initLoop(EventLoop* ioLoop) {
+    auto state = std::make_unique<LoopState>();
+    LoopState* raw = state.get();
+    state->clients.resize(backends_.size());
+    state->upstreams.resize(backends_.size());
+    state->nextUpstream.assign(backends_.size(), 0);
+    state->inFlight.assign(backends_.size(), 0);
+    for (size_t b = 0; b < backends_.size(); ++b) {
+        for (size_t i = 0; i < connectionsPerBackend_; ++i) {
+            auto client = std::make_unique<TcpClient>(
+                ioLoop, backends_[b], fmt::format("{}-upstream{}", name_, b));
+            client->enableRetry();
+            client->setConnectionCallback([this, raw, b](const TcpConnectionPtr& conn) {
+                onUpstreamConnection(raw, b, conn);
+            });
+            client->setMessageCallback([this, raw](const TcpConnectionPtr& conn, Buffer* buf, Timestamp) {
+                onUpstreamMessage(raw, conn, buf);
+            });
+            client->connect();
+            state->clients[b].push_back(std::move(client));
+        }
+    }
+    state->sweepTimer = ioLoop->runEvery(callTimeout_ / 4, [this, raw] { expireCalls(raw); });
+    loopStates_.emplace(ioLoop, std::move(state));
+
+    if (threadInitCallback_) {
+        threadInitCallback_(ioLoop);
+    }
+}
+
+void RpcProxy::expireCalls(LoopState* state) {
+    const int64_t now = Timestamp::now().microSecondsSinceEpoch();
+    while (!state->deadlines.empty()) {
+        const auto [deadline, id] = state->deadlines.front();
+        auto it = state->pending.find(id);
+        if (it != state->pending.end()) {
+            if (now < deadline.microSecondsSinceEpoch()) {
+                break;
+            }
+            --state->inFlight[it->second.backend];
+            --state->totalInFlight;
+            RpcCodec::appendResponse(state->output.to(it->second.client), it->second.callId,
+                                     RpcStatus::kTimeout, "backend timed out");
+            state->pending.erase(it);
+        }
+        state->deadlines.pop_front();
+    }
+    state->output.flush();
+}
+
+size_t RpcProxy::pickBackend(const LoopState& state, std::string_view key) const noexcept {
+    if (ring_.empty()) {
+        return npos;
+    }
+    const uint64_t hash = mix64(std::hash<std::string_view>{}(key));
+    const size_t start = std::lower_bound(ring_.begin(), ring_.end(), hash,
+        [](const auto& node, uint64_t value) { return node.first < value; }) - ring_.begin();
+
+    // Bounded load: at most ceil(c * (calls in flight + this one) / backends)
+    const auto bound = static_cast<size_t>(
+        std::ceil(loadFactor_ * static_cast<double>(state.totalInFlight + 1) / static_cast<double>(backends_.size())));
+
+    size_t firstUp = npos;
+    for (size_t i = 0; i < ring_.size(); ++i) {
+        const size_t backend = ring_[(start + i) % ring_.size()].second;
+        if (state.upstreams[backend].empty()) {
+            continue;
+        }
+        if (state.inFlight[backend] < bound) {
+            return backend;
+        }
+        if (firstUp == npos) {
+            firstUp = backend;
+        }
+    }
+    return firstUp;
+}
+
+void RpcProxy::onClientMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp receiveTime) {
+    auto found = loopStates_.find(conn->getLoop());
+    if (found == loopStates_.end()) {
+        buf->retrieveAll();
+        return;
+    }
+    LoopState& state = *found->second;
+
+    RpcFrame frame;
+    for (;;) {
+        const RpcCodec::DecodeResult result = RpcCodec::decode(*buf, &frame);
+        if (result == RpcCodec::DecodeResult::kNeedMore) {
+            break;
+        }
+        if (result == RpcCodec::DecodeResult::kError || frame.kind != RpcFrameKind::kRequest) {
+            LOG_ERROR("RpcProxy bad frame on {}, closing", conn->name());
+            buf->retrieveAll();
+            conn->shutdown();
+            break;
+        }
+
+        const std::string_view key = keyExtractor_ ? keyExtractor_(frame) : frame.method;
+        const size_t backend = pickBackend(state, key);
+        if (backend == npos) {
+            RpcCodec::appendResponse(state.output.to(conn), frame.callId, RpcStatus::kDisconnected,
+                                     "no backend available");
+        } else {
+            std::vector<TcpConnectionPtr>& upstreams = state.upstreams[backend];
+            const TcpConnectionPtr& upstream = upstreams[state.nextUpstream[backend]++ % upstreams.size()];
+            const uint64_t id = state.nextCallId++;
+            state.pending.emplace(id, PendingCall{conn, frame.callId, backend, upstream.get()});
+            state.deadlines.emplace_back(addTime(receiveTime, callTimeout_), id);
+            ++state.inFlight[backend];
+            ++state.totalInFlight;
+            appendWithCallId(state.output.to(upstream), buf->peek(), frame.size, id);
+        }
+        buf->retrieve(frame.size);
+    }
+    state.output.flush();
+}
+
+void RpcProxy::onUpstreamMessage(LoopState* state, const TcpConnectionPtr& conn, Buffer* buf) {
+    RpcFrame frame;
+    for (;;) {
+        const RpcCodec::DecodeResult result = RpcCodec::decode(*buf, &frame);
+        if (result == RpcCodec::DecodeResult::kNeedMore) {
+            break;
+        }
+        if (result == RpcCodec::DecodeResult::kError || frame.kind != RpcFrameKind::kResponse) {
+            LOG_ERROR("RpcProxy bad frame from backend {}, closing", conn->name());
+            buf->retrieveAll();
+            conn->forceClose();
+            break;
+        }
+
+        if (auto node = state->pending.extract(frame.callId)) {
+            PendingCall& call = node.mapped();
+            --state->inFlight[call.backend];
+            --state->totalInFlight;
+            appendWithCallId(state->output.to(call.client), buf->peek(), frame.size, call.callId);
+        }
+        buf->retrieve(frame.size);
+    }
+    state->output.flush();
+}
+
+void RpcProxy::onUpstreamConnection(LoopState* state, size_t backend, const TcpConnectionPtr& conn) {
+    std::vector<TcpConnectionPtr>& upstreams = state->upstreams[backend];
+    if (conn->connected()) {
+        upstreams.push_back(conn);
+        return;
+    }
+
+    upstreams.erase(std::remove(upstreams.begin(), upstreams.end(), conn), upstreams.end());
+    for (auto it = state->pending.begin(); it != state->pending.end();) {
+        if (it->second.upstream != conn.get()) {
+            ++it;
+            continue;
+        }
+        --state->inFlight[it->second.backend];
+        --state->totalInFlight;
+        RpcCodec::appendResponse(state->output.to(it->second.client), it->second.callId,
+                                 RpcStatus::kDisconnected, "backend connection lost");
+        it = state->pending.erase(it);
+    }
+    state->output.flush();
+}
@@ -0,0 +1,99 @@
+#include <muduo/RpcServer.hpp>
+#include <muduo/Logger.hpp>
+
+RpcServer::RpcServer(EventLoop* loop,
+                     const InetAddress& listenAddr,
+                     std::string name,
+                     TcpServer::Option option)
+    : server_(loop, listenAddr, std::move(name), option) {
+    server_.setConnectionCallback([this](const TcpConnectionPtr& conn) { onConnection(conn); });
+    server_.setMessageCallback([this](const TcpConnectionPtr& conn, Buffer* buf, Timestamp t) {
+        onMessage(conn, buf, t);
+    });
+}
+
+void RpcServer::registerMethod(std::string name, MethodHandler handler) {
+    methods_.insert_or_assign(std::move(name), std::move(handler));
+}
+
+void RpcServer::onConnection(const TcpConnectionPtr& conn) {
+    if (conn->connected()) {
+        auto& session = conn->setContext<std::shared_ptr<Session>>(std::make_shared<Session>());
+        session->conn = conn;
+    }
+}
+
+void RpcServer::onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp) {
+    const auto* context = conn->getContext<std::shared_ptr<Session>>();
+    if (!context) {
+        buf->retrieveAll();
+        return;
+    }
+    const std::shared_ptr<Session>& session = *context;
+
+    RpcFrame frame;
+    for (;;) {
+        const RpcCodec::DecodeResult result = RpcCodec::decode(*buf, &frame);
+        if (result == RpcCodec::DecodeResult::kNeedMore) {
+            break;
+        }
+        if (result == RpcCodec::DecodeResult::kError || frame.kind != RpcFrameKind::kRequest) {
+            LOG_ERROR("RpcServer bad frame on {}, closing", conn->name());
+            buf->retrieveAll();
+            conn->shutdown();
+            return;
+        }
+
+        if (auto it = methods_.find(frame.method); it != methods_.end()) {
+            it->second(frame.payload, Responder(session, frame.callId));
+        } else {
+            session->queueReply(frame.callId, RpcStatus::kNoSuchMethod, frame.method);
+        }
+        buf->retrieve(frame.size);
+    }
+}
+
+void RpcServer::Responder::reply(std::string_view payload) const {
+    send(RpcStatus::kOk, payload);
+}
+
+void RpcServer::Responder::send(RpcStatus status, std::string_view payload) const {
+    const TcpConnectionPtr conn = session_->conn.lock();
+    if (!conn) {
+        return;   // the caller is gone
+    }
+    if (!RpcCodec::fits({}, payload)) {
+        // Tell the caller instead of sending a frame its decoder would reject
+        LOG_ERROR("RpcServer::Responder::send - {} byte reply exceeds the frame limit", payload.size());
+        status = RpcStatus::kTooLarge;
+        payload = {};
+    }
+    EventLoop* loop = conn->getLoop();
+    if (loop->isInLoopThread()) {
+        session_->queueReply(callId_, status, payload);
+    } else {
+        loop->queueInLoop([session = session_, callId = callId_, status, payload = std::string(payload)] {
+            session->queueReply(callId, status, payload);
+        });
+    }
+}
+
+void RpcServer::Session::queueReply(uint64_t callId, RpcStatus status, std::string_view payload) {
+    const TcpConnectionPtr c = conn.lock();
+    if (!c) {
+        return;
+    }
+    RpcCodec::appendResponse(pendingOutput, callId, status, payload);
+    if (!flushQueued) {
+        flushQueued = true;
+        c->getLoop()->queueInLoop([self = shared_from_this()] { self->flush(); });
+    }
+}
+
+void RpcServer::Session::flush() {
+    flushQueued = false;
+    if (const TcpConnectionPtr c = conn.lock(); c && !pendingOutput.empty()) {
+        c->send(pendingOutput);
+    }
+    pendingOutput.clear();
+}
@@ -0,0 +1,336 @@
+#include <sys/eventfd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+
+#include <muduo/ShmConnection.hpp>
+#include <muduo/Logger.hpp>
+
+namespace {
+
+[[noreturn]] void throwSystemError(const char* what) {
+    const int err = errno;
+    LOG_ERROR("{} failed: {}", what, strerror(err));
+    throw std::system_error(err, std::generic_category(), what);
+}
+
+int createDoorbell() {
+    const int fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (fd < 0) {
+        throwSystemError("eventfd");
+    }
+    return fd;
+}
+
+int duplicate(int fd) {
+    const int copy = ::fcntl(fd, F_DUPFD_CLOEXEC, 0);
+    if (copy < 0) {
+        throwSystemError("dup");
+    }
+    return copy;
+}
+
+void ringDoorbell(int fd, const std::string& name) noexcept {
+    const uint64_t one = 1;
+    if (::write(fd, &one, sizeof(one)) != sizeof(one) && errno != EAGAIN) {
+        LOG_ERROR("ShmConnection[{}] doorbell write error: {}", name, strerror(errno));
+    }
+}
+
+} // namespace
+
+ShmEndpoint::~ShmEndpoint() noexcept {
+    for (int fd : {memfd_, localDoorbell_, peerDoorbell_}) {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+}
+
+std::pair<ShmEndpoint, ShmEndpoint> ShmEndpoint::createPair(size_t ringCapacity) {
+    const size_t ringSize = ShmRing::regionSize(ringCapacity);
+    const int memfd = ::memfd_create("muduo-shm", MFD_CLOEXEC);
+    if (memfd < 0) {
+        throwSystemError("memfd_create");
+    }
+    ShmEndpoint first(memfd, createDoorbell(), createDoorbell(), 0);
+
+    if (::ftruncate(memfd, static_cast<off_t>(2 * ringSize)) != 0) {
+        throwSystemError("ftruncate");
+    }
+    void* region = ::mmap(nullptr, 2 * ringSize, PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0);
+    if (region == MAP_FAILED) {
+        throwSystemError("mmap");
+    }
+    ShmRing::initialize(region, ringCapacity);
+    ShmRing::initialize(static_cast<char*>(region) + ringSize, ringCapacity);
+    ::munmap(region, 2 * ringSize);
+
+    ShmEndpoint second(duplicate(memfd), duplicate(first.peerDoorbell_), duplicate(first.localDoorbell_), 1);
+    return {std::move(first), std::move(second)};
+}
+
+void ShmEndpoint::sendOver(int unixSocket) const {
+    const int fds[3] = {memfd_, localDoorbell_, peerDoorbell_};
+    char side = static_cast<char>(side_);
+    iovec iov{&side, 1};
+
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(fds))] = {};
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+    std::memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+    if (::sendmsg(unixSocket, &msg, MSG_NOSIGNAL) != 1) {
+        throwSystemError("sendmsg(SCM_RIGHTS)");
+    }
+}
+
+ShmEndpoint ShmEndpoint::receiveFrom(int unixSocket) {
+    int fds[3] = {-1, -1, -1};
+    char side = 0;
+    iovec iov{&side, 1};
+
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(fds))] = {};
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    if (::recvmsg(unixSocket, &msg, MSG_CMSG_CLOEXEC) != 1) {
+        throwSystemError("recvmsg(SCM_RIGHTS)");
+    }
+    const cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    if (!cmsg || cmsg->cmsg_type != SCM_RIGHTS || cmsg->cmsg_len != CMSG_LEN(sizeof(fds))) {
+        errno = EPROTO;
+        throwSystemError("recvmsg(SCM_RIGHTS)");
+    }
+    std::memcpy(fds, CMSG_DATA(cmsg), sizeof(fds));
+    return ShmEndpoint(fds[0], fds[1], fds[2], side);
+}
+
+ShmConnection::ShmConnection(EventLoop* loop, std::string name, ShmEndpoint endpoint)
+    : loop_(loop),
+      name_(std::move(name)),
+      endpoint_(std::move(endpoint)),
+      region_(nullptr),
+      regionSize_(0),
+      state_(State::Connecting),
+      shutdownPending_(false) {
+    struct stat st{};
+    if (::fstat(endpoint_.memfd(), &st) != 0) {
+        throwSystemError("fstat");
+    }
+    regionSize_ = static_cast<size_t>(st.st_size);
+    region_ = ::mmap(nullptr, regionSize_, PROT_READ | PROT_WRITE, MAP_SHARED, endpoint_.memfd(), 0);
+    if (region_ == MAP_FAILED) {
+        throwSystemError("mmap");
+    }
+
+    char* rings[2] = {static_cast<char*>(region_), static_cast<char*>(region_) + regionSize_ / 2};
+    if (regionSize_ % 2 != 0 || !ShmRing::validate(rings[0], regionSize_ / 2) ||
+        !ShmRing::validate(rings[1], regionSize_ / 2)) {
+        ::munmap(region_, regionSize_);
+        errno = EPROTO;
+        throwSystemError("ShmConnection ring header");
+    }
+    inbox_ = ShmRing(rings[endpoint_.side()]);
+    outbox_ = ShmRing(rings[1 - endpoint_.side()]);
+
+    channel_ = std::make_unique<Channel>(loop_, endpoint_.localDoorbell());
+    channel_->setReadCallback([this](Timestamp t) { handleDoorbell(t); });
+    LOG_DEBUG("ShmConnection[{}] mapped {} bytes, ring capacity {}", name_, regionSize_, inbox_.capacity());
+}
+
+ShmConnection::~ShmConnection() {
+    LOG_DEBUG("ShmConnection[{}] destroyed", name_);
+    // Dropped by its owner while connected, without handleClose(): the poller
+    // must not keep a pointer to our Channel
+    if (loop_->hasChannel(channel_.get())) {
+        channel_->disableAll();
+        channel_->remove();
+    }
+    ::munmap(region_, regionSize_);
+}
+
+void ShmConnection::connectEstablished() {
+    assert(loop_->isInLoopThread());
+    state_ = State::Connected;
+    channel_->tie(shared_from_this());
+    channel_->enableReading();
+    if (connectionCallback_) connectionCallback_(shared_from_this());
+    // The peer may have written before we were watching
+    handleDoorbell(Timestamp::now());
+}
+
+void ShmConnection::send(std::string_view data) {
+    if (state_ != State::Connected) {
+        LOG_DEBUG("Attempt to send data on disconnected connection: {}", name_);
+        return;
+    }
+    if (loop_->isInLoopThread()) {
+        sendInLoop(data.data(), data.size());
+    } else {
+        loop_->queueInLoop([self = shared_from_this(), data = std::string(data)] {
+            self->sendInLoop(data.data(), data.size());
+        });
+    }
+}
+
+void ShmConnection::shutdown() {
+    State expected = State::Connected;
+    if (state_.compare_exchange_strong(expected, State::Disconnecting)) {
+        loop_->runInLoop([self = shared_from_this()] { self->shutdownInLoop(); });
+    }
+}
+
+void ShmConnection::sendInLoop(const char* data, size_t len) {
+    if (state_ == State::Disconnected) {
+        return;
+    }
+    if (outputBuffer_.readableBytes() == 0) {
+        bool notify = false;
+        const size_t n = outbox_.write(data, len, notify);
+        if (n == ShmRing::kProtocolError) {
+            LOG_ERROR("ShmConnection[{}] outbound ring header is corrupt", name_);
+            handleClose();
+            return;
+        }
+        if (notify) {
+            ringPeer();
+        }
+        data += n;
+        len -= n;
+        if (len == 0) {
+            if (writeCompleteCallback_) {
+                loop_->queueInLoop([self = shared_from_this()] { self->writeCompleteCallback_(self); });
+            }
+            return;
+        }
+    }
+    outputBuffer_.append(data, len);
+    flushOutput();
+}
+
+// Returns true once outputBuffer_ is empty
+bool ShmConnection::flushOutput() {
+    for (int attempt = 0; attempt < 2 && outputBuffer_.readableBytes() > 0; ++attempt) {
+        bool notify = false;
+        const size_t n = outbox_.write(outputBuffer_.peek(), outputBuffer_.readableBytes(), notify);
+        if (n == ShmRing::kProtocolError) {
+            LOG_ERROR("ShmConnection[{}] outbound ring header is corrupt", name_);
+            outputBuffer_.retrieveAll();
+            handleClose();
+            return false;
+        }
+        outputBuffer_.retrieve(n);
+        if (notify) {
+            ringPeer();
+        }
+        if (outputBuffer_.readableBytes() > 0 && attempt == 0) {
+            // Ask for a doorbell, then retry once in case the peer made room meanwhile
+            outbox_.requestSpace();
+        }
+    }
+    return outputBuffer_.readableBytes() == 0;
+}
+
+void ShmConnection::shutdownInLoop() {
+    if (!flushOutput()) {
+        shutdownPending_ = true;
+        return;
+    }
+    outbox_.close();
+    ringPeer();
+}
+
+void ShmConnection::ringPeer() const noexcept {
+    ringDoorbell(endpoint_.peerDoorbell(), name_);
+}
+
+void ShmConnection::handleDoorbell(Timestamp receiveTime) {
+    uint64_t count = 0;
+    while (::read(endpoint_.localDoorbell(), &count, sizeof(count)) == sizeof(count)) {
+    }
+
+    // About one ring's worth per wakeup, so a peer that keeps writing can
+    // neither starve the loop nor grow inputBuffer_ before we deliver
+    size_t received = 0;
+    while (received < inbox_.capacity()) {
+        bool notifyProducer = false;
+        const size_t n = inbox_.readInto(inputBuffer_, notifyProducer);
+        if (n == ShmRing::kProtocolError) {
+            LOG_ERROR("ShmConnection[{}] inbound ring header is corrupt", name_);
+            handleClose();
+            return;
+        }
+        if (notifyProducer) {
+            ringPeer();
+        }
+        if (n == 0) {
+            break;
+        }
+        received += n;
+    }
+    if (received > 0 && messageCallback_) {
+        messageCallback_(shared_from_this(), &inputBuffer_, receiveTime);
+    }
+
+    // The doorbell also means the peer freed space in our outbound ring
+    if (outputBuffer_.readableBytes() > 0 && flushOutput()) {
+        if (shutdownPending_) {
+            shutdownPending_ = false;
+            outbox_.close();
+            ringPeer();
+        } else if (writeCompleteCallback_) {
+            loop_->queueInLoop([self = shared_from_this()] { self->writeCompleteCallback_(self); });
+        }
+    }
+
+    if (state_ == State::Disconnected) {
+        return;
+    }
+    if (!inbox_.empty()) {
+        // Stopped at the cap: ring our own doorbell to come back after the other channels
+        ringDoorbell(endpoint_.localDoorbell(), name_);
+    } else if (inbox_.closed()) {
+        handleClose();
+    }
+}
+
+void ShmConnection::handleClose() {
+    const State previous = state_.exchange(State::Disconnected);
+    if (previous == State::Disconnected) {
+        return;
+    }
+    channel_->disableAll();
+    if (!outbox_.closed()) {
+        outbox_.close();
+        ringPeer();
+    }
+
+    const auto self = shared_from_this();
+    if (previous == State::Connected || previous == State::Disconnecting) {
+        if (connectionCallback_) connectionCallback_(self);
+    }
+    if (closeCallback_) closeCallback_(self);
+    loop_->queueInLoop([self] { self->connectDestroyed(); });
+}
+
+void ShmConnection::connectDestroyed() {
+    channel_->remove();
+}
@@ -0,0 +1,98 @@
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <new>
+
+#include <muduo/ShmRing.hpp>
+
+size_t ShmRing::roundCapacity(size_t capacity) noexcept {
+    return std::bit_ceil(std::max<size_t>(capacity, 4096));
+}
+
+size_t ShmRing::regionSize(size_t capacity) noexcept {
+    return sizeof(Header) + roundCapacity(capacity);
+}
+
+void ShmRing::initialize(void* region, size_t capacity) noexcept {
+    auto* header = new (region) Header;
+    header->head.store(0, std::memory_order_relaxed);
+    header->tail.store(0, std::memory_order_relaxed);
+    header->producerWaiting.store(0, std::memory_order_relaxed);
+    header->closed.store(0, std::memory_order_relaxed);
+    header->capacity = roundCapacity(capacity);
+}
+
+ShmRing::ShmRing(void* region) noexcept
+    : header_(static_cast<Header*>(region)),
+      data_(region ? static_cast<char*>(region) + sizeof(Header) : nullptr),
+      capacity_(region ? header_->capacity : 0),
+      mask_(capacity_ ? capacity_ - 1 : 0) {}
+
+bool ShmRing::validate(const void* region, size_t regionSize) noexcept {
+    if (regionSize < sizeof(Header)) {
+        return false;
+    }
+    const uint64_t capacity = static_cast<const Header*>(region)->capacity;
+    return capacity >= 4096 && std::has_single_bit(capacity) && capacity == regionSize - sizeof(Header);
+}
+
+size_t ShmRing::write(const char* data, size_t len, bool& notifyConsumer) noexcept {
+    notifyConsumer = false;
+    const uint64_t head = header_->head.load(std::memory_order_relaxed);
+    const uint64_t tail = header_->tail.load(std::memory_order_acquire);
+    if (head - tail > capacity_) {
+        return kProtocolError;
+    }
+    const size_t n = std::min<size_t>(len, capacity_ - (head - tail));
+    if (n == 0) {
+        return 0;
+    }
+
+    const size_t offset = head & mask_;
+    const size_t first = std::min(n, capacity_ - offset);
+    std::memcpy(data_ + offset, data, first);
+    std::memcpy(data_, data + first, n - first);
+
+    header_->head.store(head + n, std::memory_order_seq_cst);
+    // The consumer had caught up with the old head, so it may be waiting for the doorbell
+    notifyConsumer = header_->tail.load(std::memory_order_seq_cst) == head;
+    return n;
+}
+
+void ShmRing::requestSpace() noexcept {
+    header_->producerWaiting.store(1, std::memory_order_seq_cst);
+}
+
+void ShmRing::close() noexcept {
+    header_->closed.store(1, std::memory_order_release);
+}
+
+size_t ShmRing::readInto(Buffer& buf, bool& notifyProducer) {
+    notifyProducer = false;
+    const uint64_t tail = header_->tail.load(std::memory_order_relaxed);
+    const uint64_t head = header_->head.load(std::memory_order_acquire);
+    const uint64_t n = head - tail;
+    if (n == 0) {
+        return 0;
+    }
+    if (n > capacity_) {
+        return kProtocolError;
+    }
+
+    const size_t offset = tail & mask_;
+    const size_t first = std::min(n, capacity_ - offset);
+    buf.append(data_ + offset, first);
+    buf.append(data_, n - first);
+
+    header_->tail.store(tail + n, std::memory_order_seq_cst);
+    notifyProducer = header_->producerWaiting.exchange(0, std::memory_order_seq_cst) != 0;
+    return n;
+}
+
+bool ShmRing::empty() const noexcept {
+    return header_->head.load(std::memory_order_acquire) == header_->tail.load(std::memory_order_relaxed);
+}
+
+bool ShmRing::closed() const noexcept {
+    return header_->closed.load(std::memory_order_acquire) != 0;
+}
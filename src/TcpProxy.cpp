@@ -0,0 +1,252 @@
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <muduo/Logger.hpp>
+#include <muduo/TcpProxy.hpp>
+
+namespace {
+
+// Rounds of splice-in/splice-out per readiness event before yielding to other channels
+constexpr int kMaxPumpRounds = 8;
+
+// One direction of the relay: from's socket -> pipe -> to's socket
+struct Pipe {
+    int fds[2]{-1, -1};
+    size_t capacity{0};
+    size_t pending{0};      // bytes sitting in the pipe
+    bool eof{false};        // source sent FIN
+    bool finished{false};   // FIN passed on to the destination
+
+    ~Pipe() {
+        for (int fd : fds) {
+            if (fd >= 0) ::close(fd);
+        }
+    }
+
+    bool open(size_t requested) {
+        if (::pipe2(fds, O_NONBLOCK | O_CLOEXEC) != 0) {
+            return false;
+        }
+        ::fcntl(fds[1], F_SETPIPE_SZ, static_cast<int>(requested));
+        const int actual = ::fcntl(fds[1], F_GETPIPE_SZ);
+        capacity = actual > 0 ? static_cast<size_t>(actual) : 65536;
+        return true;
+    }
+};
+
+} // namespace
+
+struct TcpProxy::Session : std::enable_shared_from_this<TcpProxy::Session> {
+    TcpProxy* proxy{nullptr};
+    TcpConnectionPtr inbound;
+    TcpConnectionPtr outbound;
+    std::unique_ptr<TcpClient> client;
+    Pipe up;     // inbound -> outbound
+    Pipe down;   // outbound -> inbound
+    bool inboundClosed{false};
+    bool outboundClosed{false};
+    bool failed{false};
+    bool removing{false};
+
+    // false on a fatal splice error
+    bool pump(Pipe& pipe, const TcpConnectionPtr& from, bool fromClosed, const TcpConnectionPtr& to);
+    void update();
+    void fail(const char* what);
+};
+
+bool TcpProxy::Session::pump(Pipe& pipe, const TcpConnectionPtr& from, bool fromClosed, const TcpConnectionPtr& to) {
+    bool progress = true;
+    for (int round = 0; progress && round < kMaxPumpRounds; ++round) {
+        progress = false;
+        if (!pipe.eof && pipe.pending < pipe.capacity) {
+            const ssize_t n = ::splice(from->fd(), nullptr, pipe.fds[1], nullptr, pipe.capacity - pipe.pending,
+                                       SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+            if (n > 0) {
+                pipe.pending += static_cast<size_t>(n);
+                progress = true;
+            } else if (n == 0) {
+                pipe.eof = true;
+            } else if (errno != EAGAIN) {
+                return false;
+            }
+        }
+        if (pipe.pending > 0) {
+            const ssize_t n = ::splice(pipe.fds[0], nullptr, to->fd(), nullptr, pipe.pending,
+                                       SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+            if (n > 0) {
+                pipe.pending -= static_cast<size_t>(n);
+                progress = true;
+            } else if (n < 0 && errno != EAGAIN) {
+                return false;
+            }
+        }
+    }
+
+    if (progress && fromClosed) {
+        // The source is no longer polled, so keep going from the next iteration
+        from->getLoop()->queueInLoop([weak = weak_from_this()] {
+            if (auto self = weak.lock()) self->update();
+        });
+    }
+    return true;
+}
+
+// Moves whatever can move, then sets interest and tears down what is done
+void TcpProxy::Session::update() {
+    if (failed || removing || !outbound) {
+        return;
+    }
+    if (!pump(up, inbound, inboundClosed, outbound) ||
+        !pump(down, outbound, outboundClosed, inbound)) {
+        fail("splice");
+        return;
+    }
+
+    // Read a source only while its pipe has room; watch a destination only while its pipe has data
+    inbound->setRawInterest(!up.eof && up.pending < up.capacity, down.pending > 0);
+    outbound->setRawInterest(!down.eof && down.pending < down.capacity, up.pending > 0);
+
+    // Half-close: pass an EOF on once everything before it went out
+    if (up.eof && up.pending == 0 && !up.finished) {
+        up.finished = true;
+        outbound->shutdown();
+    }
+    if (down.eof && down.pending == 0 && !down.finished) {
+        down.finished = true;
+        inbound->shutdown();
+    }
+
+    // Both EOFs passed on: the exchange is over. With no interest left the fds
+    // are out of epoll, so no hangup event would ever arrive to end it
+    if (up.finished && down.finished) {
+        inbound->forceClose();
+        outbound->forceClose();
+    } else if (inboundClosed && up.finished) {
+        // A closed peer that has nothing left to send makes the other side useless
+        outbound->forceClose();
+    } else if (outboundClosed && down.finished) {
+        inbound->forceClose();
+    }
+    if (inboundClosed && outboundClosed) {
+        proxy->removeSession(inbound->id());
+    }
+}
+
+void TcpProxy::Session::fail(const char* what) {
+    LOG_DEBUG("TcpProxy {} failed in {}: errno={}", inbound->name(), what, errno);
+    failed = true;
+    inbound->forceClose();
+    if (outbound) {
+        outbound->forceClose();
+    }
+    if (inboundClosed && (outboundClosed || !outbound)) {
+        proxy->removeSession(inbound->id());
+    }
+}
+
+TcpProxy::TcpProxy(EventLoop* loop,
+                   const InetAddress& listenAddr,
+                   const InetAddress& backendAddr,
+                   std::string name,
+                   TcpServer::Option option)
+    : server_(loop, listenAddr, std::move(name), option),
+      backendAddr_(backendAddr) {
+    server_.setConnectionCallback([this](const TcpConnectionPtr& conn) { onConnection(conn); });
+}
+
+void TcpProxy::onConnection(const TcpConnectionPtr& conn) {
+    if (!conn->connected()) {
+        std::shared_ptr<Session> session;
+        {
+            std::lock_guard<std::mutex> lock(sessionsMutex_);
+            auto it = sessions_.find(conn->id());
+            if (it == sessions_.end()) {
+                return;
+            }
+            session = it->second;
+        }
+        session->inboundClosed = true;
+        if (!session->outbound || session->failed) {
+            removeSession(conn->id());
+        } else {
+            session->update();
+        }
+        return;
+    }
+
+    auto session = std::make_shared<Session>();
+    session->proxy = this;
+    session->inbound = conn;
+    if (!session->up.open(pipeSize_) || !session->down.open(pipeSize_)) {
+        LOG_ERROR("TcpProxy failed to create pipes for {}", conn->name());
+        conn->forceClose();
+        return;
+    }
+
+    const std::weak_ptr<Session> weak = session;
+    conn->setRawIoCallbacks([weak] { if (auto s = weak.lock()) s->update(); },
+                            [weak] { if (auto s = weak.lock()) s->update(); });
+    // Nothing is read until the backend is there
+    conn->setRawInterest(false, false);
+
+    EventLoop* loop = conn->getLoop();
+    session->client = std::make_unique<TcpClient>(loop, backendAddr_, conn->name());
+    session->client->setConnectionCallback([weak](const TcpConnectionPtr& backend) {
+        auto s = weak.lock();
+        if (!s) {
+            backend->forceClose();
+            return;
+        }
+        if (backend->connected()) {
+            s->outbound = backend;
+            backend->setRawIoCallbacks([weak] { if (auto s = weak.lock()) s->update(); },
+                                       [weak] { if (auto s = weak.lock()) s->update(); });
+            s->update();
+        } else {
+            s->outboundClosed = true;
+            s->update();
+        }
+    });
+    loop->runAfter(connectTimeout_, [weak] {
+        if (auto s = weak.lock(); s && !s->outbound) {
+            LOG_DEBUG("TcpProxy {}: backend connect timed out", s->inbound->name());
+            s->failed = true;
+            s->client->stop();
+            s->inbound->forceClose();
+        }
+    });
+
+    {
+        std::lock_guard<std::mutex> lock(sessionsMutex_);
+        sessions_.emplace(conn->id(), session);
+    }
+    session->client->connect();
+}
+
+// Deferred: the caller is still inside a callback of the session's connections
+void TcpProxy::removeSession(uint64_t id) {
+    std::shared_ptr<Session> session;
+    {
+        std::lock_guard<std::mutex> lock(sessionsMutex_);
+        auto it = sessions_.find(id);
+        if (it == sessions_.end() || it->second->removing) {
+            return;
+        }
+        it->second->removing = true;
+        session = it->second;
+    }
+    session->inbound->getLoop()->queueInLoop([this, id] {
+        std::shared_ptr<Session> doomed;
+        {
+            std::lock_guard<std::mutex> lock(sessionsMutex_);
+            auto it = sessions_.find(id);
+            if (it != sessions_.end()) {
+                doomed = std::move(it->second);
+                sessions_.erase(it);
+            }
+        }
+        if (doomed) {
+            doomed->outbound.reset();
+        }
+    });
+}
@@ -0,0 +1,148 @@
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <iterator>
+#include <limits>
+
+#include <muduo/TimerQueue.hpp>
+#include <muduo/EventLoop.hpp>
+#include <muduo/Logger.hpp>
+
+namespace {
+timespec howMuchTimeFromNow(Timestamp when) noexcept {
+    int64_t microseconds = when.microSecondsSinceEpoch() - Timestamp::now().microSecondsSinceEpoch();
+    if (microseconds < 100) {
+        microseconds = 100;
+    }
+    timespec ts{};
+    ts.tv_sec = static_cast<time_t>(microseconds / Timestamp::kMicroSecondsPerSecond);
+    ts.tv_nsec = static_cast<long>((microseconds % Timestamp::kMicroSecondsPerSecond) * 1000);
+    return ts;
+}
+}
+
+TimerQueue::TimerQueue(EventLoop* loop)
+    : loop_(loop),
+      timerfd_(createTimerfd()),
+      timerfdChannel_(loop, timerfd_),
+      callingExpiredTimers_(false)
+{
+    timerfdChannel_.setReadCallback([this](Timestamp) { handleRead(); });
+    timerfdChannel_.enableReading();
+}
+
+TimerQueue::~TimerQueue() {
+    timerfdChannel_.disableAll();
+    timerfdChannel_.remove();
+    ::close(timerfd_);
+    for (const Entry& timer : timers_) {
+        delete timer.second;
+    }
+}
+
+TimerId TimerQueue::addTimer(Timer::TimerCallback cb, Timestamp when, double interval) {
+    auto* timer = new Timer(std::move(cb), when, interval);
+    loop_->runInLoop([this, timer] { addTimerInLoop(timer); });
+    return TimerId(timer, timer->sequence());
+}
+
+void TimerQueue::cancel(TimerId timerId) {
+    loop_->runInLoop([this, timerId] { cancelInLoop(timerId); });
+}
+
+int TimerQueue::createTimerfd() {
+    const int timerfd = ::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (timerfd < 0) {
+        LOG_FATAL("[TimerQueue] timerfd_create failed: {} ({})", errno, strerror(errno));
+    }
+    return timerfd;
+}
+
+void TimerQueue::addTimerInLoop(Timer* timer) {
+    if (insert(timer)) {
+        resetTimerfd(timer->expiration());
+    }
+}
+
+void TimerQueue::cancelInLoop(TimerId timerId) {
+    const ActiveTimer timer(timerId.timer_, timerId.sequence_);
+    auto it = activeTimers_.find(timer);
+    if (it != activeTimers_.end()) {
+        timers_.erase(Entry(it->first->expiration(), it->first));
+        delete it->first;
+        activeTimers_.erase(it);
+    } else if (callingExpiredTimers_) {
+        // Cancelled from inside its own callback; keep it from being re-armed
+        cancelingTimers_.insert(timer);
+    }
+}
+
+void TimerQueue::handleRead() {
+    uint64_t howmany = 0;
+    const ssize_t n = ::read(timerfd_, &howmany, sizeof(howmany));
+    if (n != sizeof(howmany)) {
+        LOG_ERROR("[TimerQueue] Read {} bytes from timerfd (expected 8)", n);
+    }
+
+    const Timestamp now = Timestamp::now();
+    const std::vector<Entry> expired = getExpired(now);
+
+    callingExpiredTimers_ = true;
+    cancelingTimers_.clear();
+    for (const Entry& it : expired) {
+        it.second->run();
+    }
+    callingExpiredTimers_ = false;
+
+    reset(expired, now);
+}
+
+std::vector<TimerQueue::Entry> TimerQueue::getExpired(Timestamp now) {
+    const Entry sentry(now, reinterpret_cast<Timer*>(std::numeric_limits<uintptr_t>::max()));
+    const auto end = timers_.lower_bound(sentry);
+
+    std::vector<Entry> expired(timers_.begin(), end);
+    timers_.erase(timers_.begin(), end);
+
+    for (const Entry& it : expired) {
+        activeTimers_.erase(ActiveTimer(it.second, it.second->sequence()));
+    }
+    return expired;
+}
+
+void TimerQueue::reset(const std::vector<Entry>& expired, Timestamp now) {
+    for (const Entry& it : expired) {
+        const ActiveTimer timer(it.second, it.second->sequence());
+        if (it.second->repeat() && cancelingTimers_.find(timer) == cancelingTimers_.end()) {
+            it.second->restart(now);
+            insert(it.second);
+        } else {
+            delete it.second;
+        }
+    }
+
+    if (!timers_.empty()) {
+        const Timestamp nextExpire = timers_.begin()->second->expiration();
+        if (nextExpire.valid()) {
+            resetTimerfd(nextExpire);
+        }
+    }
+}
+
+bool TimerQueue::insert(Timer* timer) {
+    const Timestamp when = timer->expiration();
+    const bool earliestChanged = timers_.empty() || when < timers_.begin()->first;
+
+    timers_.insert(Entry(when, timer));
+    activeTimers_.insert(ActiveTimer(timer, timer->sequence()));
+    return earliestChanged;
+}
+
+void TimerQueue::resetTimerfd(Timestamp expiration) {
+    itimerspec newValue{};
+    newValue.it_value = howMuchTimeFromNow(expiration);
+    if (::timerfd_settime(timerfd_, 0, &newValue, nullptr) != 0) {
+        LOG_ERROR("[TimerQueue] timerfd_settime failed: {} ({})", errno, strerror(errno));
+    }
+}
@@ -0,0 +1,48 @@
+#include <algorithm>
+
+#include <muduo/TokenBucket.hpp>
+
+namespace {
+std::shared_ptr<TokenBucket> makeBucket(const RateLimit& limit) {
+    if (limit.ratePerSecond <= 0.0) {
+        return nullptr;
+    }
+    // A burst smaller than one second's worth of tokens is still allowed, but never below 1
+    const double burst = std::max(limit.burst > 0.0 ? limit.burst : limit.ratePerSecond, 1.0);
+    return std::make_shared<TokenBucket>(limit.ratePerSecond, burst);
+}
+}
+
+TokenBucket::TokenBucket(double ratePerSecond, double burst)
+    : rate_(ratePerSecond),
+      burst_(burst),
+      origin_(Clock::now()),
+      zeroAt_(-burst / ratePerSecond) {}
+
+double TokenBucket::now() const noexcept {
+    return std::chrono::duration<double>(Clock::now() - origin_).count();
+}
+
+void TokenBucket::consume(double tokens) noexcept {
+    const double t = now();
+    double zeroAt = zeroAt_.load(std::memory_order_relaxed);
+    while (!zeroAt_.compare_exchange_weak(zeroAt, effectiveZeroAt(zeroAt, t) + tokens / rate_,
+                                          std::memory_order_relaxed)) {
+    }
+}
+
+double TokenBucket::available() const noexcept {
+    const double t = now();
+    return (t - effectiveZeroAt(zeroAt_.load(std::memory_order_relaxed), t)) * rate_;
+}
+
+double TokenBucket::secondsUntilAvailable(double tokens) const noexcept {
+    const double t = now();
+    return std::max(0.0, effectiveZeroAt(zeroAt_.load(std::memory_order_relaxed), t) + tokens / rate_ - t);
+}
+
+RateLimiters RateLimiters::fromConfig(const RateLimitConfig& config) {
+    return RateLimiters{makeBucket(config.ingressBytes),
+                        makeBucket(config.egressBytes),
+                        makeBucket(config.ingressMessages)};
+}
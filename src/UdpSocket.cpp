@@ -0,0 +1,204 @@
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+#include <unistd.h>
+
+#include <muduo/UdpSocket.hpp>
+#include <muduo/Logger.hpp>
+
+UdpSocket::UdpSocket(EventLoop* loop,
+                     const InetAddress& bindAddr,
+                     bool reuseport,
+                     size_t batchSize,
+                     size_t maxDatagramSize)
+    : loop_(loop),
+      socket_(createNonblocking()),
+      channel_(loop, socket_.fd()),
+      batchSize_(std::max<size_t>(batchSize, 1)),
+      maxDatagramSize_(std::max<size_t>(maxDatagramSize, 1)),
+      recvBuffers_(batchSize_ * maxDatagramSize_),
+      recvIovecs_(batchSize_),
+      recvAddrs_(batchSize_),
+      recvMsgs_(batchSize_),
+      sendIovecs_(batchSize_),
+      sendMsgs_(batchSize_),
+      flushQueued_(false) {
+    socket_.setReuseAddr(Socket::ENABLE);
+    socket_.setReusePort(reuseport ? Socket::ENABLE : Socket::DISABLE);
+    socket_.bindAddress(bindAddr);
+
+    for (size_t i = 0; i < batchSize_; ++i) {
+        recvIovecs_[i].iov_base = recvBuffers_.data() + i * maxDatagramSize_;
+        recvIovecs_[i].iov_len = maxDatagramSize_;
+        recvMsgs_[i].msg_hdr.msg_iov = &recvIovecs_[i];
+        recvMsgs_[i].msg_hdr.msg_iovlen = 1;
+        recvMsgs_[i].msg_hdr.msg_name = &recvAddrs_[i];
+        sendMsgs_[i].msg_hdr.msg_iov = &sendIovecs_[i];
+        sendMsgs_[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    channel_.setReadCallback([this](Timestamp t) { handleRead(t); });
+    channel_.setWriteCallback([this] { handleWrite(); });
+}
+
+UdpSocket::~UdpSocket() noexcept {
+    channel_.disableAll();
+    channel_.remove();
+}
+
+int UdpSocket::createNonblocking() {
+    constexpr int socktype = SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC;
+    int sockfd = ::socket(AF_INET, socktype, IPPROTO_UDP);
+    if (sockfd < 0) {
+        char buf[64];
+        strerror_r(errno, buf, sizeof(buf));
+        LOG_FATAL("Create udp socket error: {}", buf);
+    }
+    return sockfd;
+}
+
+void UdpSocket::startReading() {
+    loop_->isInLoopThread();
+    channel_.enableReading();
+}
+
+void UdpSocket::connect(const InetAddress& peer) {
+    if (::connect(socket_.fd(), reinterpret_cast<const sockaddr*>(peer.getSockAddr()), sizeof(sockaddr_in)) != 0) {
+        LOG_ERROR("Udp connect to {} failed: {}", peer.toIpPort(), strerror(errno));
+    }
+}
+
+InetAddress UdpSocket::localAddress() const {
+    sockaddr_in local{};
+    socklen_t len = sizeof(local);
+    ::getsockname(socket_.fd(), reinterpret_cast<sockaddr*>(&local), &len);
+    return InetAddress(local);
+}
+
+void UdpSocket::sendTo(const sockaddr_in& peer, std::string_view data) {
+    if (loop_->isInLoopThread()) {
+        queueDatagram(peer, std::string(data));
+    } else {
+        loop_->queueInLoop([this, alive = std::weak_ptr<void>(lifeline_),
+                            addr = peer, data = std::string(data)]() mutable {
+            if (!alive.expired()) queueDatagram(addr, std::move(data));
+        });
+    }
+}
+
+void UdpSocket::send(std::string_view data) {
+    sockaddr_in connected{};
+    connected.sin_family = AF_UNSPEC;
+    if (loop_->isInLoopThread()) {
+        queueDatagram(connected, std::string(data));
+    } else {
+        loop_->queueInLoop([this, alive = std::weak_ptr<void>(lifeline_),
+                            connected, data = std::string(data)]() mutable {
+            if (!alive.expired()) queueDatagram(connected, std::move(data));
+        });
+    }
+}
+
+void UdpSocket::queueDatagram(const sockaddr_in& peer, std::string data) {
+    if (outQueue_.size() >= kMaxPendingDatagrams) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    outQueue_.push_back({peer, std::move(data)});
+
+    // Flush once per loop iteration, after every handler had its chance to queue
+    if (!flushQueued_ && !channel_.isWriting()) {
+        flushQueued_ = true;
+        loop_->queueInLoop([this, alive = std::weak_ptr<void>(lifeline_)] {
+            if (alive.expired()) return;
+            flushQueued_ = false;
+            flushOutput();
+        });
+    }
+}
+
+void UdpSocket::handleRead(Timestamp receiveTime) {
+    for (int round = 0; round < kMaxBatchesPerWakeup; ++round) {
+        for (size_t i = 0; i < batchSize_; ++i) {
+            recvMsgs_[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+            recvMsgs_[i].msg_hdr.msg_flags = 0;
+        }
+
+        const int n = ::recvmmsg(socket_.fd(), recvMsgs_.data(), static_cast<unsigned>(batchSize_),
+                                 MSG_DONTWAIT, nullptr);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                LOG_ERROR("recvmmsg error on fd {}: {}", socket_.fd(), strerror(errno));
+            }
+            return;
+        }
+
+        received_.fetch_add(n, std::memory_order_relaxed);
+        for (int i = 0; i < n; ++i) {
+            const msghdr& hdr = recvMsgs_[i].msg_hdr;
+            if (hdr.msg_flags & MSG_TRUNC) {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            if (messageCallback_) {
+                messageCallback_(*this,
+                                 std::string_view(static_cast<const char*>(recvIovecs_[i].iov_base), recvMsgs_[i].msg_len),
+                                 recvAddrs_[i],
+                                 receiveTime);
+            }
+        }
+
+        if (static_cast<size_t>(n) < batchSize_) {
+            return;
+        }
+    }
+}
+
+void UdpSocket::handleWrite() {
+    flushOutput();
+}
+
+void UdpSocket::flushOutput() {
+    size_t done = 0;
+    while (done < outQueue_.size()) {
+        const size_t count = std::min(batchSize_, outQueue_.size() - done);
+        for (size_t i = 0; i < count; ++i) {
+            PendingDatagram& dgram = outQueue_[done + i];
+            sendIovecs_[i].iov_base = dgram.data.data();
+            sendIovecs_[i].iov_len = dgram.data.size();
+            const bool connected = dgram.peer.sin_family == AF_UNSPEC;
+            sendMsgs_[i].msg_hdr.msg_name = connected ? nullptr : &dgram.peer;
+            sendMsgs_[i].msg_hdr.msg_namelen = connected ? 0 : sizeof(sockaddr_in);
+        }
+
+        const int n = ::sendmmsg(socket_.fd(), sendMsgs_.data(), static_cast<unsigned>(count), MSG_DONTWAIT);
+        if (n >= 0) {
+            sent_.fetch_add(n, std::memory_order_relaxed);
+            done += n;
+            continue;
+        }
+
+        const int err = errno;
+        if (err == EAGAIN || err == EWOULDBLOCK || err == ENOBUFS) {
+            break;
+        }
+        if (err != EINTR) {
+            // Only the first datagram of the batch failed (e.g. ECONNREFUSED); skip it
+            LOG_DEBUG("sendmmsg error on fd {}: {}", socket_.fd(), strerror(err));
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            ++done;
+        }
+    }
+
+    outQueue_.erase(outQueue_.begin(), outQueue_.begin() + static_cast<std::ptrdiff_t>(done));
+    if (outQueue_.empty()) {
+        if (channel_.isWriting()) {
+            channel_.disableWriting();
+        }
+    } else if (!channel_.isWriting()) {
+        channel_.enableWriting();
+    }
+}
@@ -0,0 +1,166 @@
+#include <thread>
+#include <utility>
+
+#include <muduo/WorkStealingPool.hpp>
+#include <muduo/Logger.hpp>
+
+namespace {
+thread_local const WorkStealingPool* t_ownerPool = nullptr;
+thread_local size_t t_workerIndex = 0;
+}
+
+WorkStealingPool::WorkStealingPool(std::string name)
+    : name_(std::move(name)),
+      state_(State::kIdle),
+      submitting_(0),
+      next_(0),
+      pending_(0),
+      sleeping_(0) {}
+
+WorkStealingPool::~WorkStealingPool() {
+    stop();
+}
+
+void WorkStealingPool::start(int numThreads) {
+    State expected = State::kIdle;
+    if (numThreads <= 0 || !state_.compare_exchange_strong(expected, State::kRunning)) {
+        LOG_ERROR("[WorkStealingPool] {} start({}) ignored: {}", name_, numThreads,
+                  expected == State::kIdle ? "no workers" : "started before");
+        return;
+    }
+
+    workers_.reserve(numThreads);
+    for (int i = 0; i < numThreads; ++i) {
+        workers_.emplace_back(std::make_unique<Worker>());
+    }
+
+    threads_.reserve(numThreads);
+    for (int i = 0; i < numThreads; ++i) {
+        threads_.emplace_back(std::make_unique<Thread>(
+            [this, i] { workerLoop(static_cast<size_t>(i)); },
+            name_ + std::to_string(i)));
+        threads_.back()->start();
+    }
+    LOG_DEBUG("[WorkStealingPool] {} started with {} workers", name_, numThreads);
+}
+
+void WorkStealingPool::stop() {
+    if (state_.exchange(State::kStopped) != State::kRunning) {
+        return;
+    }
+
+    // A submit() that saw kRunning may still be pushing; let it finish
+    while (submitting_.load() > 0) {
+        std::this_thread::yield();
+    }
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex_);
+        sleepCond_.notify_all();
+    }
+    for (auto& thread : threads_) {
+        thread->join();
+    }
+    threads_.clear();
+
+    // Workers drain the deques before they exit; whatever is left runs here
+    size_t leftover = 0;
+    for (auto& worker : workers_) {
+        for (Task& task : worker->tasks) {
+            runTask(task);
+            ++leftover;
+        }
+    }
+    workers_.clear();
+    pending_.store(0);
+    LOG_DEBUG("[WorkStealingPool] {} stopped, {} tasks finished by stop()", name_, leftover);
+}
+
+void WorkStealingPool::submit(Task task) {
+    submitting_.fetch_add(1);
+    if (state_.load() != State::kRunning) {
+        submitting_.fetch_sub(1);
+        runTask(task);     // not started or stopped: degrade to running inline
+        return;
+    }
+
+    const size_t index = (t_ownerPool == this)
+        ? t_workerIndex
+        : next_.fetch_add(1, std::memory_order_relaxed) % workers_.size();
+    push(index, std::move(task));
+    submitting_.fetch_sub(1);
+}
+
+void WorkStealingPool::runTask(Task& task) noexcept {
+    try {
+        task();
+    } catch (const std::exception& e) {
+        LOG_ERROR("[WorkStealingPool] Task threw: {}", e.what());
+    } catch (...) {
+        LOG_ERROR("[WorkStealingPool] Task threw unknown exception");
+    }
+}
+
+void WorkStealingPool::push(size_t index, Task task) {
+    pending_.fetch_add(1);
+    {
+        std::lock_guard<std::mutex> lock(workers_[index]->mutex);
+        workers_[index]->tasks.emplace_back(std::move(task));
+    }
+
+    if (sleeping_.load() > 0) {
+        std::lock_guard<std::mutex> lock(sleepMutex_);
+        sleepCond_.notify_one();
+    }
+}
+
+void WorkStealingPool::workerLoop(size_t index) {
+    t_ownerPool = this;
+    t_workerIndex = index;
+
+    Task task;
+    for (;;) {
+        if (popLocal(index, task) || steal(index, task)) {
+            pending_.fetch_sub(1, std::memory_order_relaxed);
+            runTask(task);
+            task = nullptr;
+            continue;
+        }
+        // Only exit once nothing is left to pop or steal
+        if (state_.load(std::memory_order_acquire) != State::kRunning) {
+            break;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex_);
+        sleeping_.fetch_add(1);
+        sleepCond_.wait(lock, [this] {
+            return pending_.load() > 0 || state_.load(std::memory_order_acquire) != State::kRunning;
+        });
+        sleeping_.fetch_sub(1);
+    }
+}
+
+bool WorkStealingPool::popLocal(size_t index, Task& task) {
+    Worker& worker = *workers_[index];
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    if (worker.tasks.empty()) {
+        return false;
+    }
+    task = std::move(worker.tasks.front());
+    worker.tasks.pop_front();
+    return true;
+}
+
+bool WorkStealingPool::steal(size_t thief, Task& task) {
+    const size_t n = workers_.size();
+    for (size_t i = 1; i < n; ++i) {
+        Worker& victim = *workers_[(thief + i) % n];
+        std::unique_lock<std::mutex> lock(victim.mutex, std::try_to_lock);
+        if (!lock.owns_lock() || victim.tasks.empty()) {
+            continue;
+        }
+        task = std::move(victim.tasks.back());
+        victim.tasks.pop_back();
+        return true;
+    }
+    return false;
+}
@@ -32,7 +32,7 @@ private:
     }
 
     void onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp time) {
-        std::string msg = buf->ret`rieveAllAsString();
+        std::string msg = buf->retrieveAllAsString();
         conn->send(msg);
 		conn->shutdown();
     }
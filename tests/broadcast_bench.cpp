@@ -0,0 +1,351 @@
+// Memory and CPU per broadcast with many subscribers: every connection of a
+// TcpServer subscribes to one topic and publish() sends it -s byte payloads.
+// For each subscriber count it reports
+// - the resident set per subscriber once all are connected and subscribed;
+// - draining: server CPU (all threads, user + sys) per broadcast while the
+//   clients read everything, measured until every byte has arrived;
+// - stalled: resident set growth and CPU per broadcast while the clients
+//   read nothing. Each socket buffers only -k bytes each way, so most of
+//   every payload stays queued in the server: as one reference per
+//   subscriber, where copying it would cost subscribers * size.
+// The clients live in child processes (-p connections each, one loopback
+// source address per child) forked before any thread starts. The server
+// needs a descriptor per subscriber, so a count above its hard
+// RLIMIT_NOFILE is skipped; raise it (ulimit -Hn, as root) for 50k and 100k.
+// Usage: broadcast_bench [-n counts=10000,50000,100000] [-b broadcasts=100]
+//                        [-s size=1024] [-k socketBuffer=16384]
+//                        [-t serverThreads=4] [-p perClient=15000]
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <muduo/EventLoopThread.hpp>
+#include <muduo/Logger.hpp>
+#include <muduo/TcpServer.hpp>
+
+#include "TestUtil.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const std::string kTopic = "bench";
+
+// Parent -> child
+struct Command {
+    char op;          // 'c'onnect, 'd'rain, 'x' close all, 'q'uit
+    uint16_t port;
+    uint32_t count;   // connections to open
+    uint64_t bytes;   // to read in total before answering a drain
+};
+
+template<typename T>
+bool readValue(int fd, T* value) {
+    return ::read(fd, value, sizeof(T)) == static_cast<ssize_t>(sizeof(T));
+}
+
+template<typename T>
+void writeValue(int fd, T value) {
+    if (::write(fd, &value, sizeof(T)) != static_cast<ssize_t>(sizeof(T))) std::exit(1);
+}
+
+int connectFrom(in_addr_t source, uint16_t port, int socketBuffer) {
+    const int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &socketBuffer, sizeof(socketBuffer));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = source;
+    if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        ::close(fd);
+        return -1;
+    }
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        ::close(fd);
+        return -1;
+    }
+    ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+    return fd;
+}
+
+// Reads from every socket until bytes have arrived in total, or nothing has for 10 s
+uint64_t drain(const std::vector<int>& fds, uint64_t bytes) {
+    const int epfd = ::epoll_create1(EPOLL_CLOEXEC);
+    for (const int fd : fds) {
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        ::epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev);
+    }
+    std::vector<epoll_event> events(1024);
+    std::vector<char> buf(64 * 1024);
+    uint64_t received = 0;
+    while (received < bytes) {
+        const int n = ::epoll_wait(epfd, events.data(), static_cast<int>(events.size()), 10000);
+        if (n <= 0) break;
+        for (int i = 0; i < n; ++i) {
+            for (ssize_t r; (r = ::read(events[i].data.fd, buf.data(), buf.size())) > 0;) {
+                received += static_cast<uint64_t>(r);
+            }
+        }
+    }
+    ::close(epfd);
+    return received;
+}
+
+// Child process: connects from its own 127.0.0.x so no source address runs out of ports
+void client(int index, int cmdFd, int resultFd, int socketBuffer) {
+    const in_addr_t source = htonl(INADDR_LOOPBACK + static_cast<in_addr_t>(index));
+    std::vector<int> fds;
+    for (Command cmd; readValue(cmdFd, &cmd) && cmd.op != 'q';) {
+        if (cmd.op == 'c') {
+            for (uint32_t i = 0; i < cmd.count; ++i) {
+                if (const int fd = connectFrom(source, cmd.port, socketBuffer); fd >= 0) fds.push_back(fd);
+            }
+            writeValue(resultFd, static_cast<uint64_t>(fds.size()));
+        } else if (cmd.op == 'd') {
+            writeValue(resultFd, drain(fds, cmd.bytes));
+        } else if (cmd.op == 'x') {
+            // Reset rather than close, so no source port lingers in TIME_WAIT
+            const linger reset{1, 0};
+            for (const int fd : fds) {
+                ::setsockopt(fd, SOL_SOCKET, SO_LINGER, &reset, sizeof(reset));
+                ::close(fd);
+            }
+            fds.clear();
+            writeValue(resultFd, uint64_t{0});
+        }
+    }
+}
+
+struct Child {
+    pid_t pid;
+    int cmdFd;
+    int resultFd;
+    uint32_t connections = 0;
+};
+
+double cpuSeconds() {
+    rusage usage{};
+    ::getrusage(RUSAGE_SELF, &usage);
+    return static_cast<double>(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) +
+           static_cast<double>(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+// Sends cmd to every child, with its share of the connections for 'c', and sums the answers
+uint64_t ask(std::vector<Child>& children, Command cmd, const std::vector<uint32_t>& shares) {
+    for (size_t i = 0; i < children.size(); ++i) {
+        cmd.count = shares[i];
+        writeValue(children[i].cmdFd, cmd);
+    }
+    uint64_t total = 0;
+    for (Child& child : children) {
+        uint64_t value = 0;
+        readValue(child.resultFd, &value);
+        if (cmd.op == 'c') child.connections = static_cast<uint32_t>(value);
+        total += value;
+    }
+    return total;
+}
+
+// Waits until every IO loop has run what was queued on it so far
+void settle(const std::vector<EventLoop*>& loops) {
+    for (EventLoop* loop : loops) {
+        std::promise<void> done;
+        loop->queueInLoop([&done] { done.set_value(); });
+        done.get_future().wait();
+    }
+}
+
+void run(std::vector<Child>& children, uint32_t subscribers, int broadcasts, size_t size, int socketBuffer,
+         int serverThreads, uint32_t perClient) {
+    EventLoopThread baseThread;
+    EventLoop* base = baseThread.startLoop();
+    std::unique_ptr<TcpServer> server;
+    std::atomic<uint32_t> subscribed{0};
+    std::atomic<uint32_t> live{0};
+    uint16_t port = 0;
+    std::vector<EventLoop*> loops;
+    std::promise<void> started;
+    base->runInLoop([&] {
+        server = std::make_unique<TcpServer>(base, InetAddress(0), "broadcast_bench");
+        server->setThreadNum(static_cast<size_t>(serverThreads));
+        server->setConnectionCallback([&, raw = server.get()](const TcpConnectionPtr& conn) {
+            if (conn->connected()) {
+                ::setsockopt(conn->fd(), SOL_SOCKET, SO_SNDBUF, &socketBuffer, sizeof(socketBuffer));
+                ++live;
+                raw->subscribe(kTopic, conn);   // on the connection's loop: done when this returns
+                ++subscribed;
+            } else {
+                --live;
+            }
+        });
+        server->start();
+        port = server->listenAddress().toPort();
+        loops = server->getAllLoops();
+        started.set_value();
+    });
+    started.get_future().wait();
+
+    const long rssBase = residentBytes();
+    std::vector<uint32_t> shares(children.size());
+    uint32_t left = subscribers;
+    for (uint32_t& share : shares) {
+        share = std::min(left, perClient);
+        left -= share;
+    }
+    const uint64_t connected = ask(children, Command{'c', port, 0, 0}, shares);
+    const Clock::time_point deadline = Clock::now() + std::chrono::seconds(30);
+    while (subscribed.load() < connected && Clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    settle(loops);
+    const double rssPerSubscriber = static_cast<double>(residentBytes() - rssBase) / static_cast<double>(connected);
+
+    // Draining: the clients read while the broadcasts go out
+    const SharedPayload payload = std::make_shared<const std::string>(size, 'b');
+    for (size_t i = 0; i < children.size(); ++i) {
+        writeValue(children[i].cmdFd, Command{'d', port, 0, uint64_t{children[i].connections} * broadcasts * size});
+    }
+    double cpu = cpuSeconds();
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < broadcasts; ++i) {
+        server->publish(kTopic, payload);
+    }
+    uint64_t received = 0;
+    for (Child& child : children) {
+        uint64_t value = 0;
+        readValue(child.resultFd, &value);
+        received += value;
+    }
+    const double drainCpu = (cpuSeconds() - cpu) / broadcasts;
+    const double drainSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    // Stalled: nobody reads, so what the sockets do not take stays queued in the server
+    const long rssBeforeStall = residentBytes();
+    cpu = cpuSeconds();
+    for (int i = 0; i < broadcasts; ++i) {
+        server->publish(kTopic, payload);
+    }
+    settle(loops);
+    const double stallCpu = (cpuSeconds() - cpu) / broadcasts;
+    const double stallRss = static_cast<double>(residentBytes() - rssBeforeStall) / broadcasts;
+
+    ask(children, Command{'x', port, 0, 0}, shares);
+    while (live.load() > 0 && Clock::now() < deadline + std::chrono::seconds(30)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    std::promise<void> stopped;
+    base->runInLoop([&] {
+        server.reset();
+        stopped.set_value();
+    });
+    stopped.get_future().wait();
+
+    const uint64_t expected = connected * static_cast<uint64_t>(broadcasts) * size;
+    std::printf("  %6llu subscribers: %6.0f B resident each | draining: %8.2f ms CPU per broadcast, "
+                "%9.0f deliveries/s%s | stalled: %8.2f ms CPU, %8.1f KiB resident per broadcast "
+                "(%5.1f B per subscriber; a copy each would be %zu)\n",
+                static_cast<unsigned long long>(connected), rssPerSubscriber, drainCpu * 1e3,
+                static_cast<double>(received / size) / drainSeconds, received == expected ? "" : " (INCOMPLETE)",
+                stallCpu * 1e3, stallRss / 1024, stallRss / static_cast<double>(connected), size);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::vector<uint32_t> counts;
+    int broadcasts = 100;
+    size_t size = 1024;
+    int socketBuffer = 16384;
+    int serverThreads = 4;
+    uint32_t perClient = 15000;
+    for (int opt; (opt = ::getopt(argc, argv, "n:b:s:k:t:p:")) != -1;) {
+        switch (opt) {
+        case 'n':
+            for (char* cursor = optarg; *cursor;) {
+                counts.push_back(static_cast<uint32_t>(std::max(1UL, std::strtoul(cursor, &cursor, 10))));
+                if (*cursor == ',') ++cursor;
+                else if (*cursor) break;
+            }
+            break;
+        case 'b': broadcasts = std::max(1, std::atoi(optarg)); break;
+        case 's': size = std::max<size_t>(1, std::strtoull(optarg, nullptr, 10)); break;
+        case 'k': socketBuffer = std::max(1024, std::atoi(optarg)); break;
+        case 't': serverThreads = std::max(0, std::atoi(optarg)); break;
+        case 'p': perClient = static_cast<uint32_t>(std::max(1, std::atoi(optarg))); break;
+        default:
+            std::fprintf(stderr, "usage: %s [-n counts] [-b broadcasts] [-s size] [-k socketBuffer] "
+                                 "[-t serverThreads] [-p perClient]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (counts.empty()) counts = {10000, 50000, 100000};
+
+    // Every process holds up to its hard limit of descriptors
+    rlimit limit{};
+    ::getrlimit(RLIMIT_NOFILE, &limit);
+    limit.rlim_cur = limit.rlim_max;
+    ::setrlimit(RLIMIT_NOFILE, &limit);
+    constexpr uint32_t kSpareFds = 64;
+    const uint32_t maxFds = static_cast<uint32_t>(std::min<rlim_t>(limit.rlim_max, UINT32_MAX));
+    perClient = std::min(perClient, maxFds - kSpareFds);
+
+    uint32_t largest = 0;
+    for (const uint32_t n : counts) {
+        if (n + kSpareFds <= maxFds) largest = std::max(largest, n);
+    }
+    std::vector<Child> children;
+    for (uint32_t held = 0; held < largest; held += perClient) {
+        int cmd[2];
+        int result[2];
+        if (::pipe(cmd) != 0 || ::pipe(result) != 0) return 1;
+        const pid_t pid = ::fork();
+        if (pid == 0) {
+            ::close(cmd[1]);
+            ::close(result[0]);
+            client(static_cast<int>(children.size()) + 1, cmd[0], result[1], socketBuffer);
+            std::_Exit(0);
+        }
+        ::close(cmd[0]);
+        ::close(result[1]);
+        children.push_back(Child{pid, cmd[1], result[0]});
+    }
+    // The clients close with a reset, which every server connection logs as an error
+    Logger::instance().set_level(LogLevel::Fatal);
+
+    std::printf("%d broadcasts of %zu bytes to one topic, %d server IO loops, %d-byte socket buffers, "
+                "%zu client processes\n", broadcasts, size, serverThreads, socketBuffer, children.size());
+    for (const uint32_t n : counts) {
+        if (n + kSpareFds > maxFds) {
+            std::printf("  %6u subscribers: skipped, needs %u descriptors and the hard limit is %u\n",
+                        n, n + kSpareFds, maxFds);
+            continue;
+        }
+        run(children, n, broadcasts, size, socketBuffer, serverThreads, perClient);
+    }
+
+    for (const Child& child : children) {
+        writeValue(child.cmdFd, Command{'q', 0, 0, 0});
+        ::waitpid(child.pid, nullptr, 0);
+    }
+    return 0;
+}
@@ -0,0 +1,140 @@
+// Connect/close churn: client threads open a connection, send one byte,
+// read it back, wait for the server to close and start over. The server
+// echoes once and shuts down, so TIME_WAIT stays on its side and the
+// clients do not run out of ephemeral ports. Reports connections per second.
+// Then opens -f idle connections and reports the server's per-connection
+// footprint: sizeof(TcpConnection) and the resident set growth per
+// connection, which also counts the two Buffers' initial storage, the
+// shard's map entry and the pooled block around the object.
+// Usage: churn_bench [-c clients=4] [-d seconds=3] [-t serverThreads=1]
+//                    [-f idleConnections=2000]
+#include <arpa/inet.h>
+#include <getopt.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <future>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <muduo/EventLoopThread.hpp>
+#include <muduo/Logger.hpp>
+#include <muduo/TcpServer.hpp>
+
+#include "TestUtil.hpp"
+
+namespace {
+
+// One full connection lifetime; false if any step failed
+bool churnOnce(uint16_t port) {
+    const int fd = connectTo(port);
+    if (fd < 0) return false;
+    char byte = 'x';
+    bool ok = ::write(fd, &byte, 1) == 1 && ::read(fd, &byte, 1) == 1;
+    ok = ok && ::read(fd, &byte, 1) == 0;   // the server's close
+    ::close(fd);
+    return ok;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int clients = 4;
+    int seconds = 3;
+    int serverThreads = 1;
+    int idleConnections = 2000;
+    for (int opt; (opt = ::getopt(argc, argv, "c:d:t:f:")) != -1;) {
+        switch (opt) {
+        case 'c': clients = std::max(1, std::atoi(optarg)); break;
+        case 'd': seconds = std::max(1, std::atoi(optarg)); break;
+        case 't': serverThreads = std::max(0, std::atoi(optarg)); break;
+        case 'f': idleConnections = std::max(1, std::atoi(optarg)); break;
+        default:
+            std::fprintf(stderr, "usage: %s [-c clients] [-d seconds] [-t serverThreads] [-f idleConnections]\n",
+                         argv[0]);
+            return 2;
+        }
+    }
+    Logger::instance().set_level(LogLevel::Error);
+
+    EventLoopThread serverThread;
+    EventLoop* loop = serverThread.startLoop();
+    std::unique_ptr<TcpServer> server;
+    std::atomic<int> live{0};
+    uint16_t port = 0;
+    std::promise<void> started;
+    loop->runInLoop([&] {
+        server = std::make_unique<TcpServer>(loop, InetAddress(0), "churn_bench");
+        server->setThreadNum(static_cast<size_t>(serverThreads));
+        server->setConnectionCallback([&live](const TcpConnectionPtr& conn) {
+            live += conn->connected() ? 1 : -1;
+        });
+        server->setMessageCallback([](const TcpConnectionPtr& conn, Buffer* buf, Timestamp) {
+            conn->send(std::string_view(buf->peek(), buf->readableBytes()));
+            buf->retrieveAll();
+            conn->shutdown();
+        });
+        server->start();
+        port = server->listenAddress().toPort();
+        started.set_value();
+    });
+    started.get_future().wait();
+
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> completed{0};
+    std::atomic<uint64_t> failed{0};
+    std::vector<std::thread> threads;
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < clients; ++i) {
+        threads.emplace_back([&] {
+            while (!stop.load(std::memory_order_relaxed)) {
+                ++(churnOnce(port) ? completed : failed);
+            }
+        });
+    }
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    stop = true;
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("%d clients, %d server IO loops: %llu connections in %.1f s, %.0f connections/s, %llu failed\n",
+                clients, serverThreads, static_cast<unsigned long long>(completed.load()), elapsed,
+                static_cast<double>(completed.load()) / elapsed, static_cast<unsigned long long>(failed.load()));
+
+    // Footprint: idle connections held open, after churn has warmed up the pools
+    while (live.load() != 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    const long baseline = residentBytes();
+    std::vector<int> idle;
+    for (int i = 0; i < idleConnections; ++i) {
+        if (const int fd = connectTo(port); fd >= 0) idle.push_back(fd);
+    }
+    while (live.load() < static_cast<int>(idle.size())) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    const long growth = residentBytes() - baseline;
+    std::printf("footprint: sizeof(TcpConnection) %zu B, aligned to %zu; %zu idle connections: resident set +%ld KiB, "
+                "%ld B each\n",
+                sizeof(TcpConnection), alignof(TcpConnection), idle.size(), growth >> 10,
+                idle.empty() ? 0 : growth / static_cast<long>(idle.size()));
+    for (const int fd : idle) {
+        ::close(fd);
+    }
+
+    std::promise<void> stopped;
+    loop->runInLoop([&] {
+        server.reset();
+        stopped.set_value();
+    });
+    stopped.get_future().wait();
+    return 0;
+}
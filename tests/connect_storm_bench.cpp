@@ -0,0 +1,246 @@
+// Connect storm against loopback: a client process opens -n connections at
+// once from several threads and holds them, the way a fleet reconnects after
+// a deploy. Reports how long the server takes to accept them all, once
+// accepting one connection per wakeup and once draining up to the default
+// batch, and then with the server's descriptor limit set -f fds above what
+// it already uses: the Acceptor sheds the excess through its reserved idle
+// fd, the clients see a clean close and the server keeps running.
+// Listen queue overflows are counted too: each one drops a SYN and costs
+// that client a retransmit, about a second on loopback.
+// The clients live in a child process forked before any thread starts, so
+// the lowered limit only applies to the server.
+// Usage: connect_storm_bench [-n connections=2000] [-c clientThreads=8]
+//                            [-f fdHeadroom=256]
+#include <arpa/inet.h>
+#include <dirent.h>
+#include <getopt.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <muduo/Acceptor.hpp>
+#include <muduo/EventLoopThread.hpp>
+#include <muduo/Logger.hpp>
+#include <muduo/TcpServer.hpp>
+
+#include "TestUtil.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+template<typename T>
+bool readValue(int fd, T* value) {
+    return ::read(fd, value, sizeof(T)) == static_cast<ssize_t>(sizeof(T));
+}
+
+template<typename T>
+void writeValue(int fd, T value) {
+    if (::write(fd, &value, sizeof(T)) != static_cast<ssize_t>(sizeof(T))) std::exit(1);
+}
+
+// Child process: for every port received on cmdFd, connects all at once and
+// holds the connections until told to let go. Answers with the number that
+// connected, then with the number the server had already closed.
+void stormClient(int cmdFd, int resultFd, int connections, int threads) {
+    for (uint16_t port; readValue(cmdFd, &port) && port != 0;) {
+        std::mutex mutex;
+        std::vector<int> fds;
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; ++t) {
+            const int share = connections / threads + (t < connections % threads ? 1 : 0);
+            workers.emplace_back([&, share] {
+                for (int i = 0; i < share; ++i) {
+                    if (const int fd = connectTo(port); fd >= 0) {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        fds.push_back(fd);
+                    }
+                }
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        writeValue(resultFd, static_cast<uint32_t>(fds.size()));
+
+        char release;
+        if (!readValue(cmdFd, &release)) break;
+        uint32_t closedByServer = 0;
+        for (const int fd : fds) {
+            pollfd p{fd, POLLIN, 0};
+            char byte;
+            if (::poll(&p, 1, 0) == 1 && ::recv(fd, &byte, 1, MSG_DONTWAIT) <= 0) ++closedByServer;
+            ::close(fd);
+        }
+        writeValue(resultFd, closedByServer);
+    }
+}
+
+int openFds() {
+    int count = 0;
+    if (DIR* dir = ::opendir("/proc/self/fd")) {
+        while (::readdir(dir)) ++count;
+        ::closedir(dir);
+    }
+    return count - 2;   // "." and ".."
+}
+
+// TcpExt ListenOverflows from /proc/net/netstat: connections dropped because an accept queue was full
+long listenOverflows() {
+    FILE* f = std::fopen("/proc/net/netstat", "r");
+    if (!f) return 0;
+    std::string names;
+    char line[4096];
+    long value = 0;
+    while (std::fgets(line, sizeof(line), f)) {
+        if (std::strncmp(line, "TcpExt:", 7) != 0) continue;
+        if (names.empty()) {
+            names = line;
+            continue;
+        }
+        // The value line; find the column of ListenOverflows in the name line
+        int column = 0;
+        for (size_t pos = 0; (pos = names.find(' ', pos)) != std::string::npos; ++pos) {
+            ++column;
+            if (names.compare(pos + 1, 16, "ListenOverflows ") == 0) break;
+        }
+        char* cursor = line + 7;
+        for (int i = 0; i < column; ++i) {
+            value = std::strtol(cursor, &cursor, 10);
+        }
+        break;
+    }
+    std::fclose(f);
+    return value;
+}
+
+void run(int cmdFd, int resultFd, int maxAcceptsPerWakeup, int fdHeadroom) {
+    EventLoopThread serverThread;
+    EventLoop* loop = serverThread.startLoop();
+    std::unique_ptr<TcpServer> server;
+    std::atomic<int> accepted{0};
+    uint16_t port = 0;
+    std::promise<void> started;
+    loop->runInLoop([&] {
+        server = std::make_unique<TcpServer>(loop, InetAddress(0), "connect_storm");
+        server->setThreadNum(1);
+        server->setMaxAcceptsPerWakeup(maxAcceptsPerWakeup);
+        server->setConnectionCallback([&accepted](const TcpConnectionPtr& conn) {
+            if (conn->connected()) ++accepted;
+        });
+        server->start();
+        port = server->listenAddress().toPort();
+        started.set_value();
+    });
+    started.get_future().wait();
+
+    rlimit saved{};
+    ::getrlimit(RLIMIT_NOFILE, &saved);
+    if (fdHeadroom > 0) {
+        rlimit lowered = saved;
+        lowered.rlim_cur = static_cast<rlim_t>(openFds() + fdHeadroom);
+        ::setrlimit(RLIMIT_NOFILE, &lowered);
+    }
+
+    const long overflowsBefore = listenOverflows();
+    const Clock::time_point start = Clock::now();
+    writeValue(cmdFd, port);
+    uint32_t connected = 0;
+    readValue(resultFd, &connected);
+    // Every connection the clients got is either accepted or shed by now or soon
+    const Clock::time_point deadline = Clock::now() + std::chrono::seconds(10);
+    while (static_cast<uint64_t>(accepted.load()) + server->rejectedAccepts() < connected &&
+           Clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    const double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    const uint64_t rejected = server->rejectedAccepts();
+    ::setrlimit(RLIMIT_NOFILE, &saved);
+    const long overflows = listenOverflows() - overflowsBefore;
+
+    writeValue(cmdFd, 'r');
+    uint32_t closedByServer = 0;
+    readValue(resultFd, &closedByServer);
+
+    std::promise<void> stopped;
+    loop->runInLoop([&] {
+        server.reset();
+        stopped.set_value();
+    });
+    stopped.get_future().wait();
+
+    char label[48];
+    if (fdHeadroom > 0) {
+        std::snprintf(label, sizeof(label), "%d/wakeup, %d fds", maxAcceptsPerWakeup, fdHeadroom);
+    } else {
+        std::snprintf(label, sizeof(label), "%d/wakeup", maxAcceptsPerWakeup);
+    }
+    std::printf("  %-18s %5u connected in %.3f s (%6.0f/s), %4ld listen overflows: "
+                "accepted %5d, shed %5llu, closed at client %5u\n",
+                label, connected, elapsed, connected / elapsed, overflows, accepted.load(),
+                static_cast<unsigned long long>(rejected), closedByServer);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int connections = 2000;
+    int clientThreads = 8;
+    int fdHeadroom = 256;
+    for (int opt; (opt = ::getopt(argc, argv, "n:c:f:")) != -1;) {
+        switch (opt) {
+        case 'n': connections = std::max(1, std::atoi(optarg)); break;
+        case 'c': clientThreads = std::max(1, std::atoi(optarg)); break;
+        case 'f': fdHeadroom = std::max(1, std::atoi(optarg)); break;
+        default:
+            std::fprintf(stderr, "usage: %s [-n connections] [-c clientThreads] [-f fdHeadroom]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    // Both sides hold every connection at once
+    rlimit limit{};
+    ::getrlimit(RLIMIT_NOFILE, &limit);
+    limit.rlim_cur = limit.rlim_max;
+    ::setrlimit(RLIMIT_NOFILE, &limit);
+
+    int cmd[2];
+    int result[2];
+    if (::pipe(cmd) != 0 || ::pipe(result) != 0) return 1;
+    const pid_t child = ::fork();
+    if (child == 0) {
+        ::close(cmd[1]);
+        ::close(result[0]);
+        stormClient(cmd[0], result[1], connections, clientThreads);
+        std::_Exit(0);
+    }
+    ::close(cmd[0]);
+    ::close(result[1]);
+    // The Acceptor logs every shed connection as an error; thousands of them here
+    Logger::instance().set_level(LogLevel::Fatal);
+
+    std::printf("%d connections from %d client threads\n", connections, clientThreads);
+    run(cmd[1], result[0], 1, 0);
+    run(cmd[1], result[0], Acceptor::kDefaultMaxAcceptsPerWakeup, 0);
+    run(cmd[1], result[0], Acceptor::kDefaultMaxAcceptsPerWakeup, fdHeadroom);
+
+    writeValue(cmd[1], uint16_t{0});
+    ::waitpid(child, nullptr, 0);
+    return 0;
+}
@@ -0,0 +1,144 @@
+// Line echo through one IO loop written twice: as a message callback that
+// splits lines out of the input buffer, and as a coroutine session that
+// co_awaits readUntil("\n") and write(). Reports echoes per second for each.
+// Usage: coroutine_bench [-c connections=16] [-d seconds=2] [-r rounds=3]
+// The two modes alternate for the given number of rounds.
+#include <arpa/inet.h>
+#include <getopt.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <future>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <muduo/Coroutine.hpp>
+#include <muduo/EventLoopThread.hpp>
+#include <muduo/Logger.hpp>
+#include <muduo/TcpServer.hpp>
+
+#include "TestUtil.hpp"
+
+namespace {
+
+constexpr size_t kMessageSize = 16;   // including the trailing '\n'
+
+// One blocking ping-pong client per connection; returns the round trips completed
+uint64_t runEchoClients(uint16_t port, int connections, int seconds) {
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> total{0};
+    std::vector<std::thread> clients;
+    for (int i = 0; i < connections; ++i) {
+        clients.emplace_back([&] {
+            const int fd = connectTo(port);
+            if (fd < 0) return;
+            std::string message(kMessageSize - 1, 'm');
+            message += '\n';
+            char buf[kMessageSize];
+            uint64_t done = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                if (::write(fd, message.data(), message.size()) != static_cast<ssize_t>(message.size())) break;
+                size_t got = 0;
+                while (got < kMessageSize) {
+                    const ssize_t n = ::read(fd, buf, kMessageSize - got);
+                    if (n <= 0) break;
+                    got += static_cast<size_t>(n);
+                }
+                if (got < kMessageSize) break;
+                ++done;
+            }
+            total += done;
+            ::close(fd);
+        });
+    }
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    stop = true;
+    for (auto& client : clients) {
+        client.join();
+    }
+    return total.load();
+}
+
+Task echoSession(TcpConnectionPtr conn) {
+    while (auto line = co_await conn->readUntil("\n")) {
+        if (!co_await conn->write(*line)) break;
+    }
+}
+
+double echoRate(bool coroutine, int connections, int seconds) {
+    EventLoopThread serverThread;
+    EventLoop* loop = serverThread.startLoop();
+    std::unique_ptr<TcpServer> server;
+    uint16_t port = 0;
+    std::promise<void> started;
+    loop->runInLoop([&] {
+        server = std::make_unique<TcpServer>(loop, InetAddress(0), "coroutine_bench");
+        server->setThreadNum(1);
+        if (coroutine) {
+            server->setConnectionCallback([](const TcpConnectionPtr& conn) {
+                if (conn->connected()) echoSession(conn);
+            });
+        } else {
+            server->setMessageCallback([](const TcpConnectionPtr& conn, Buffer* buf, Timestamp) {
+                for (;;) {
+                    const std::string_view input(buf->peek(), buf->readableBytes());
+                    const size_t eol = input.find('\n');
+                    if (eol == std::string_view::npos) break;
+                    conn->send(input.substr(0, eol + 1));
+                    buf->retrieve(eol + 1);
+                }
+            });
+        }
+        server->start();
+        port = server->listenAddress().toPort();
+        started.set_value();
+    });
+    started.get_future().wait();
+
+    const uint64_t echoes = runEchoClients(port, connections, seconds);
+
+    std::promise<void> stopped;
+    loop->runInLoop([&] {
+        server.reset();
+        stopped.set_value();
+    });
+    stopped.get_future().wait();
+    return static_cast<double>(echoes) / seconds;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int connections = 16;
+    int seconds = 2;
+    int rounds = 3;
+    for (int opt; (opt = ::getopt(argc, argv, "c:d:r:")) != -1;) {
+        switch (opt) {
+        case 'c': connections = std::max(1, std::atoi(optarg)); break;
+        case 'd': seconds = std::max(1, std::atoi(optarg)); break;
+        case 'r': rounds = std::max(1, std::atoi(optarg)); break;
+        default:
+            std::fprintf(stderr, "usage: %s [-c connections] [-d seconds] [-r rounds]\n", argv[0]);
+            return 2;
+        }
+    }
+    Logger::instance().set_level(LogLevel::Error);
+
+    std::printf("%d connections, %zu-byte line echo, one IO loop, %d s per run\n",
+                connections, kMessageSize, seconds);
+    for (int round = 1; round <= rounds; ++round) {
+        const double callback = echoRate(false, connections, seconds);
+        const double coroutine = echoRate(true, connections, seconds);
+        std::printf("  round %d: callback %9.0f echoes/s, coroutine %9.0f echoes/s\n", round, callback, coroutine);
+    }
+    return 0;
+}
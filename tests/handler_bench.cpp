@@ -0,0 +1,174 @@
+// Per-message cost of the type-erased CallbackHandler against a static
+// Handler: first the bare dispatch in a tight loop, then echo round trips
+// over loopback through a TcpServer and a BasicTcpServer<EchoHandler>.
+// Usage: handler_bench [-c connections=16] [-d seconds=2] [-n calls=50000000]
+#include <arpa/inet.h>
+#include <getopt.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <muduo/EventLoopThread.hpp>
+#include <muduo/Logger.hpp>
+#include <muduo/TcpServer.hpp>
+
+#include "TestUtil.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr size_t kMessageSize = 16;
+
+struct EchoHandler {
+    void onConnection(const auto&) {}
+    void onMessage(const auto& conn, Buffer* buf, Timestamp) {
+        conn->send(std::string_view(buf->peek(), buf->readableBytes()));
+        buf->retrieveAll();
+    }
+};
+
+// What the tight loop dispatches to: counts bytes, keeps the call observable
+struct CountingHandler {
+    void onMessage(const auto&, Buffer* buf, Timestamp) { bytes += buf->readableBytes(); }
+    uint64_t bytes = 0;
+};
+
+template<typename Dispatch>
+double nsPerCall(uint64_t calls, Dispatch&& dispatch) {
+    const Clock::time_point start = Clock::now();
+    for (uint64_t i = 0; i < calls; ++i) {
+        dispatch();
+    }
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / static_cast<double>(calls);
+}
+
+// One blocking ping-pong client per connection; returns the round trips completed
+uint64_t runEchoClients(uint16_t port, int connections, int seconds) {
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> total{0};
+    std::vector<std::thread> clients;
+    for (int i = 0; i < connections; ++i) {
+        clients.emplace_back([&] {
+            const int fd = connectTo(port);
+            if (fd < 0) return;
+            const std::string message(kMessageSize, 'm');
+            char buf[kMessageSize];
+            uint64_t done = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                if (::write(fd, message.data(), message.size()) != static_cast<ssize_t>(message.size())) break;
+                size_t got = 0;
+                while (got < kMessageSize) {
+                    const ssize_t n = ::read(fd, buf, kMessageSize - got);
+                    if (n <= 0) break;
+                    got += static_cast<size_t>(n);
+                }
+                if (got < kMessageSize) break;
+                ++done;
+            }
+            total += done;
+            ::close(fd);
+        });
+    }
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    stop = true;
+    for (auto& client : clients) {
+        client.join();
+    }
+    return total.load();
+}
+
+// Runs Server on its own loop thread with one IO loop and reports echoes per second
+template<typename Server, typename Setup>
+double echoRate(const char* label, int connections, int seconds, Setup&& setup) {
+    EventLoopThread serverThread;
+    EventLoop* loop = serverThread.startLoop();
+    std::unique_ptr<Server> server;
+    uint16_t port = 0;
+    std::promise<void> started;
+    loop->runInLoop([&] {
+        server = std::make_unique<Server>(loop, InetAddress(0), label);
+        server->setThreadNum(1);
+        setup(*server);
+        server->start();
+        port = server->listenAddress().toPort();
+        started.set_value();
+    });
+    started.get_future().wait();
+
+    const uint64_t echoes = runEchoClients(port, connections, seconds);
+
+    std::promise<void> stopped;
+    loop->runInLoop([&] {
+        server.reset();
+        stopped.set_value();
+    });
+    stopped.get_future().wait();
+
+    const double rate = static_cast<double>(echoes) / seconds;
+    std::printf("  %-28s %10.0f echoes/s\n", label, rate);
+    return rate;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int connections = 16;
+    int seconds = 2;
+    uint64_t calls = 50'000'000;
+    for (int opt; (opt = ::getopt(argc, argv, "c:d:n:")) != -1;) {
+        switch (opt) {
+        case 'c': connections = std::max(1, std::atoi(optarg)); break;
+        case 'd': seconds = std::max(1, std::atoi(optarg)); break;
+        case 'n': calls = std::max<uint64_t>(1, std::strtoull(optarg, nullptr, 10)); break;
+        default:
+            std::fprintf(stderr, "usage: %s [-c connections] [-d seconds] [-n calls]\n", argv[0]);
+            return 2;
+        }
+    }
+    Logger::instance().set_level(LogLevel::Error);
+
+    // Bare dispatch: the same message handed to each handler kind
+    Buffer buf;
+    const std::string message(kMessageSize, 'm');
+    buf.append(message.data(), message.size());
+    const TcpConnectionPtr noConnection;
+    const Timestamp now = Timestamp::now();
+
+    CountingHandler counting;
+    CallbackHandler erased;
+    erased.messageCallback = [&counting](const TcpConnectionPtr& conn, Buffer* b, Timestamp t) {
+        counting.onMessage(conn, b, t);
+    };
+    CallbackHandler* volatile erasedRef = &erased;   // keep the std::function call opaque
+    const double erasedNs = nsPerCall(calls, [&] { erasedRef->onMessage(noConnection, &buf, now); });
+    CountingHandler direct;
+    const double directNs = nsPerCall(calls, [&] { direct.onMessage(noConnection, &buf, now); });
+    std::printf("dispatch, %llu calls (%llu/%llu bytes seen)\n", static_cast<unsigned long long>(calls),
+                static_cast<unsigned long long>(counting.bytes), static_cast<unsigned long long>(direct.bytes));
+    std::printf("  %-28s %10.2f ns/message\n", "CallbackHandler", erasedNs);
+    std::printf("  %-28s %10.2f ns/message\n", "static handler", directNs);
+
+    // Loopback echo, 16-byte messages, one IO loop
+    std::printf("echo, %d connections, %d s each, %zu-byte messages\n", connections, seconds, kMessageSize);
+    echoRate<TcpServer>("TcpServer (std::function)", connections, seconds, [](TcpServer& server) {
+        server.setMessageCallback([](const TcpConnectionPtr& conn, Buffer* b, Timestamp) {
+            conn->send(std::string_view(b->peek(), b->readableBytes()));
+            b->retrieveAll();
+        });
+    });
+    echoRate<BasicTcpServer<EchoHandler>>("BasicTcpServer<EchoHandler>", connections, seconds,
+                                          [](BasicTcpServer<EchoHandler>&) {});
+    return 0;
+}
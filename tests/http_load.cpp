@@ -0,0 +1,235 @@
+// wrk-style HTTP/1.1 load generator: keeps a fixed number of keep-alive
+// connections busy for a fixed time, pipelining requests on each, and
+// reports throughput and latency percentiles.
+// Usage: http_load [-c connections=64] [-d seconds=5] [-p depth=1]
+//                  [-t serverThreads=4] [ip:port[/path]]
+// Without a target it starts an HttpServer answering "hello" on
+// 127.0.0.1:9110 with serverThreads IO loops and loads that.
+// Latency is measured per pipelined batch, from its write to its last
+// response. Exits non-zero if a connection fails or a response is malformed.
+#include <arpa/inet.h>
+#include <getopt.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <future>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <muduo/EventLoopThread.hpp>
+#include <muduo/HttpServer.hpp>
+#include <muduo/Logger.hpp>
+
+#include "TestUtil.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Target {
+    std::string ip = "127.0.0.1";
+    uint16_t port = 9110;
+    std::string path = "/";
+};
+
+bool parseTarget(std::string_view text, Target* target) {
+    const size_t colon = text.find(':');
+    if (colon == std::string_view::npos) return false;
+    const size_t slash = text.find('/', colon);
+    target->ip = std::string(text.substr(0, colon));
+    target->port = static_cast<uint16_t>(std::atoi(std::string(text.substr(colon + 1, slash - colon - 1)).c_str()));
+    target->path = slash == std::string_view::npos ? "/" : std::string(text.substr(slash));
+    return target->port != 0;
+}
+
+// Counts complete responses in a byte stream; bodies must carry Content-Length
+class ResponseCounter {
+public:
+    // Returns the number of responses completed by data, or -1 on a malformed one
+    int feed(const char* data, size_t len) {
+        pending_.append(data, len);
+        int completed = 0;
+        size_t pos = 0;
+        for (;;) {
+            const size_t headerEnd = pending_.find("\r\n\r\n", pos);
+            if (headerEnd == std::string::npos) break;
+            const std::string_view head(pending_.data() + pos, headerEnd - pos);
+            if (head.substr(0, 5) != "HTTP/") return -1;
+            const size_t total = headerEnd + 4 - pos + contentLength(head);
+            if (pending_.size() - pos < total) break;
+            pos += total;
+            ++completed;
+        }
+        pending_.erase(0, pos);
+        return completed;
+    }
+
+private:
+    static size_t contentLength(std::string_view head) {
+        constexpr std::string_view kName = "content-length:";
+        for (size_t line = head.find("\r\n"); line != std::string_view::npos; line = head.find("\r\n", line + 2)) {
+            const std::string_view rest = head.substr(line + 2);
+            if (rest.size() < kName.size()) continue;
+            bool match = true;
+            for (size_t i = 0; i < kName.size() && match; ++i) {
+                const char c = rest[i];
+                match = (c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c) == kName[i];
+            }
+            if (match) return std::strtoull(rest.data() + kName.size(), nullptr, 10);
+        }
+        return 0;
+    }
+
+    std::string pending_;
+};
+
+struct Result {
+    uint64_t requests = 0;
+    uint64_t bytes = 0;
+    std::vector<uint32_t> latenciesUs;
+    bool failed = false;
+};
+
+void runConnection(const Target& target, int depth, const std::atomic<bool>& stop, Result* result) {
+    const int fd = connectTo(target.ip, target.port);
+    if (fd < 0) {
+        result->failed = true;
+        return;
+    }
+    std::string batch;
+    for (int i = 0; i < depth; ++i) {
+        batch += "GET " + target.path + " HTTP/1.1\r\nHost: " + target.ip + "\r\n\r\n";
+    }
+
+    ResponseCounter counter;
+    char buf[64 * 1024];
+    while (!stop.load(std::memory_order_relaxed)) {
+        const Clock::time_point start = Clock::now();
+        for (size_t off = 0; off < batch.size();) {
+            const ssize_t w = ::write(fd, batch.data() + off, batch.size() - off);
+            if (w <= 0) {
+                result->failed = true;
+                ::close(fd);
+                return;
+            }
+            off += static_cast<size_t>(w);
+        }
+        for (int got = 0; got < depth;) {
+            const ssize_t n = ::read(fd, buf, sizeof(buf));
+            const int completed = n > 0 ? counter.feed(buf, static_cast<size_t>(n)) : -1;
+            if (completed < 0) {
+                result->failed = true;
+                ::close(fd);
+                return;
+            }
+            result->bytes += static_cast<uint64_t>(n);
+            got += completed;
+        }
+        result->requests += static_cast<uint64_t>(depth);
+        result->latenciesUs.push_back(static_cast<uint32_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count()));
+    }
+    ::close(fd);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int connections = 64;
+    int seconds = 5;
+    int depth = 1;
+    size_t serverThreads = 4;
+    for (int opt; (opt = ::getopt(argc, argv, "c:d:p:t:")) != -1;) {
+        switch (opt) {
+        case 'c': connections = std::max(1, std::atoi(optarg)); break;
+        case 'd': seconds = std::max(1, std::atoi(optarg)); break;
+        case 'p': depth = std::max(1, std::atoi(optarg)); break;
+        case 't': serverThreads = static_cast<size_t>(std::max(0, std::atoi(optarg))); break;
+        default:
+            std::fprintf(stderr, "usage: %s [-c connections] [-d seconds] [-p depth] [-t serverThreads] [ip:port[/path]]\n",
+                         argv[0]);
+            return 2;
+        }
+    }
+    Logger::instance().set_level(LogLevel::Error);
+
+    Target target;
+    if (optind < argc && !parseTarget(argv[optind], &target)) {
+        std::fprintf(stderr, "bad target '%s', expected ip:port[/path]\n", argv[optind]);
+        return 2;
+    }
+
+    // The built-in server, when no target was given
+    std::unique_ptr<EventLoopThread> serverThread;
+    std::unique_ptr<HttpServer> server;
+    EventLoop* serverLoop = nullptr;
+    if (optind >= argc) {
+        serverThread = std::make_unique<EventLoopThread>();
+        serverLoop = serverThread->startLoop();
+        std::promise<void> started;
+        serverLoop->runInLoop([&] {
+            server = std::make_unique<HttpServer>(serverLoop, InetAddress(target.port, target.ip), "http_load");
+            server->setThreadNum(serverThreads);
+            server->setHttpCallback([](const HttpRequest&, HttpResponse* resp) {
+                resp->setContentType("text/plain");
+                resp->setBody("hello");
+            });
+            server->start();
+            started.set_value();
+        });
+        started.get_future().wait();
+    }
+
+    std::atomic<bool> stop{false};
+    std::vector<Result> results(static_cast<size_t>(connections));
+    std::vector<std::thread> clients;
+    const Clock::time_point start = Clock::now();
+    for (auto& result : results) {
+        clients.emplace_back(runConnection, std::cref(target), depth, std::cref(stop), &result);
+    }
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    stop = true;
+    for (auto& client : clients) {
+        client.join();
+    }
+    const double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    if (serverLoop) {
+        std::promise<void> stopped;
+        serverLoop->runInLoop([&] {
+            server.reset();
+            stopped.set_value();
+        });
+        stopped.get_future().wait();
+    }
+
+    Result total;
+    for (auto& result : results) {
+        total.requests += result.requests;
+        total.bytes += result.bytes;
+        total.failed |= result.failed;
+        total.latenciesUs.insert(total.latenciesUs.end(), result.latenciesUs.begin(), result.latenciesUs.end());
+    }
+    std::sort(total.latenciesUs.begin(), total.latenciesUs.end());
+
+    std::printf("%d connections, pipeline depth %d, %.2f s against %s:%u%s\n",
+                connections, depth, elapsed, target.ip.c_str(), target.port, target.path.c_str());
+    std::printf("  %llu requests, %.0f req/s, %.2f MB/s\n", static_cast<unsigned long long>(total.requests),
+                static_cast<double>(total.requests) / elapsed, static_cast<double>(total.bytes) / elapsed / 1e6);
+    std::printf("  latency ms: p50 %.3f  p90 %.3f  p99 %.3f  max %.3f\n", percentile(total.latenciesUs, 0.50) / 1000.0,
+                percentile(total.latenciesUs, 0.90) / 1000.0, percentile(total.latenciesUs, 0.99) / 1000.0,
+                percentile(total.latenciesUs, 1.0) / 1000.0);
+    if (total.failed) {
+        std::printf("  some connections failed or received a malformed response\n");
+    }
+    return total.failed ? 1 : 0;
+}
@@ -0,0 +1,228 @@
+// Echo over loopback TCP, AF_UNIX and shared memory, same process, server
+// and client each on their own loop thread. Latency: one message of -s
+// bytes in flight, round trips timed. Throughput: -w messages of -b bytes
+// kept in flight. Both sides are the library's own (TcpServer / TcpClient,
+// or a pair of ShmConnections), so the numbers differ only by transport.
+// Usage: ipc_bench [-s size=64] [-b bulkSize=16384] [-w window=16]
+//                  [-d seconds=2]
+#include <getopt.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <muduo/EventLoopThread.hpp>
+#include <muduo/Logger.hpp>
+#include <muduo/ShmConnection.hpp>
+#include <muduo/TcpClient.hpp>
+#include <muduo/TcpServer.hpp>
+
+#include "TestUtil.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Keeps window messages of one size in flight and times each round trip;
+// lives on the client loop
+class EchoDriver {
+public:
+    EchoDriver(size_t size, int window) : payload_(size, 'p'), window_(window) {}
+
+    template<typename Conn>
+    void start(const Conn& conn) {
+        for (int i = 0; i < window_; ++i) sendOne(conn);
+    }
+
+    template<typename Conn>
+    void onMessage(const Conn& conn, Buffer* buf) {
+        partial_ += buf->readableBytes();
+        buf->retrieveAll();
+        for (; partial_ >= payload_.size() && !sentAt_.empty(); partial_ -= payload_.size()) {
+            latencies_.push_back(static_cast<uint32_t>(
+                std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - sentAt_.front()).count()));
+            sentAt_.pop_front();
+            if (!stopping_) sendOne(conn);
+        }
+    }
+
+    // Round trips so far; later replies are not timed
+    std::vector<uint32_t> stop() noexcept {
+        stopping_ = true;
+        return std::move(latencies_);
+    }
+
+private:
+    template<typename Conn>
+    void sendOne(const Conn& conn) {
+        sentAt_.push_back(Clock::now());
+        conn->send(payload_);
+    }
+
+    const std::string payload_;
+    const int window_;
+    size_t partial_{0};
+    std::deque<Clock::time_point> sentAt_;
+    std::vector<uint32_t> latencies_;
+    bool stopping_{false};
+};
+
+void report(const char* transport, const char* mode, size_t size, std::vector<uint32_t>& latencies, double elapsed) {
+    std::sort(latencies.begin(), latencies.end());
+    const double rate = static_cast<double>(latencies.size()) / elapsed;
+    std::printf("  %-9s %-10s %8.0f msgs/s %8.1f MiB/s, round trip us: p50 %6.0f  p99 %6.0f\n",
+                transport, mode, rate, rate * static_cast<double>(size) / (1 << 20),
+                percentile(latencies, 0.50), percentile(latencies, 0.99));
+}
+
+// Runs the driver over a TcpClient against an echo TcpServer listening on listenAddr
+void runSocket(const char* transport, const InetAddress& listenAddr, size_t size, int window, int seconds) {
+    EventLoopThread serverThread;
+    EventLoop* serverLoop = serverThread.startLoop();
+    std::unique_ptr<TcpServer> server;
+    InetAddress serverAddr;
+    std::promise<void> started;
+    serverLoop->runInLoop([&] {
+        server = std::make_unique<TcpServer>(serverLoop, listenAddr, "ipc_bench");
+        server->setMessageCallback([](const TcpConnectionPtr& conn, Buffer* buf, Timestamp) {
+            conn->send(std::string_view(buf->peek(), buf->readableBytes()));
+            buf->retrieveAll();
+        });
+        server->start();
+        serverAddr = server->listenAddress();
+        started.set_value();
+    });
+    started.get_future().wait();
+
+    EventLoopThread clientThread;
+    EventLoop* clientLoop = clientThread.startLoop();
+    EchoDriver driver(size, window);
+    Clock::time_point start;
+    {
+        TcpClient client(clientLoop, serverAddr, "ipc_bench");
+        client.setConnectionCallback([&](const TcpConnectionPtr& conn) {
+            if (conn->connected()) {
+                start = Clock::now();
+                driver.start(conn);
+            }
+        });
+        client.setMessageCallback([&driver](const TcpConnectionPtr& conn, Buffer* buf, Timestamp) {
+            driver.onMessage(conn, buf);
+        });
+        client.connect();
+        std::this_thread::sleep_for(std::chrono::seconds(seconds));
+
+        std::vector<uint32_t> latencies;
+        std::promise<double> stopped;
+        clientLoop->runInLoop([&] {
+            latencies = driver.stop();
+            stopped.set_value(std::chrono::duration<double>(Clock::now() - start).count());
+        });
+        const double elapsed = stopped.get_future().get();
+        report(transport, window == 1 ? "latency" : "throughput", size, latencies, elapsed);
+    }
+
+    std::promise<void> stopped;
+    serverLoop->runInLoop([&] {
+        server.reset();
+        stopped.set_value();
+    });
+    stopped.get_future().wait();
+}
+
+// The same driver over a pair of ShmConnections: one ring per direction, eventfd doorbells
+void runShm(size_t size, int window, int seconds) {
+    using ShmConnectionPtr = ShmConnection::ShmConnectionPtr;
+    EventLoopThread serverThread;
+    EventLoop* serverLoop = serverThread.startLoop();
+    EventLoopThread clientThread;
+    EventLoop* clientLoop = clientThread.startLoop();
+    auto endpoints = ShmEndpoint::createPair();
+
+    ShmConnectionPtr server;
+    std::promise<void> started;
+    serverLoop->runInLoop([&] {
+        server = std::make_shared<ShmConnection>(serverLoop, "ipc_bench-server", std::move(endpoints.first));
+        server->setMessageCallback([](const ShmConnectionPtr& conn, Buffer* buf, Timestamp) {
+            conn->send(std::string_view(buf->peek(), buf->readableBytes()));
+            buf->retrieveAll();
+        });
+        server->connectEstablished();
+        started.set_value();
+    });
+    started.get_future().wait();
+
+    EchoDriver driver(size, window);
+    ShmConnectionPtr client;
+    Clock::time_point start;
+    clientLoop->runInLoop([&] {
+        client = std::make_shared<ShmConnection>(clientLoop, "ipc_bench-client", std::move(endpoints.second));
+        client->setConnectionCallback([&](const ShmConnectionPtr& conn) {
+            start = Clock::now();
+            driver.start(conn);
+        });
+        client->setMessageCallback([&driver](const ShmConnectionPtr& conn, Buffer* buf, Timestamp) {
+            driver.onMessage(conn, buf);
+        });
+        client->connectEstablished();
+    });
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+
+    std::vector<uint32_t> latencies;
+    std::promise<double> stopped;
+    clientLoop->runInLoop([&] {
+        latencies = driver.stop();
+        stopped.set_value(std::chrono::duration<double>(Clock::now() - start).count());
+        client.reset();
+    });
+    const double elapsed = stopped.get_future().get();
+    report("shm", window == 1 ? "latency" : "throughput", size, latencies, elapsed);
+
+    std::promise<void> serverStopped;
+    serverLoop->runInLoop([&] {
+        server.reset();
+        serverStopped.set_value();
+    });
+    serverStopped.get_future().wait();
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t size = 64;
+    size_t bulkSize = 16384;
+    int window = 16;
+    int seconds = 2;
+    for (int opt; (opt = ::getopt(argc, argv, "s:b:w:d:")) != -1;) {
+        switch (opt) {
+        case 's': size = std::max<size_t>(1, std::strtoull(optarg, nullptr, 10)); break;
+        case 'b': bulkSize = std::max<size_t>(1, std::strtoull(optarg, nullptr, 10)); break;
+        case 'w': window = std::max(1, std::atoi(optarg)); break;
+        case 'd': seconds = std::max(1, std::atoi(optarg)); break;
+        default:
+            std::fprintf(stderr, "usage: %s [-s size] [-b bulkSize] [-w window] [-d seconds]\n", argv[0]);
+            return 2;
+        }
+    }
+    Logger::instance().set_level(LogLevel::Error);
+
+    const InetAddress tcp(0);
+    const InetAddress unixAddr = InetAddress::fromUnixPath("@ipc_bench-" + std::to_string(::getpid()));
+    std::printf("latency: %zu-byte messages one at a time; throughput: %zu-byte messages, %d in flight; %d s per run\n",
+                size, bulkSize, window, seconds);
+    runSocket("tcp", tcp, size, 1, seconds);
+    runSocket("unix", unixAddr, size, 1, seconds);
+    runShm(size, 1, seconds);
+    runSocket("tcp", tcp, bulkSize, window, seconds);
+    runSocket("unix", unixAddr, bulkSize, window, seconds);
+    runShm(bulkSize, window, seconds);
+    return 0;
+}
@@ -0,0 +1,239 @@
+// redis-benchmark-style load generator for KvServer (or any RESP server):
+// runs each command test in turn with a fixed number of connections
+// sharing a fixed number of requests, pipelining on each, and reports
+// throughput and latency percentiles per test.
+// Usage: kv_load [-c connections=50] [-n requests=100000] [-P depth=1]
+//                [-d valueBytes=3] [-r keyspace=10000] [-T serverThreads=4]
+//                [-t PING,SET,GET,INCR] [ip:port]
+// Without a target it starts a KvServer on 127.0.0.1:9120 with
+// serverThreads IO loops and loads that.
+// Latency is measured per pipelined batch, from its write to its last
+// reply. Exits non-zero if a connection fails or a reply is an error.
+#include <arpa/inet.h>
+#include <getopt.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <future>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <muduo/EventLoopThread.hpp>
+#include <muduo/KvServer.hpp>
+#include <muduo/Logger.hpp>
+#include <muduo/RespCodec.hpp>
+
+#include "TestUtil.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    std::string ip = "127.0.0.1";
+    uint16_t port = 9120;
+    int connections = 50;
+    long requests = 100000;
+    int depth = 1;
+    size_t valueBytes = 3;
+    long keyspace = 10000;
+};
+
+void appendCommand(std::string& out, std::initializer_list<std::string_view> args) {
+    out += '*' + std::to_string(args.size()) + "\r\n";
+    for (const std::string_view arg : args) {
+        out += '$' + std::to_string(arg.size()) + "\r\n";
+        out += arg;
+        out += "\r\n";
+    }
+}
+
+// One request of the named test against key:<n>
+void appendRequest(std::string& out, std::string_view test, long n, const std::string& value) {
+    const std::string key = "key:" + std::to_string(n);
+    if (test == "PING") {
+        appendCommand(out, {"PING"});
+    } else if (test == "SET") {
+        appendCommand(out, {"SET", key, value});
+    } else if (test == "GET") {
+        appendCommand(out, {"GET", key});
+    } else {
+        appendCommand(out, {"INCR", "counter:" + std::to_string(n)});
+    }
+}
+
+struct Result {
+    long requests = 0;
+    std::vector<uint32_t> latenciesUs;
+    bool failed = false;
+};
+
+// Sends quota requests of test in batches of depth and reads every reply
+void runConnection(const Options& options, std::string test, long quota, unsigned seed, Result* result) {
+    const int fd = connectTo(options.ip, options.port);
+    if (fd < 0) {
+        result->failed = true;
+        return;
+    }
+    const std::string value(options.valueBytes, 'x');
+    std::string batch;
+    std::string input;
+    char buf[64 * 1024];
+    while (result->requests < quota) {
+        const int count = static_cast<int>(std::min<long>(options.depth, quota - result->requests));
+        batch.clear();
+        for (int i = 0; i < count; ++i) {
+            seed = seed * 1103515245 + 12345;
+            appendRequest(batch, test, static_cast<long>(seed >> 8) % options.keyspace, value);
+        }
+
+        const Clock::time_point start = Clock::now();
+        for (size_t off = 0; off < batch.size();) {
+            const ssize_t w = ::write(fd, batch.data() + off, batch.size() - off);
+            if (w <= 0) {
+                result->failed = true;
+                ::close(fd);
+                return;
+            }
+            off += static_cast<size_t>(w);
+        }
+        size_t off = 0;
+        for (int got = 0; got < count;) {
+            const ptrdiff_t length = RespCodec::valueLength(input.data() + off, input.size() - off);
+            if (length > 0) {
+                result->failed |= input[off] == '-';
+                off += static_cast<size_t>(length);
+                ++got;
+                continue;
+            }
+            const ssize_t n = length == 0 ? ::read(fd, buf, sizeof(buf)) : -1;
+            if (n <= 0) {
+                result->failed = true;
+                ::close(fd);
+                return;
+            }
+            input.append(buf, static_cast<size_t>(n));
+        }
+        input.erase(0, off);
+        result->requests += count;
+        result->latenciesUs.push_back(static_cast<uint32_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count()));
+    }
+    ::close(fd);
+}
+
+// Runs one test and prints its line; false if any connection failed
+bool runTest(const Options& options, const std::string& test) {
+    std::vector<Result> results(static_cast<size_t>(options.connections));
+    std::vector<std::thread> clients;
+    const Clock::time_point start = Clock::now();
+    for (int i = 0; i < options.connections; ++i) {
+        const long quota = options.requests / options.connections + (i < options.requests % options.connections);
+        clients.emplace_back(runConnection, std::cref(options), test, quota, static_cast<unsigned>(i + 1),
+                             &results[static_cast<size_t>(i)]);
+    }
+    for (auto& client : clients) {
+        client.join();
+    }
+    const double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    Result total;
+    for (auto& result : results) {
+        total.requests += result.requests;
+        total.failed |= result.failed;
+        total.latenciesUs.insert(total.latenciesUs.end(), result.latenciesUs.begin(), result.latenciesUs.end());
+    }
+    std::sort(total.latenciesUs.begin(), total.latenciesUs.end());
+    std::printf("%-5s %ld requests in %.2f s, %.0f req/s, latency ms p50 %.3f p99 %.3f max %.3f%s\n",
+                test.c_str(), total.requests, elapsed, static_cast<double>(total.requests) / elapsed,
+                percentile(total.latenciesUs, 0.50) / 1000.0, percentile(total.latenciesUs, 0.99) / 1000.0,
+                percentile(total.latenciesUs, 1.0) / 1000.0, total.failed ? "  (errors)" : "");
+    return !total.failed;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    size_t serverThreads = 4;
+    std::string tests = "PING,SET,GET,INCR";
+    for (int opt; (opt = ::getopt(argc, argv, "c:n:P:d:r:T:t:")) != -1;) {
+        switch (opt) {
+        case 'c': options.connections = std::max(1, std::atoi(optarg)); break;
+        case 'n': options.requests = std::max(1L, std::atol(optarg)); break;
+        case 'P': options.depth = std::max(1, std::atoi(optarg)); break;
+        case 'd': options.valueBytes = static_cast<size_t>(std::max(0, std::atoi(optarg))); break;
+        case 'r': options.keyspace = std::max(1L, std::atol(optarg)); break;
+        case 'T': serverThreads = static_cast<size_t>(std::max(0, std::atoi(optarg))); break;
+        case 't': tests = optarg; break;
+        default:
+            std::fprintf(stderr, "usage: %s [-c connections] [-n requests] [-P depth] [-d valueBytes] "
+                                 "[-r keyspace] [-T serverThreads] [-t PING,SET,GET,INCR] [ip:port]\n", argv[0]);
+            return 2;
+        }
+    }
+    Logger::instance().set_level(LogLevel::Error);
+
+    if (optind < argc) {
+        const std::string_view target(argv[optind]);
+        const size_t colon = target.find(':');
+        options.ip = std::string(target.substr(0, colon));
+        options.port = colon == std::string_view::npos
+                           ? 0 : static_cast<uint16_t>(std::atoi(argv[optind] + colon + 1));
+        if (options.port == 0) {
+            std::fprintf(stderr, "bad target '%s', expected ip:port\n", argv[optind]);
+            return 2;
+        }
+    }
+
+    // The built-in server, when no target was given
+    std::unique_ptr<EventLoopThread> serverThread;
+    std::unique_ptr<KvServer> server;
+    EventLoop* serverLoop = nullptr;
+    if (optind >= argc) {
+        serverThread = std::make_unique<EventLoopThread>();
+        serverLoop = serverThread->startLoop();
+        std::promise<void> started;
+        serverLoop->runInLoop([&] {
+            server = std::make_unique<KvServer>(serverLoop, InetAddress(options.port, options.ip), "kv_load");
+            server->setThreadNum(serverThreads);
+            server->start();
+            started.set_value();
+        });
+        started.get_future().wait();
+    }
+
+    std::printf("%d connections, pipeline depth %d, %zu byte values, %ld keys, against %s:%u\n",
+                options.connections, options.depth, options.valueBytes, options.keyspace,
+                options.ip.c_str(), options.port);
+    bool ok = true;
+    for (size_t begin = 0; begin < tests.size();) {
+        const size_t end = std::min(tests.find(',', begin), tests.size());
+        const std::string test = tests.substr(begin, end - begin);
+        begin = end + 1;
+        if (test != "PING" && test != "SET" && test != "GET" && test != "INCR") {
+            std::fprintf(stderr, "unknown test '%s'\n", test.c_str());
+            ok = false;
+            continue;
+        }
+        ok &= runTest(options, test);
+    }
+
+    if (serverLoop) {
+        std::promise<void> stopped;
+        serverLoop->runInLoop([&] {
+            server.reset();
+            stopped.set_value();
+        });
+        stopped.get_future().wait();
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,167 @@
+// Messages per second from one EventLoop to another, each pinned to its own
+// CPU (to the same one on a single-CPU machine): once through a
+// LoopChannel<uint64_t>, once as a queueInLoop() functor per message. The
+// producer pushes -b messages per loop iteration and keeps at most -q
+// unconsumed; when that window is full it waits to be called back by the
+// consumer (the channel's writable callback, or a functor the consumer
+// queues back), so neither side spins.
+// Usage: loop_channel_bench [-q capacity=1024] [-b batch=64] [-d seconds=2]
+#include <getopt.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <future>
+#include <memory>
+#include <thread>
+
+#include <muduo/EventLoopThread.hpp>
+#include <muduo/Logger.hpp>
+#include <muduo/LoopChannel.hpp>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+void pinTo(EventLoop* loop, int cpu) {
+    std::promise<void> done;
+    loop->runInLoop([&] {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        ::pthread_setaffinity_np(::pthread_self(), sizeof(set), &set);
+        done.set_value();
+    });
+    done.get_future().wait();
+}
+
+// Runs f on loop and waits for it
+void sync(EventLoop* loop, const std::function<void()>& f) {
+    std::promise<void> done;
+    loop->runInLoop([&] {
+        f();
+        done.set_value();
+    });
+    done.get_future().wait();
+}
+
+struct Counters {
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> sent{0};       // producer writes
+    std::atomic<uint64_t> consumed{0};   // consumer writes
+    std::atomic<bool> producerWaiting{false};
+    uint64_t sum{0};                     // consumer only; keeps the handler from being optimised out
+};
+
+void run(bool channel, size_t capacity, int batch, int seconds) {
+    Counters counters;
+    std::function<void()> pump;
+
+    EventLoopThread producerThread;
+    EventLoopThread consumerThread;
+    EventLoop* producer = producerThread.startLoop();
+    EventLoop* consumer = consumerThread.startLoop();
+    const long cpus = std::max(1L, ::sysconf(_SC_NPROCESSORS_ONLN));
+    pinTo(producer, 0);
+    pinTo(consumer, static_cast<int>(1 % cpus));
+
+    auto consume = [&counters](uint64_t value) {
+        counters.sum += value;
+        counters.consumed.store(counters.consumed.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    };
+
+    std::unique_ptr<LoopChannel<uint64_t>> ring;
+    if (channel) {
+        ring = std::make_unique<LoopChannel<uint64_t>>(producer, consumer, capacity,
+                                                       [&consume](uint64_t& value) { consume(value); });
+        ring->setWritableCallback([&pump] { pump(); });
+        pump = [&] {
+            if (counters.stop.load(std::memory_order_relaxed)) return;
+            uint64_t sent = counters.sent.load(std::memory_order_relaxed);
+            for (int i = 0; i < batch; ++i, ++sent) {
+                uint64_t value = sent;
+                if (!ring->tryPush(value)) {
+                    counters.sent.store(sent, std::memory_order_relaxed);
+                    return;   // the writable callback picks up from here
+                }
+            }
+            counters.sent.store(sent, std::memory_order_relaxed);
+            producer->queueInLoop(pump);
+        };
+    } else {
+        // A functor per message; the consumer calls the producer back once half the window is free
+        pump = [&] {
+            if (counters.stop.load(std::memory_order_relaxed)) return;
+            uint64_t sent = counters.sent.load(std::memory_order_relaxed);
+            for (int i = 0; i < batch; ++i, ++sent) {
+                if (sent - counters.consumed.load(std::memory_order_acquire) >= capacity) {
+                    counters.sent.store(sent, std::memory_order_release);
+                    counters.producerWaiting.store(true, std::memory_order_seq_cst);
+                    // The consumer may have caught up before it could see the flag
+                    if (sent - counters.consumed.load(std::memory_order_seq_cst) >= capacity ||
+                        !counters.producerWaiting.exchange(false)) {
+                        return;
+                    }
+                }
+                consumer->queueInLoop([&, sent] {
+                    consume(sent);
+                    if (counters.producerWaiting.load(std::memory_order_seq_cst) &&
+                        counters.sent.load(std::memory_order_acquire) -
+                                counters.consumed.load(std::memory_order_relaxed) <= capacity / 2 &&
+                        counters.producerWaiting.exchange(false)) {
+                        producer->queueInLoop(pump);
+                    }
+                });
+            }
+            counters.sent.store(sent, std::memory_order_release);
+            producer->queueInLoop(pump);
+        };
+    }
+
+    const Clock::time_point start = Clock::now();
+    producer->runInLoop(pump);
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    const uint64_t consumed = counters.consumed.load();
+    const double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    // Let both loops settle before the channel and the state they use go away
+    counters.stop = true;
+    sync(producer, [] {});
+    sync(consumer, [] {});
+    sync(producer, [] {});
+    ring.reset();
+
+    std::printf("  %-12s %10.0f msgs/s\n", channel ? "LoopChannel" : "queueInLoop",
+                static_cast<double>(consumed) / elapsed);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t capacity = 1024;
+    int batch = 64;
+    int seconds = 2;
+    for (int opt; (opt = ::getopt(argc, argv, "q:b:d:")) != -1;) {
+        switch (opt) {
+        case 'q': capacity = std::max<size_t>(2, std::strtoull(optarg, nullptr, 10)); break;
+        case 'b': batch = std::max(1, std::atoi(optarg)); break;
+        case 'd': seconds = std::max(1, std::atoi(optarg)); break;
+        default:
+            std::fprintf(stderr, "usage: %s [-q capacity] [-b batch] [-d seconds]\n", argv[0]);
+            return 2;
+        }
+    }
+    Logger::instance().set_level(LogLevel::Error);
+
+    std::printf("%zu messages in flight at most, %d pushed per producer iteration, %d s per run\n",
+                capacity, batch, seconds);
+    run(true, capacity, batch, seconds);
+    run(false, capacity, batch, seconds);
+    return 0;
+}
@@ -0,0 +1,148 @@
+// Tail latency of cheap requests sharing one IO loop with expensive ones,
+// with the expensive handler run inline on the loop and offloaded to a
+// WorkStealingPool. Requests are lines: "c" is echoed at once, "e" first
+// burns about -w microseconds of CPU.
+// Usage: offload_bench [-e expensiveConnections=4] [-w workUs=2000]
+//                      [-d seconds=3] [-t poolThreads=2]
+#include <arpa/inet.h>
+#include <getopt.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <muduo/EventLoopThread.hpp>
+#include <muduo/Logger.hpp>
+#include <muduo/TcpServer.hpp>
+#include <muduo/WorkStealingPool.hpp>
+
+#include "TestUtil.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Spins for about us microseconds; the result keeps the loop from being optimised out
+std::string burn(int us) {
+    const Clock::time_point end = Clock::now() + std::chrono::microseconds(us);
+    uint64_t x = 1469598103934665603ull;
+    while (Clock::now() < end) {
+        for (int i = 0; i < 256; ++i) {
+            x = (x ^ static_cast<uint64_t>(i)) * 1099511628211ull;
+        }
+    }
+    return x == 0 ? "E\n" : "e\n";
+}
+
+// Sends request lines one at a time until stop; records each round trip in microseconds
+void pingPong(uint16_t port, const char* request, const std::atomic<bool>& stop, std::vector<uint32_t>* latencies) {
+    const int fd = connectTo(port);
+    if (fd < 0) return;
+    char buf[64];
+    while (!stop.load(std::memory_order_relaxed)) {
+        const Clock::time_point start = Clock::now();
+        if (::write(fd, request, 2) != 2) break;
+        if (::read(fd, buf, sizeof(buf)) <= 0) break;
+        if (latencies) {
+            latencies->push_back(static_cast<uint32_t>(
+                std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count()));
+        }
+    }
+    ::close(fd);
+}
+
+void run(bool offload, int expensiveConnections, int workUs, int seconds, int poolThreads) {
+    WorkStealingPool pool("offload_bench");
+    if (offload) pool.start(poolThreads);
+
+    EventLoopThread serverThread;
+    EventLoop* loop = serverThread.startLoop();
+    std::unique_ptr<TcpServer> server;
+    uint16_t port = 0;
+    std::promise<void> started;
+    loop->runInLoop([&] {
+        server = std::make_unique<TcpServer>(loop, InetAddress(0), "offload_bench");
+        server->setThreadNum(1);
+        server->setMessageCallback([&pool, offload, workUs](const TcpConnectionPtr& conn, Buffer* buf, Timestamp) {
+            while (buf->readableBytes() >= 2) {
+                const bool expensive = buf->peek()[0] == 'e';
+                buf->retrieve(2);
+                if (!expensive) {
+                    conn->send("c\n");
+                } else if (offload) {
+                    conn->offload(pool, [workUs] { return burn(workUs); });
+                } else {
+                    conn->send(burn(workUs));
+                }
+            }
+        });
+        server->start();
+        port = server->listenAddress().toPort();
+        started.set_value();
+    });
+    started.get_future().wait();
+
+    std::atomic<bool> stop{false};
+    std::vector<uint32_t> cheap;
+    std::vector<std::thread> clients;
+    for (int i = 0; i < expensiveConnections; ++i) {
+        clients.emplace_back(pingPong, port, "e\n", std::cref(stop), nullptr);
+    }
+    clients.emplace_back(pingPong, port, "c\n", std::cref(stop), &cheap);
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    stop = true;
+    for (auto& client : clients) {
+        client.join();
+    }
+
+    std::promise<void> stopped;
+    loop->runInLoop([&] {
+        server.reset();
+        stopped.set_value();
+    });
+    stopped.get_future().wait();
+    pool.stop();
+
+    std::sort(cheap.begin(), cheap.end());
+    std::printf("  %-8s %7zu cheap requests, latency ms: p50 %.3f  p99 %.3f  max %.3f\n",
+                offload ? "offload" : "inline", cheap.size(), percentile(cheap, 0.50) / 1000.0,
+                percentile(cheap, 0.99) / 1000.0, percentile(cheap, 1.0) / 1000.0);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int expensiveConnections = 4;
+    int workUs = 2000;
+    int seconds = 3;
+    int poolThreads = 2;
+    for (int opt; (opt = ::getopt(argc, argv, "e:w:d:t:")) != -1;) {
+        switch (opt) {
+        case 'e': expensiveConnections = std::max(0, std::atoi(optarg)); break;
+        case 'w': workUs = std::max(1, std::atoi(optarg)); break;
+        case 'd': seconds = std::max(1, std::atoi(optarg)); break;
+        case 't': poolThreads = std::max(1, std::atoi(optarg)); break;
+        default:
+            std::fprintf(stderr, "usage: %s [-e expensiveConnections] [-w workUs] [-d seconds] [-t poolThreads]\n",
+                         argv[0]);
+            return 2;
+        }
+    }
+    Logger::instance().set_level(LogLevel::Error);
+
+    std::printf("1 cheap and %d expensive (%d us) connections on one IO loop, %d s per run\n",
+                expensiveConnections, workUs, seconds);
+    run(false, expensiveConnections, workUs, seconds, poolThreads);
+    run(true, expensiveConnections, workUs, seconds, poolThreads);
+    return 0;
+}
@@ -0,0 +1,227 @@
+// Relay throughput over loopback: client -> relay -> echo backend and back.
+// Compared are no relay at all, a buffer-copy relay built from TcpServer
+// and TcpClient (kernel -> input Buffer -> peer's output Buffer -> kernel)
+// and TcpProxy, which splices between the sockets through a pipe. Each
+// client connection streams -s byte chunks with at most -w bytes not yet
+// echoed, so no relay has to buffer more than that.
+// Usage: proxy_bench [-c connections=1] [-s chunk=65536] [-w windowKiB=1024]
+//                    [-d seconds=2]
+#include <arpa/inet.h>
+#include <getopt.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <muduo/EventLoopThread.hpp>
+#include <muduo/Logger.hpp>
+#include <muduo/TcpClient.hpp>
+#include <muduo/TcpProxy.hpp>
+#include <muduo/TcpServer.hpp>
+
+#include "TestUtil.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// The relay TcpProxy replaces: every byte is read into the inbound
+// connection's Buffer and copied into the outbound one's, and back
+class CopyRelay {
+public:
+    CopyRelay(EventLoop* loop, const InetAddress& listenAddr, const InetAddress& backendAddr)
+        : server_(loop, listenAddr, "copy_relay"), backendAddr_(backendAddr) {
+        server_.setThreadNum(1);
+        server_.setConnectionCallback([this](const TcpConnectionPtr& conn) { onConnection(conn); });
+        server_.setMessageCallback([](const TcpConnectionPtr& conn, Buffer* buf, Timestamp) {
+            if (Relay* relay = conn->getContext<Relay>()) {
+                const std::string_view data(buf->peek(), buf->readableBytes());
+                if (relay->upstream) {
+                    relay->upstream->send(data);
+                } else {
+                    relay->pending.append(data);
+                }
+            }
+            buf->retrieveAll();
+        });
+    }
+
+    void start() { server_.start(); }
+    [[nodiscard]] uint16_t port() const { return server_.listenAddress().toPort(); }
+
+private:
+    // The inbound connection's context
+    struct Relay {
+        std::unique_ptr<TcpClient> client;
+        TcpConnectionPtr upstream;
+        std::string pending;   // what arrived before the backend connection was up
+    };
+
+    void onConnection(const TcpConnectionPtr& conn) {
+        if (!conn->connected()) {
+            conn->resetContext();
+            return;
+        }
+        Relay& relay = conn->setContext<Relay>();
+        relay.client = std::make_unique<TcpClient>(conn->getLoop(), backendAddr_, "copy_relay");
+        const std::weak_ptr<TcpConnection> weakInbound = conn;
+        relay.client->setConnectionCallback([weakInbound](const TcpConnectionPtr& upstream) {
+            const TcpConnectionPtr inbound = weakInbound.lock();
+            Relay* relay = inbound ? inbound->getContext<Relay>() : nullptr;
+            if (!relay) return;
+            if (upstream->connected()) {
+                relay->upstream = upstream;
+                upstream->send(relay->pending);
+                relay->pending.clear();
+            } else {
+                relay->upstream.reset();
+                inbound->shutdown();
+            }
+        });
+        relay.client->setMessageCallback([weakInbound](const TcpConnectionPtr&, Buffer* buf, Timestamp) {
+            if (const TcpConnectionPtr inbound = weakInbound.lock()) {
+                inbound->send(std::string_view(buf->peek(), buf->readableBytes()));
+            }
+            buf->retrieveAll();
+        });
+        relay.client->connect();
+    }
+
+    TcpServer server_;
+    const InetAddress backendAddr_;
+};
+
+// Streams chunks and reads the echo back on another thread; returns the bytes echoed
+uint64_t stream(uint16_t port, size_t chunk, size_t window, const std::atomic<bool>& stop) {
+    const int fd = connectTo(port);
+    if (fd < 0) return 0;
+    std::atomic<uint64_t> received{0};
+    std::thread writer([&] {
+        const std::string data(chunk, 'd');
+        uint64_t sent = 0;
+        while (!stop.load(std::memory_order_relaxed)) {
+            if (sent - received.load(std::memory_order_acquire) + chunk > window) {
+                std::this_thread::yield();
+                continue;
+            }
+            const ssize_t n = ::write(fd, data.data(), data.size());
+            if (n <= 0) break;
+            sent += static_cast<uint64_t>(n);
+        }
+        ::shutdown(fd, SHUT_WR);
+    });
+    std::vector<char> buf(chunk);
+    uint64_t total = 0;
+    for (ssize_t n; (n = ::read(fd, buf.data(), buf.size())) > 0;) {
+        total += static_cast<uint64_t>(n);
+        if (!stop.load(std::memory_order_relaxed)) {
+            received.store(total, std::memory_order_release);
+        }
+    }
+    writer.join();
+    ::close(fd);
+    return total;
+}
+
+// Counts the bytes echoed while clients stream through whatever listens on port
+void measure(const char* label, uint16_t port, int connections, size_t chunk, size_t window, int seconds) {
+    std::atomic<bool> stop{false};
+    std::vector<uint64_t> bytes(connections);
+    std::vector<std::thread> clients;
+    const Clock::time_point start = Clock::now();
+    for (int i = 0; i < connections; ++i) {
+        clients.emplace_back([&, i] { bytes[i] = stream(port, chunk, window, stop); });
+    }
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    stop = true;
+    for (auto& client : clients) {
+        client.join();
+    }
+    const double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    uint64_t total = 0;
+    for (const uint64_t b : bytes) total += b;
+    std::printf("  %-12s %8.1f MiB/s echoed\n", label, static_cast<double>(total) / elapsed / (1 << 20));
+}
+
+// On loop: builds and starts the object with make, or destroys it when make is empty
+template<typename T>
+void onLoop(EventLoop* loop, std::unique_ptr<T>& object, std::function<std::unique_ptr<T>()> make) {
+    std::promise<void> done;
+    loop->runInLoop([&] {
+        object = make ? make() : nullptr;
+        if (object) object->start();
+        done.set_value();
+    });
+    done.get_future().wait();
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int connections = 1;
+    size_t chunk = 65536;
+    size_t windowKiB = 1024;
+    int seconds = 2;
+    for (int opt; (opt = ::getopt(argc, argv, "c:s:w:d:")) != -1;) {
+        switch (opt) {
+        case 'c': connections = std::max(1, std::atoi(optarg)); break;
+        case 's': chunk = std::max<size_t>(1, std::strtoull(optarg, nullptr, 10)); break;
+        case 'w': windowKiB = std::max<size_t>(1, std::strtoull(optarg, nullptr, 10)); break;
+        case 'd': seconds = std::max(1, std::atoi(optarg)); break;
+        default:
+            std::fprintf(stderr, "usage: %s [-c connections] [-s chunk] [-w windowKiB] [-d seconds]\n", argv[0]);
+            return 2;
+        }
+    }
+    Logger::instance().set_level(LogLevel::Error);
+    const size_t window = std::max(windowKiB << 10, chunk);
+
+    EventLoopThread backendThread;
+    EventLoop* backendLoop = backendThread.startLoop();
+    std::unique_ptr<TcpServer> backend;
+    onLoop<TcpServer>(backendLoop, backend, [&] {
+        auto server = std::make_unique<TcpServer>(backendLoop, InetAddress(0), "backend");
+        server->setMessageCallback([](const TcpConnectionPtr& conn, Buffer* buf, Timestamp) {
+            conn->send(std::string_view(buf->peek(), buf->readableBytes()));
+            buf->retrieveAll();
+        });
+        return server;
+    });
+    const InetAddress backendAddr = backend->listenAddress();
+
+    std::printf("%d connection(s), %zu-byte chunks, %zu KiB in flight, %d s per run\n",
+                connections, chunk, window >> 10, seconds);
+    measure("direct", backendAddr.toPort(), connections, chunk, window, seconds);
+
+    EventLoopThread relayThread;
+    EventLoop* relayLoop = relayThread.startLoop();
+    std::unique_ptr<CopyRelay> copyRelay;
+    onLoop<CopyRelay>(relayLoop, copyRelay, [&] {
+        return std::make_unique<CopyRelay>(relayLoop, InetAddress(0), backendAddr);
+    });
+    measure("copy relay", copyRelay->port(), connections, chunk, window, seconds);
+    onLoop<CopyRelay>(relayLoop, copyRelay, nullptr);
+
+    std::unique_ptr<TcpProxy> proxy;
+    onLoop<TcpProxy>(relayLoop, proxy, [&] {
+        auto p = std::make_unique<TcpProxy>(relayLoop, InetAddress(0), backendAddr, "splice_proxy");
+        p->setThreadNum(1);
+        return p;
+    });
+    measure("splice proxy", proxy->tcpServer().listenAddress().toPort(), connections, chunk, window, seconds);
+    onLoop<TcpProxy>(relayLoop, proxy, nullptr);
+
+    onLoop<TcpServer>(backendLoop, backend, nullptr);
+    return 0;
+}
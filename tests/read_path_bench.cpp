@@ -0,0 +1,132 @@
+// Read events per second through one IO loop, with the message callback
+// taking a shared_ptr (one shared_from_this() per message) against a
+// borrowed callback that gets the connection by reference.
+// Usage: read_path_bench [-c connections=16] [-d seconds=2] [-r rounds=3]
+// The two modes alternate for the given number of rounds.
+#include <arpa/inet.h>
+#include <getopt.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <muduo/EventLoopThread.hpp>
+#include <muduo/Logger.hpp>
+#include <muduo/TcpServer.hpp>
+
+#include "TestUtil.hpp"
+
+namespace {
+
+constexpr size_t kMessageSize = 16;
+
+// One blocking ping-pong client per connection; returns the round trips completed
+uint64_t runEchoClients(uint16_t port, int connections, int seconds) {
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> total{0};
+    std::vector<std::thread> clients;
+    for (int i = 0; i < connections; ++i) {
+        clients.emplace_back([&] {
+            const int fd = connectTo(port);
+            if (fd < 0) return;
+            const std::string message(kMessageSize, 'm');
+            char buf[kMessageSize];
+            uint64_t done = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                if (::write(fd, message.data(), message.size()) != static_cast<ssize_t>(message.size())) break;
+                size_t got = 0;
+                while (got < kMessageSize) {
+                    const ssize_t n = ::read(fd, buf, kMessageSize - got);
+                    if (n <= 0) break;
+                    got += static_cast<size_t>(n);
+                }
+                if (got < kMessageSize) break;
+                ++done;
+            }
+            total += done;
+            ::close(fd);
+        });
+    }
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    stop = true;
+    for (auto& client : clients) {
+        client.join();
+    }
+    return total.load();
+}
+
+double eventRate(bool borrowed, int connections, int seconds) {
+    EventLoopThread serverThread;
+    EventLoop* loop = serverThread.startLoop();
+    std::unique_ptr<TcpServer> server;
+    uint16_t port = 0;
+    std::promise<void> started;
+    loop->runInLoop([&] {
+        server = std::make_unique<TcpServer>(loop, InetAddress(0), "read_path");
+        server->setThreadNum(1);
+        if (borrowed) {
+            server->setBorrowedMessageCallback([](TcpConnection& conn, Buffer* buf, Timestamp) {
+                conn.send(std::string_view(buf->peek(), buf->readableBytes()));
+                buf->retrieveAll();
+            });
+        } else {
+            server->setMessageCallback([](const TcpConnectionPtr& conn, Buffer* buf, Timestamp) {
+                conn->send(std::string_view(buf->peek(), buf->readableBytes()));
+                buf->retrieveAll();
+            });
+        }
+        server->start();
+        port = server->listenAddress().toPort();
+        started.set_value();
+    });
+    started.get_future().wait();
+
+    const uint64_t events = runEchoClients(port, connections, seconds);
+
+    std::promise<void> stopped;
+    loop->runInLoop([&] {
+        server.reset();
+        stopped.set_value();
+    });
+    stopped.get_future().wait();
+    return static_cast<double>(events) / seconds;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int connections = 16;
+    int seconds = 2;
+    int rounds = 3;
+    for (int opt; (opt = ::getopt(argc, argv, "c:d:r:")) != -1;) {
+        switch (opt) {
+        case 'c': connections = std::max(1, std::atoi(optarg)); break;
+        case 'd': seconds = std::max(1, std::atoi(optarg)); break;
+        case 'r': rounds = std::max(1, std::atoi(optarg)); break;
+        default:
+            std::fprintf(stderr, "usage: %s [-c connections] [-d seconds] [-r rounds]\n", argv[0]);
+            return 2;
+        }
+    }
+    Logger::instance().set_level(LogLevel::Error);
+
+    std::printf("%d connections, %zu-byte ping-pong, one IO loop, %d s per run\n",
+                connections, kMessageSize, seconds);
+    for (int round = 1; round <= rounds; ++round) {
+        const double shared = eventRate(false, connections, seconds);
+        const double borrowed = eventRate(true, connections, seconds);
+        std::printf("  round %d: shared_ptr callback %9.0f events/s, borrowed callback %9.0f events/s\n",
+                    round, shared, borrowed);
+    }
+    return 0;
+}
@@ -0,0 +1,186 @@
+// Calls per second and latency percentiles of RpcClient against an echo
+// RpcServer over loopback, with a fixed number of calls kept in flight on
+// one client connection; then the same through an RpcProxy in front of the
+// server, to show what the extra hop adds.
+// Usage: rpc_bench [-d seconds=2] [-s payloadBytes=64]
+// Runs with 1, 16 and 256 calls in flight.
+#include <getopt.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <muduo/EventLoopThread.hpp>
+#include <muduo/Logger.hpp>
+#include <muduo/RpcClient.hpp>
+#include <muduo/RpcProxy.hpp>
+#include <muduo/RpcServer.hpp>
+
+#include "TestUtil.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Keeps depth calls in flight on one client until stop(); latencies in microseconds
+class CallDriver {
+public:
+    CallDriver(EventLoop* loop, const InetAddress& serverAddr, int depth, size_t payloadBytes)
+        : client_(loop, serverAddr, "rpc_bench"), depth_(depth), payload_(payloadBytes, 'p') {}
+
+    void start(std::promise<void>* connected) {
+        client_.setConnectionCallback([connected](const TcpConnectionPtr& conn) mutable {
+            if (conn->connected() && connected) {
+                connected->set_value();
+                connected = nullptr;
+            }
+        });
+        client_.connect();
+    }
+
+    // Loop thread only
+    void run() {
+        for (int i = 0; i < depth_; ++i) {
+            issue();
+        }
+    }
+    void stop() { stopped_ = true; }
+
+    [[nodiscard]] uint64_t failures() const noexcept { return failures_; }
+    [[nodiscard]] std::vector<uint32_t>& latencies() noexcept { return latencies_; }
+
+private:
+    void issue() {
+        const Clock::time_point start = Clock::now();
+        client_.call("echo", payload_, [this, start](RpcStatus status, std::string_view) {
+            if (status != RpcStatus::kOk) {
+                ++failures_;
+            } else {
+                latencies_.push_back(static_cast<uint32_t>(
+                    std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count()));
+            }
+            if (!stopped_) issue();
+        });
+    }
+
+    RpcClient client_;
+    int depth_;
+    std::string payload_;
+    bool stopped_{false};
+    uint64_t failures_{0};
+    std::vector<uint32_t> latencies_;
+};
+
+// Drives depth calls in flight against target for the given time and prints one line
+void measure(const char* label, const InetAddress& target, int depth, int seconds, size_t payloadBytes) {
+    EventLoopThread clientThread;
+    EventLoop* loop = clientThread.startLoop();
+    std::unique_ptr<CallDriver> driver;
+    std::promise<void> connected;
+    loop->runInLoop([&] {
+        driver = std::make_unique<CallDriver>(loop, target, depth, payloadBytes);
+        driver->start(&connected);
+    });
+    connected.get_future().wait();
+
+    loop->runInLoop([&] { driver->run(); });
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    std::promise<void> stopped;
+    loop->runInLoop([&] {
+        driver->stop();
+        stopped.set_value();
+    });
+    stopped.get_future().wait();
+    // Let the calls still in flight come back before tearing the client down
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    std::promise<void> destroyed;
+    loop->runInLoop([&] {
+        std::vector<uint32_t>& latencies = driver->latencies();
+        std::sort(latencies.begin(), latencies.end());
+        std::printf("  %-8s %4d in flight: %9.0f calls/s  p50 %.3f ms  p99 %.3f ms  failed %llu\n", label, depth,
+                    static_cast<double>(latencies.size()) / seconds, percentile(latencies, 0.50) / 1000.0,
+                    percentile(latencies, 0.99) / 1000.0, static_cast<unsigned long long>(driver->failures()));
+        driver.reset();
+        destroyed.set_value();
+    });
+    destroyed.get_future().wait();
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int seconds = 2;
+    size_t payloadBytes = 64;
+    for (int opt; (opt = ::getopt(argc, argv, "d:s:")) != -1;) {
+        switch (opt) {
+        case 'd': seconds = std::max(1, std::atoi(optarg)); break;
+        case 's': payloadBytes = static_cast<size_t>(std::max(0, std::atoi(optarg))); break;
+        default:
+            std::fprintf(stderr, "usage: %s [-d seconds] [-s payloadBytes]\n", argv[0]);
+            return 2;
+        }
+    }
+    Logger::instance().set_level(LogLevel::Error);
+
+    EventLoopThread serverThread;
+    EventLoop* serverLoop = serverThread.startLoop();
+    std::unique_ptr<RpcServer> server;
+    InetAddress serverAddr(0);
+    std::promise<void> started;
+    serverLoop->runInLoop([&] {
+        server = std::make_unique<RpcServer>(serverLoop, InetAddress(0), "rpc_bench");
+        server->setThreadNum(1);
+        server->registerMethod("echo", [](std::string_view payload, const RpcServer::Responder& responder) {
+            responder.reply(payload);
+        });
+        server->start();
+        serverAddr = InetAddress(server->tcpServer().listenAddress().toPort(), "127.0.0.1");
+        started.set_value();
+    });
+    started.get_future().wait();
+
+    EventLoopThread proxyThread;
+    EventLoop* proxyLoop = proxyThread.startLoop();
+    std::unique_ptr<RpcProxy> proxy;
+    InetAddress proxyAddr(0);
+    std::promise<void> proxyStarted;
+    proxyLoop->runInLoop([&] {
+        proxy = std::make_unique<RpcProxy>(proxyLoop, InetAddress(0), std::vector<InetAddress>{serverAddr},
+                                           "rpc_bench_proxy");
+        proxy->setThreadNum(1);
+        proxy->start();
+        proxyAddr = InetAddress(proxy->tcpServer().listenAddress().toPort(), "127.0.0.1");
+        proxyStarted.set_value();
+    });
+    proxyStarted.get_future().wait();
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));   // upstream connections
+
+    std::printf("echo calls, %zu-byte payload, one client connection, one IO loop per server, %d s per run\n",
+                payloadBytes, seconds);
+    for (const int depth : {1, 16, 256}) {
+        measure("direct", serverAddr, depth, seconds, payloadBytes);
+        measure("proxied", proxyAddr, depth, seconds, payloadBytes);
+    }
+
+    std::promise<void> proxyStopped;
+    proxyLoop->runInLoop([&] {
+        proxy.reset();
+        proxyStopped.set_value();
+    });
+    proxyStopped.get_future().wait();
+
+    std::promise<void> stopped;
+    serverLoop->runInLoop([&] {
+        server.reset();
+        stopped.set_value();
+    });
+    stopped.get_future().wait();
+    return 0;
+}
@@ -0,0 +1,157 @@
+// Several clients each write as fast as they can to an echo server while
+// reading the echo back slowly. Without read backpressure the server's
+// output buffers absorb everything the clients manage to send; with
+// setReadBackpressure(high, low) each connection stops reading above the
+// high mark, so its pending output and the process's resident set stay
+// bounded while every byte still comes back. A high-water-mark callback
+// set just above that bound counts the connections whose output got past it.
+// Usage: test_backpressure [MiB per connection=16] [connections=4];
+// exits non-zero on failure.
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <muduo/EventLoopThread.hpp>
+#include <muduo/Logger.hpp>
+#include <muduo/TcpServer.hpp>
+
+#include "TestUtil.hpp"
+
+namespace {
+
+constexpr size_t kHighMark = 1 << 20;
+constexpr size_t kLowMark = 256 << 10;
+// What one read can add on top of the high mark before reading pauses
+constexpr size_t kReadSlack = 1 << 20;
+constexpr long kMaxRssGrowthMiB = 32;
+
+// A fast writer and a slow reader on one connection; returns the bytes echoed back
+size_t fastWriterSlowReader(uint16_t port, size_t total) {
+    const int fd = connectTo(port);
+    if (fd < 0) return 0;
+    std::thread writer([fd, total] {
+        const std::string chunk(64 * 1024, 'w');
+        size_t sent = 0;
+        while (sent < total) {
+            const ssize_t w = ::write(fd, chunk.data(), std::min(chunk.size(), total - sent));
+            if (w <= 0) break;
+            sent += static_cast<size_t>(w);
+        }
+    });
+    char buf[64 * 1024];
+    size_t received = 0;
+    while (received < total) {
+        const ssize_t n = ::read(fd, buf, sizeof(buf));
+        if (n <= 0) break;
+        received += static_cast<size_t>(n);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    writer.join();
+    ::close(fd);
+    return received;
+}
+
+struct RunResult {
+    bool complete;
+    int overflows;   // times a connection's output backlog crossed kHighMark + kReadSlack
+    long rssGrowthMiB;
+};
+
+RunResult run(bool backpressure, size_t perConnection, int connections) {
+    EventLoopThread serverThread;
+    EventLoop* loop = serverThread.startLoop();
+    std::unique_ptr<TcpServer> server;
+    std::atomic<int> overflows{0};
+    uint16_t port = 0;
+    std::promise<void> started;
+    loop->runInLoop([&] {
+        server = std::make_unique<TcpServer>(loop, InetAddress(0), "backpressure");
+        server->setThreadNum(1);
+        if (backpressure) {
+            server->setReadBackpressure(kHighMark, kLowMark);
+        }
+        server->setConnectionCallback([&overflows](const TcpConnectionPtr& conn) {
+            if (conn->connected()) {
+                conn->setHighWaterMarkCallback([&overflows](const TcpConnectionPtr&, size_t) { ++overflows; },
+                                               kHighMark + kReadSlack);
+            }
+        });
+        server->setMessageCallback([](const TcpConnectionPtr& conn, Buffer* buf, Timestamp) {
+            conn->send(std::string_view(buf->peek(), buf->readableBytes()));
+            buf->retrieveAll();
+        });
+        server->start();
+        port = server->listenAddress().toPort();
+        started.set_value();
+    });
+    started.get_future().wait();
+
+    const long baseline = residentMiB();
+    std::atomic<long> peakRss{baseline};
+    std::atomic<int> complete{0};
+    std::vector<std::thread> clients;
+    for (int i = 0; i < connections; ++i) {
+        clients.emplace_back([&] {
+            if (fastWriterSlowReader(port, perConnection) == perConnection) ++complete;
+        });
+    }
+    std::atomic<bool> done{false};
+    std::thread sampler([&] {
+        while (!done.load()) {
+            peakRss = std::max(peakRss.load(), residentMiB());
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    });
+    for (auto& client : clients) {
+        client.join();
+    }
+    done = true;
+    sampler.join();
+
+    std::promise<void> stopped;
+    loop->runInLoop([&] {
+        server.reset();
+        stopped.set_value();
+    });
+    stopped.get_future().wait();
+    return {complete == connections, overflows.load(), peakRss.load() - baseline};
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const size_t perConnection = (argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 16) << 20;
+    const int connections = argc > 2 ? std::max(1, std::atoi(argv[2])) : 4;
+    Logger::instance().set_level(LogLevel::Error);
+
+    // The bounded run goes first, so memory the other one leaves cached is not counted
+    const RunResult on = run(true, perConnection, connections);
+    const RunResult off = run(false, perConnection, connections);
+    std::printf("%d connections, %zu MiB each\n", connections, perConnection >> 20);
+    std::printf("  without backpressure: backlog past %zu KiB %3d times, resident set +%ld MiB\n",
+                (kHighMark + kReadSlack) >> 10, off.overflows, off.rssGrowthMiB);
+    std::printf("  with backpressure:    backlog past %zu KiB %3d times, resident set +%ld MiB\n",
+                (kHighMark + kReadSlack) >> 10, on.overflows, on.rssGrowthMiB);
+
+    bool ok = true;
+    auto check = [&ok](const char* what, bool pass) {
+        std::printf("%s: %s\n", pass ? "PASS" : "FAIL", what);
+        ok &= pass;
+    };
+    check("every byte echoed back", off.complete && on.complete);
+    check("output backlog bounded by the high mark", on.overflows == 0);
+    check("resident set stays flat", on.rssGrowthMiB <= kMaxRssGrowthMiB);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,233 @@
+// Client side against a local echo TcpServer: a TcpClient connects and
+// echoes, retries with backoff until a late server starts listening,
+// notices the peer closing and reconnects; a ConnectionPool fills up,
+// hands out connections and refills after the server drops them all.
+// A message "close" makes the server force-close that connection.
+// Usage: test_client; exits non-zero on failure.
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <muduo/ConnectionPool.hpp>
+#include <muduo/EventLoopThread.hpp>
+#include <muduo/Logger.hpp>
+#include <muduo/TcpClient.hpp>
+#include <muduo/TcpServer.hpp>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+bool check(const char* what, bool ok) {
+    std::printf("%s: %s\n", ok ? "PASS" : "FAIL", what);
+    return ok;
+}
+
+// Polls pred until it holds or the timeout runs out
+bool waitFor(const std::function<bool()>& pred, double seconds) {
+    const Clock::time_point deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(seconds));
+    while (!pred()) {
+        if (Clock::now() >= deadline) return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return true;
+}
+
+// A port nothing listens on right now
+uint16_t unusedPort() {
+    const int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    ::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    ::getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &len);
+    ::close(fd);
+    return ntohs(addr.sin_port);
+}
+
+// An echo server on its own loop thread
+class EchoServer {
+public:
+    explicit EchoServer(uint16_t port) : loop_(thread_.startLoop()) {
+        std::promise<void> started;
+        loop_->runInLoop([&] {
+            server_ = std::make_unique<TcpServer>(loop_, InetAddress(port), "echo");
+            server_->setThreadNum(1);
+            server_->setMessageCallback([](const TcpConnectionPtr& conn, Buffer* buf, Timestamp) {
+                const std::string message(buf->peek(), buf->readableBytes());
+                buf->retrieveAll();
+                if (message == "close") {
+                    conn->forceClose();
+                } else {
+                    conn->send(message);
+                }
+            });
+            server_->start();
+            port_ = server_->listenAddress().toPort();
+            started.set_value();
+        });
+        started.get_future().wait();
+    }
+
+    ~EchoServer() {
+        std::promise<void> stopped;
+        loop_->runInLoop([&] {
+            server_.reset();
+            stopped.set_value();
+        });
+        stopped.get_future().wait();
+    }
+
+    [[nodiscard]] uint16_t port() const noexcept { return port_; }
+
+private:
+    EventLoopThread thread_;
+    EventLoop* loop_;
+    std::unique_ptr<TcpServer> server_;
+    uint16_t port_{0};
+};
+
+// What the client callbacks saw; written on the client loop, read by the test
+struct ClientEvents {
+    std::atomic<int> ups{0};
+    std::atomic<int> downs{0};
+    std::mutex mutex;
+    std::string received;
+
+    std::string text() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return received;
+    }
+};
+
+void watch(TcpClient& client, ClientEvents& events) {
+    client.setConnectionCallback([&events](const TcpConnectionPtr& conn) {
+        ++(conn->connected() ? events.ups : events.downs);
+    });
+    client.setMessageCallback([&events](const TcpConnectionPtr&, Buffer* buf, Timestamp) {
+        std::lock_guard<std::mutex> lock(events.mutex);
+        events.received.append(buf->peek(), buf->readableBytes());
+        buf->retrieveAll();
+    });
+}
+
+bool testConnectAndEcho(EventLoop* clientLoop) {
+    EchoServer server(0);
+    ClientEvents events;
+    TcpClient client(clientLoop, InetAddress(server.port()), "connect");
+    watch(client, events);
+    client.connect();
+
+    bool ok = check("client connects", waitFor([&] { return events.ups == 1; }, 2.0));
+    if (TcpConnectionPtr conn = client.connection()) {
+        conn->send("hello");
+    }
+    ok &= check("client gets its echo", waitFor([&] { return events.text() == "hello"; }, 2.0));
+    return ok;
+}
+
+bool testRetryWithBackoff(EventLoop* clientLoop) {
+    const uint16_t port = unusedPort();
+    ClientEvents events;
+    TcpClient client(clientLoop, InetAddress(port), "retry");
+    watch(client, events);
+    client.setRetryDelays(0.02, 0.1);
+    client.enableRetry();
+    client.connect();
+
+    // Refused attempts back off to the 0.1 s cap; the listener shows up meanwhile
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    bool ok = check("no connection while nothing listens", events.ups == 0);
+    EchoServer server(port);
+    const Clock::time_point listening = Clock::now();
+    ok &= check("client connects once the server listens", waitFor([&] { return events.ups == 1; }, 2.0));
+    ok &= check("within one capped retry delay",
+                Clock::now() - listening < std::chrono::milliseconds(500));
+    return ok;
+}
+
+bool testPeerClose(EventLoop* clientLoop) {
+    EchoServer server(0);
+    ClientEvents events;
+    TcpClient client(clientLoop, InetAddress(server.port()), "peer-close");
+    watch(client, events);
+    client.setRetryDelays(0.02, 0.1);
+    client.enableRetry();
+    client.connect();
+
+    bool ok = check("client connects", waitFor([&] { return events.ups == 1; }, 2.0));
+    if (TcpConnectionPtr conn = client.connection()) {
+        conn->send("close");
+    }
+    ok &= check("client sees the peer close", waitFor([&] { return events.downs == 1; }, 2.0));
+    ok &= check("client reconnects", waitFor([&] { return events.ups == 2 && client.connection() != nullptr; }, 2.0));
+    return ok;
+}
+
+bool testConnectionPool(EventLoop* baseLoop) {
+    EchoServer server(0);
+    std::atomic<int> echoed{0};
+    ConnectionPool pool(baseLoop, InetAddress(server.port()), "pool");
+    pool.setThreadNum(2);
+    pool.setConnectionsPerLoop(2);
+    pool.setRetryDelays(0.02, 0.1);
+    pool.setMessageCallback([&echoed](const TcpConnectionPtr&, Buffer* buf, Timestamp) {
+        echoed += static_cast<int>(buf->readableBytes());
+        buf->retrieveAll();
+    });
+    pool.start();
+
+    bool ok = check("pool fills up", waitFor([&] { return pool.connectedCount() == 4; }, 2.0));
+
+    // Checkout: round robin spreads over the connections; a loop gets its own
+    const TcpConnectionPtr first = pool.acquire();
+    const TcpConnectionPtr second = pool.acquire();
+    ok &= check("acquire() hands out connected connections",
+                first && second && first->connected() && second->connected() && first != second);
+    bool ownLoop = true;
+    for (EventLoop* ioLoop : pool.getAllLoops()) {
+        const TcpConnectionPtr conn = pool.acquire(ioLoop);
+        ownLoop &= conn && conn->getLoop() == ioLoop;
+    }
+    ok &= check("acquire(loop) prefers a connection on that loop", ownLoop);
+
+    // Return: the connections stay in the pool and carry traffic for later users
+    if (first) first->send("ping");
+    ok &= check("a checked-out connection carries requests", waitFor([&] { return echoed == 4; }, 2.0));
+
+    // The server drops every connection; retries bring the pool back
+    for (int i = 0; i < 4; ++i) {
+        if (TcpConnectionPtr conn = pool.acquire()) conn->send("close");
+    }
+    ok &= check("pool notices the drops", waitFor([&] { return pool.connectedCount() < 4; }, 2.0));
+    ok &= check("pool refills after the peer closed", waitFor([&] { return pool.connectedCount() == 4; }, 3.0));
+    return ok;
+}
+
+} // namespace
+
+int main() {
+    Logger::instance().set_level(LogLevel::Error);
+
+    EventLoopThread clientThread;
+    EventLoop* clientLoop = clientThread.startLoop();
+
+    bool ok = true;
+    ok &= testConnectAndEcho(clientLoop);
+    ok &= testRetryWithBackoff(clientLoop);
+    ok &= testPeerClose(clientLoop);
+    ok &= testConnectionPool(clientLoop);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,96 @@
+// Sends a request with a malformed header line, then more bytes after the
+// 400, and checks the server answers 400, discards the trailing input and
+// still serves a well-formed request on a new connection.
+// Usage: test_http_error; exits non-zero on failure.
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include <muduo/HttpServer.hpp>
+#include <muduo/Logger.hpp>
+
+#include "TestUtil.hpp"
+
+namespace {
+
+bool writeAll(int fd, std::string_view data) {
+    while (!data.empty()) {
+        const ssize_t w = ::write(fd, data.data(), data.size());
+        if (w <= 0) return false;
+        data.remove_prefix(static_cast<size_t>(w));
+    }
+    return true;
+}
+
+// Everything the server sends until it closes its side
+std::string readToEof(int fd) {
+    std::string out;
+    char buf[4096];
+    for (;;) {
+        const ssize_t n = ::read(fd, buf, sizeof(buf));
+        if (n <= 0) break;
+        out.append(buf, static_cast<size_t>(n));
+    }
+    return out;
+}
+
+bool check(const char* what, bool ok) {
+    std::printf("%s: %s\n", ok ? "PASS" : "FAIL", what);
+    return ok;
+}
+
+} // namespace
+
+int main() {
+    Logger::instance().set_level(LogLevel::Error);
+
+    EventLoop loop;
+    HttpServer server(&loop, InetAddress(0), "http-error");
+    const uint16_t port = server.tcpServer().listenAddress().toPort();
+    server.setThreadNum(1);
+    server.setHttpCallback([](const HttpRequest&, HttpResponse* response) {
+        response->setStatus(200);
+        response->setBody("ok");
+    });
+    server.start();
+
+    bool ok = true;
+    std::thread client([&] {
+        // A header line without a colon, then input trickling in after the 400
+        int fd = connectTo(port);
+        std::string reply;
+        if (fd >= 0) {
+            writeAll(fd, "GET / HTTP/1.1\r\nHost: x\r\nNoColonHere\r\n");
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            writeAll(fd, "X");
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            writeAll(fd, "GET / HTTP/1.1\r\nHost: x\r\n\r\n");
+            reply = readToEof(fd);
+            ::close(fd);
+        }
+        ok &= check("malformed header gets exactly one 400",
+                    reply.rfind("HTTP/1.1 400", 0) == 0 && reply.find("HTTP/1.1", 1) == std::string::npos);
+
+        // The server is still healthy for the next client
+        fd = connectTo(port);
+        reply.clear();
+        if (fd >= 0) {
+            writeAll(fd, "GET / HTTP/1.1\r\nHost: x\r\nConnection: close\r\n\r\n");
+            reply = readToEof(fd);
+            ::close(fd);
+        }
+        ok &= check("a later well-formed request gets 200", reply.rfind("HTTP/1.1 200", 0) == 0);
+
+        loop.queueInLoop([&loop] { loop.quit(); });
+    });
+    loop.loop();
+    client.join();
+    return ok ? 0 : 1;
+}
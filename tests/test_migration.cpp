@@ -0,0 +1,126 @@
+// Echoes a counting byte pattern through a server that keeps migrating the
+// connection between its IO loops, and checks every byte comes back in order.
+// Migrating to a loop outside the server's pool must be refused.
+// Usage: test_migration [MiB=32]; exits non-zero on failure.
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <muduo/Logger.hpp>
+#include <muduo/TcpServer.hpp>
+
+#include "TestUtil.hpp"
+
+namespace {
+
+// Writes total bytes of the pattern 0, 1, ..., 255, 0, ...
+void writePattern(int fd, size_t total) {
+    std::string chunk(64 * 1024, '\0');
+    uint8_t next = 0;
+    size_t sent = 0;
+    while (sent < total) {
+        const size_t n = std::min(chunk.size(), total - sent);
+        for (size_t i = 0; i < n; ++i) {
+            chunk[i] = static_cast<char>(next++);
+        }
+        for (size_t off = 0; off < n;) {
+            const ssize_t w = ::write(fd, chunk.data() + off, n - off);
+            if (w <= 0) return;
+            off += static_cast<size_t>(w);
+        }
+        sent += n;
+    }
+}
+
+// Number of bytes that came back matching the pattern before the first mismatch
+size_t readPattern(int fd, size_t total) {
+    char buf[64 * 1024];
+    uint8_t expect = 0;
+    size_t got = 0;
+    while (got < total) {
+        const ssize_t n = ::read(fd, buf, sizeof(buf));
+        if (n <= 0) break;
+        for (ssize_t i = 0; i < n; ++i) {
+            if (static_cast<uint8_t>(buf[i]) != expect++) return got + static_cast<size_t>(i);
+        }
+        got += static_cast<size_t>(n);
+    }
+    return got;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const size_t total = (argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 32) << 20;
+    Logger::instance().set_level(LogLevel::Error);
+
+    EventLoop loop;
+    TcpServer server(&loop, InetAddress(0), "migration");
+    const uint16_t port = server.listenAddress().toPort();
+    server.setThreadNum(3);
+
+    std::mutex mutex;
+    std::vector<EventLoop*> ioLoops;
+    server.setThreadInitCallback([&](EventLoop* ioLoop) {
+        std::lock_guard<std::mutex> lock(mutex);
+        ioLoops.push_back(ioLoop);
+    });
+
+    std::vector<TcpConnectionPtr> connections;   // base loop only
+    server.setConnectionCallback([&](const TcpConnectionPtr& conn) {
+        if (conn->connected()) {
+            loop.runInLoop([&connections, conn] { connections.push_back(conn); });
+        }
+    });
+    server.setMessageCallback([](const TcpConnectionPtr& conn, Buffer* buf, Timestamp) {
+        conn->send(buf->retrieveAllAsString());
+    });
+    server.start();
+
+    std::atomic<int> migrations{0};
+    std::atomic<int> refused{0};
+    size_t next = 0;
+    loop.runEvery(0.003, [&] {
+        for (const auto& conn : connections) {
+            // Once: the base loop is not one of the server's IO loops (logs an error)
+            if (next == 0) {
+                server.migrateConnection(conn, &loop, [&refused](const TcpConnectionPtr&, bool moved) {
+                    if (!moved) ++refused;
+                });
+            }
+            EventLoop* target = ioLoops[++next % ioLoops.size()];
+            server.migrateConnection(conn, target, [&migrations](const TcpConnectionPtr&, bool moved) {
+                if (moved) ++migrations;
+            });
+        }
+    });
+
+    size_t received = 0;
+    std::thread client([&] {
+        const int fd = connectTo(port);
+        if (fd >= 0) {
+            std::thread writer(writePattern, fd, total);
+            received = readPattern(fd, total);
+            writer.join();
+            ::close(fd);
+        }
+        loop.queueInLoop([&loop] { loop.quit(); });
+    });
+    loop.loop();
+    client.join();
+
+    const bool ok = received == total && migrations.load() > 0 && refused.load() > 0;
+    std::printf("%s: %zu of %zu bytes echoed intact across %d migrations, %d to a foreign loop refused\n",
+                ok ? "PASS" : "FAIL", received, total, migrations.load(), refused.load());
+    return ok ? 0 : 1;
+}
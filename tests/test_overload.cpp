@@ -0,0 +1,216 @@
+// Offers twice the load one IO loop can serve and counts goodput: replies
+// that arrive within the client deadline. Every request costs the server
+// -w microseconds of CPU, so it serves about 1e6 / w per second. Requests
+// are sent open-loop (at a fixed rate, whatever the replies do) over many
+// connections, and each carries its send time, so a late reply is seen as
+// late. Without shedding the backlog grows until every reply misses the
+// deadline. With enableOverloadShedding() the loop's CoDel controller
+// sends new requests to a shed callback that answers "busy" at once,
+// which keeps the queue short and the goodput close to capacity.
+// Usage: test_overload [-w workUs=1000] [-d seconds=3] [-c connections=32]
+//                      [-l deadlineMs=100]
+// Exits non-zero unless shedding keeps at least half the capacity as
+// goodput and does better than no shedding.
+#include <arpa/inet.h>
+#include <getopt.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <future>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <muduo/EventLoopThread.hpp>
+#include <muduo/Logger.hpp>
+#include <muduo/TcpServer.hpp>
+
+#include "TestUtil.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const Clock::time_point kEpoch = Clock::now();
+
+int64_t nowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - kEpoch).count();
+}
+
+// Spins for about us microseconds; the result keeps the loop from being optimised out
+uint64_t burn(int us) {
+    const Clock::time_point end = Clock::now() + std::chrono::microseconds(us);
+    uint64_t x = 1469598103934665603ull;
+    while (Clock::now() < end) {
+        for (int i = 0; i < 256; ++i) {
+            x = (x ^ static_cast<uint64_t>(i)) * 1099511628211ull;
+        }
+    }
+    return x;
+}
+
+// Answers every complete "<timestamp>\n" request in buf with "<tag><timestamp>\n"
+template<typename Work>
+void answerLines(const TcpConnectionPtr& conn, Buffer* buf, char tag, Work&& work) {
+    std::string out;
+    for (;;) {
+        const std::string_view input(buf->peek(), buf->readableBytes());
+        const size_t eol = input.find('\n');
+        if (eol == std::string_view::npos) break;
+        work();
+        out += tag;
+        out.append(input.data(), eol + 1);
+        buf->retrieve(eol + 1);
+    }
+    conn->send(out);
+}
+
+struct Goodput {
+    uint64_t sent = 0;
+    uint64_t onTime = 0;
+    uint64_t late = 0;
+    uint64_t busy = 0;
+};
+
+// Sends rate requests per second round-robin over the connections for the given time
+Goodput offerLoad(uint16_t port, int connections, double rate, int seconds, int64_t deadlineUs) {
+    std::vector<pollfd> fds;
+    std::vector<std::string> partial(connections);
+    for (int i = 0; i < connections; ++i) {
+        const int fd = connectTo(port);
+        if (fd >= 0) fds.push_back({fd, POLLIN, 0});
+    }
+    Goodput result;
+    if (fds.empty()) return result;
+
+    const int64_t start = nowUs();
+    const int64_t stopSending = start + seconds * 1000000LL;
+    const int64_t stopReading = stopSending + deadlineUs;
+    char buf[64 * 1024];
+    for (int64_t now = start; now < stopReading; now = nowUs()) {
+        // Everything due by now goes out, whatever came back so far
+        const auto due = static_cast<uint64_t>(static_cast<double>(std::min(now, stopSending) - start) * rate / 1e6);
+        for (; result.sent < due; ++result.sent) {
+            const std::string request = std::to_string(nowUs()) + "\n";
+            const int fd = fds[result.sent % fds.size()].fd;
+            if (::send(fd, request.data(), request.size(), MSG_DONTWAIT) != static_cast<ssize_t>(request.size())) {
+                break;
+            }
+        }
+        if (::poll(fds.data(), fds.size(), 1) <= 0) continue;
+        for (size_t i = 0; i < fds.size(); ++i) {
+            if (!(fds[i].revents & POLLIN)) continue;
+            const ssize_t n = ::read(fds[i].fd, buf, sizeof(buf));
+            if (n <= 0) continue;
+            partial[i].append(buf, static_cast<size_t>(n));
+            const int64_t arrived = nowUs();
+            size_t begin = 0;
+            for (size_t eol; (eol = partial[i].find('\n', begin)) != std::string::npos; begin = eol + 1) {
+                const char tag = partial[i][begin];
+                const int64_t sentAt = std::strtoll(partial[i].c_str() + begin + 1, nullptr, 10);
+                if (tag == 'b') {
+                    ++result.busy;
+                } else if (arrived - sentAt <= deadlineUs) {
+                    ++result.onTime;
+                } else {
+                    ++result.late;
+                }
+            }
+            partial[i].erase(0, begin);
+        }
+    }
+    for (const pollfd& p : fds) {
+        ::close(p.fd);
+    }
+    return result;
+}
+
+Goodput run(bool shedding, int workUs, int seconds, int connections, int64_t deadlineUs) {
+    EventLoopThread serverThread;
+    EventLoop* loop = serverThread.startLoop();
+    std::unique_ptr<TcpServer> server;
+    std::atomic<bool> stopping{false};
+    uint16_t port = 0;
+    std::promise<void> started;
+    loop->runInLoop([&] {
+        server = std::make_unique<TcpServer>(loop, InetAddress(0), "overload");
+        server->setThreadNum(1);
+        server->setMessageCallback([&stopping, workUs](const TcpConnectionPtr& conn, Buffer* buf, Timestamp) {
+            if (stopping.load(std::memory_order_relaxed)) {
+                buf->retrieveAll();
+                return;
+            }
+            answerLines(conn, buf, 'o', [workUs] { burn(workUs); });
+        });
+        if (shedding) {
+            server->enableOverloadShedding();
+            server->setShedCallback([](const TcpConnectionPtr& conn, Buffer* buf, Timestamp) {
+                answerLines(conn, buf, 'b', [] {});
+            });
+        }
+        server->start();
+        port = server->listenAddress().toPort();
+        started.set_value();
+    });
+    started.get_future().wait();
+
+    const double capacity = 1e6 / workUs;
+    const Goodput result = offerLoad(port, connections, 2 * capacity, seconds, deadlineUs);
+
+    // The unshed backlog would keep the loop burning for seconds; drop it
+    stopping = true;
+    std::promise<void> stopped;
+    loop->runInLoop([&] {
+        server.reset();
+        stopped.set_value();
+    });
+    stopped.get_future().wait();
+
+    std::printf("  %-12s sent %6llu: on time %6llu (%7.0f/s), late %6llu, busy %6llu\n",
+                shedding ? "shedding" : "no shedding", static_cast<unsigned long long>(result.sent),
+                static_cast<unsigned long long>(result.onTime), static_cast<double>(result.onTime) / seconds,
+                static_cast<unsigned long long>(result.late), static_cast<unsigned long long>(result.busy));
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int workUs = 1000;
+    int seconds = 3;
+    int connections = 32;
+    int deadlineMs = 100;
+    for (int opt; (opt = ::getopt(argc, argv, "w:d:c:l:")) != -1;) {
+        switch (opt) {
+        case 'w': workUs = std::max(1, std::atoi(optarg)); break;
+        case 'd': seconds = std::max(1, std::atoi(optarg)); break;
+        case 'c': connections = std::max(1, std::atoi(optarg)); break;
+        case 'l': deadlineMs = std::max(1, std::atoi(optarg)); break;
+        default:
+            std::fprintf(stderr, "usage: %s [-w workUs] [-d seconds] [-c connections] [-l deadlineMs]\n", argv[0]);
+            return 2;
+        }
+    }
+    Logger::instance().set_level(LogLevel::Error);
+
+    const double capacity = 1e6 / workUs;
+    std::printf("capacity %.0f requests/s, offered %.0f/s over %d connections, deadline %d ms, %d s per run\n",
+                capacity, 2 * capacity, connections, deadlineMs, seconds);
+    const Goodput plain = run(false, workUs, seconds, connections, deadlineMs * 1000LL);
+    const Goodput shed = run(true, workUs, seconds, connections, deadlineMs * 1000LL);
+
+    const bool ok = static_cast<double>(shed.onTime) >= 0.5 * capacity * seconds && shed.onTime > plain.onTime;
+    std::printf("%s: goodput with shedding %.0f%% of capacity, without %.0f%%\n", ok ? "PASS" : "FAIL",
+                100.0 * static_cast<double>(shed.onTime) / (capacity * seconds),
+                100.0 * static_cast<double>(plain.onTime) / (capacity * seconds));
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,128 @@
+// Measures the throughput a per-connection ingress limit and a server-wide
+// egress limit actually allow, and checks both stay within a tolerance of
+// the configured rate (the burst lets the first bucketful through at once).
+// Usage: test_rate_limit [MiB=3] [port=0]; uses port and port + 1, or two
+// ephemeral ports by default; exits non-zero on failure.
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+#include <muduo/Logger.hpp>
+#include <muduo/TcpServer.hpp>
+
+#include "TestUtil.hpp"
+
+namespace {
+
+constexpr double kIngressRate = 1 << 20;   // bytes per second, per connection
+constexpr double kEgressRate = 2 << 20;    // bytes per second, whole server
+constexpr double kBurst = 64 << 10;
+constexpr double kTolerance = 0.15;
+
+void writeAll(int fd, size_t total) {
+    const std::string chunk(64 * 1024, 'x');
+    for (size_t sent = 0; sent < total;) {
+        const ssize_t w = ::write(fd, chunk.data(), std::min(chunk.size(), total - sent));
+        if (w <= 0) return;
+        sent += static_cast<size_t>(w);
+    }
+}
+
+size_t drain(int fd, size_t total) {
+    char buf[64 * 1024];
+    size_t got = 0;
+    while (got < total) {
+        const ssize_t n = ::read(fd, buf, sizeof(buf));
+        if (n <= 0) break;
+        got += static_cast<size_t>(n);
+    }
+    return got;
+}
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool check(const char* what, double measured, double limit) {
+    const bool ok = measured <= limit * (1 + kTolerance) && measured >= limit * (1 - kTolerance);
+    std::printf("%s: %s %.3f MiB/s against a limit of %.3f MiB/s\n",
+                ok ? "PASS" : "FAIL", what, measured / (1 << 20), limit / (1 << 20));
+    return ok;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const size_t total = (argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 3) << 20;
+    const uint16_t port = static_cast<uint16_t>(argc > 2 ? std::atoi(argv[2]) : 0);
+    Logger::instance().set_level(LogLevel::Error);
+
+    EventLoop loop;
+
+    TcpServer ingress(&loop, InetAddress(port), "ingress");
+    RateLimitConfig ingressLimits;
+    ingressLimits.ingressBytes = {kIngressRate, kBurst};
+    ingress.setConnectionRateLimits(ingressLimits);
+    std::atomic<size_t> received{0};
+    ingress.setMessageCallback([&received](const TcpConnectionPtr&, Buffer* buf, Timestamp) {
+        received += buf->readableBytes();
+        buf->retrieveAll();
+    });
+    ingress.start();
+
+    TcpServer egress(&loop, InetAddress(port ? static_cast<uint16_t>(port + 1) : uint16_t{0}), "egress");
+    RateLimitConfig egressLimits;
+    egressLimits.egressBytes = {kEgressRate, kBurst};
+    egress.setServerRateLimits(egressLimits);
+    egress.setConnectionCallback([total](const TcpConnectionPtr& conn) {
+        if (conn->connected()) conn->send(std::string(total, 'y'));
+    });
+    egress.start();
+    const uint16_t ingressPort = ingress.listenAddress().toPort();
+    const uint16_t egressPort = egress.listenAddress().toPort();
+
+    bool ok = true;
+    std::thread client([&] {
+        // One connection pushing as fast as it can into a per-connection ingress limit
+        const int in = connectTo(ingressPort);
+        auto start = std::chrono::steady_clock::now();
+        if (in >= 0) {
+            writeAll(in, total);
+            while (received.load() < total) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            ::close(in);
+        }
+        ok &= in >= 0 && check("ingress", static_cast<double>(total) / secondsSince(start), kIngressRate);
+
+        // Two connections sharing one server-wide egress limit
+        const int first = connectTo(egressPort);
+        const int second = connectTo(egressPort);
+        start = std::chrono::steady_clock::now();
+        size_t drained = 0;
+        if (first >= 0 && second >= 0) {
+            std::thread other([&] { drained += drain(second, total); });
+            const size_t got = drain(first, total);
+            other.join();
+            drained += got;
+        }
+        const double seconds = secondsSince(start);
+        ::close(first);
+        ::close(second);
+        ok &= drained == 2 * total && check("egress", static_cast<double>(drained) / seconds, kEgressRate);
+
+        loop.queueInLoop([&loop] { loop.quit(); });
+    });
+    loop.loop();
+    client.join();
+    return ok ? 0 : 1;
+}
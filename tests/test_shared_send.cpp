@@ -0,0 +1,127 @@
+// Mixes send(), sendShared() and sendStream() on one connection whose
+// socket takes only part of each write, and checks the client receives
+// every byte in the order it was queued. Also checks a shared payload is
+// referenced while part of it is queued, and released once its last
+// byte has been written, while later output is still pending.
+// Usage: test_shared_send; exits non-zero on failure.
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include <muduo/Logger.hpp>
+#include <muduo/TcpServer.hpp>
+
+#include "TestUtil.hpp"
+
+namespace {
+
+// The server socket's send buffer: each large write is taken only in part
+constexpr int kSocketBuffer = 32 * 1024;
+
+// n bytes; two segments' patterns differ at almost every offset
+std::string pattern(int segment, size_t n) {
+    std::string s(n, '\0');
+    for (size_t i = 0; i < n; ++i) {
+        s[i] = static_cast<char>(i * 31 + static_cast<size_t>(segment) * 7 + i / 251);
+    }
+    return s;
+}
+
+// Hands out data in pieces of at most maxBytes
+class StringSource : public StreamSource {
+public:
+    explicit StringSource(std::string data) : data_(std::move(data)) {}
+
+    bool produce(Buffer& out, size_t maxBytes) override {
+        const size_t n = std::min(maxBytes, data_.size() - offset_);
+        out.append(data_.data() + offset_, n);
+        offset_ += n;
+        return offset_ < data_.size();
+    }
+
+private:
+    const std::string data_;
+    size_t offset_{0};
+};
+
+} // namespace
+
+int main() {
+    Logger::instance().set_level(LogLevel::Error);
+
+    const std::string head = pattern(0, 1000);
+    const SharedPayload first = std::make_shared<const std::string>(pattern(1, 4 << 20));
+    const std::string middle = pattern(2, 100 * 1024);
+    const SharedPayload second = std::make_shared<const std::string>(pattern(3, 1 << 20));
+    const std::string tail = pattern(4, 5000);
+    const std::string streamed = pattern(5, 4 << 20);
+    const std::string expected = head + *first + middle + *second + tail + streamed;
+    const size_t firstEnd = head.size() + first->size();
+
+    EventLoop loop;
+    TcpServer server(&loop, InetAddress(0), "shared_send");
+    const uint16_t port = server.listenAddress().toPort();
+
+    bool heldWhileQueued = false;   // loop thread
+    server.setConnectionCallback([&](const TcpConnectionPtr& conn) {
+        if (!conn->connected()) return;
+        ::setsockopt(conn->fd(), SOL_SOCKET, SO_SNDBUF, &kSocketBuffer, sizeof(kSocketBuffer));
+        conn->send(head);
+        conn->sendShared(first);
+        // Part of the payload did not fit the socket: its tail is queued as a reference
+        heldWhileQueued = first.use_count() > 1;
+        conn->send(middle);
+        conn->sendShared(second);
+        conn->send(tail);
+        conn->sendStream(std::make_shared<StringSource>(streamed));
+        conn->shutdown();
+    });
+    server.start();
+
+    std::string received;
+    long firstRefsAfterWritten = -1;
+    long firstRefsAtEnd = -1;
+    long secondRefsAtEnd = -1;
+    std::thread client([&] {
+        if (const int conn = connectTo(port); conn >= 0) {
+            std::string buf(16 * 1024, '\0');
+            for (ssize_t n; (n = ::read(conn, buf.data(), buf.size())) > 0;) {
+                const bool crossed = received.size() < firstEnd && received.size() + static_cast<size_t>(n) >= firstEnd;
+                received.append(buf.data(), static_cast<size_t>(n));
+                if (crossed) {
+                    // Its last byte has been written, so the connection must have let go of it
+                    std::promise<long> refs;
+                    loop.runInLoop([&] { refs.set_value(first.use_count()); });
+                    firstRefsAfterWritten = refs.get_future().get();
+                }
+            }
+            ::close(conn);
+        }
+        std::promise<void> done;
+        loop.runInLoop([&] {
+            firstRefsAtEnd = first.use_count();
+            secondRefsAtEnd = second.use_count();
+            done.set_value();
+        });
+        done.get_future().wait();
+        loop.queueInLoop([&loop] { loop.quit(); });
+    });
+    loop.loop();
+    client.join();
+
+    size_t intact = 0;
+    while (intact < std::min(received.size(), expected.size()) && received[intact] == expected[intact]) ++intact;
+    const bool ordered = received.size() == expected.size() && intact == expected.size();
+    const bool released = heldWhileQueued && firstRefsAfterWritten == 1 && firstRefsAtEnd == 1 && secondRefsAtEnd == 1;
+    std::printf("%s: %zu of %zu bytes in order (first mismatch at %zu); shared payload held while queued: %s, "
+                "references once written: %ld, at the end: %ld and %ld\n",
+                ordered && released ? "PASS" : "FAIL", received.size(), expected.size(), intact,
+                heldWhileQueued ? "yes" : "no", firstRefsAfterWritten, firstRefsAtEnd, secondRefsAtEnd);
+    return ordered && released ? 0 : 1;
+}
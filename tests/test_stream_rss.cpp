@@ -0,0 +1,101 @@
+// Streams a generated body through sendStream() to a client reading as fast
+// as it can, and checks every byte arrives while the process's resident
+// set stays flat: the stream must be produced as the socket drains, never
+// buffered whole.
+// Usage: test_stream_rss [GiB=10] [port=0 (ephemeral)]; exits non-zero on failure.
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include <muduo/Logger.hpp>
+#include <muduo/TcpServer.hpp>
+
+#include "TestUtil.hpp"
+
+namespace {
+
+// Growth of the resident set over the run that still counts as constant
+constexpr long kMaxRssGrowthMiB = 32;
+
+class PatternSource : public StreamSource {
+public:
+    explicit PatternSource(uint64_t total) : remaining_(total) {}
+
+    bool produce(Buffer& out, size_t maxBytes) override {
+        const size_t n = static_cast<size_t>(std::min<uint64_t>(remaining_, maxBytes));
+        for (size_t off = 0; off < n; off += block_.size()) {
+            out.append(block_.data(), std::min(block_.size(), n - off));
+        }
+        remaining_ -= n;
+        return remaining_ > 0;
+    }
+
+private:
+    uint64_t remaining_;
+    const std::string block_ = std::string(64 * 1024, 'z');
+};
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const uint64_t total = (argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10) << 30;
+    const uint16_t listenPort = static_cast<uint16_t>(argc > 2 ? std::atoi(argv[2]) : 0);
+    Logger::instance().set_level(LogLevel::Error);
+
+    EventLoop loop;
+    TcpServer server(&loop, InetAddress(listenPort), "stream");
+    const uint16_t port = server.listenAddress().toPort();
+    server.setThreadNum(1);
+    server.setConnectionCallback([total](const TcpConnectionPtr& conn) {
+        if (conn->connected()) {
+            conn->sendStream(std::make_shared<PatternSource>(total));
+            conn->shutdown();
+        }
+    });
+    server.start();
+
+    uint64_t received = 0;
+    long baseline = 0;
+    long peak = 0;
+    double seconds = 0;
+    std::thread client([&] {
+        baseline = residentMiB();
+        peak = baseline;
+        const int fd = connectTo(port);
+        const auto start = std::chrono::steady_clock::now();
+        if (fd >= 0) {
+            std::string buf(1 << 20, '\0');
+            for (;;) {
+                const ssize_t n = ::read(fd, buf.data(), buf.size());
+                if (n <= 0) break;
+                received += static_cast<uint64_t>(n);
+                // Sample every 256 MiB
+                if ((received >> 28) != ((received - static_cast<uint64_t>(n)) >> 28)) {
+                    peak = std::max(peak, residentMiB());
+                }
+            }
+            ::close(fd);
+        }
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        loop.queueInLoop([&loop] { loop.quit(); });
+    });
+    loop.loop();
+    client.join();
+
+    const bool ok = received == total && peak - baseline <= kMaxRssGrowthMiB;
+    std::printf("%s: %llu of %llu bytes streamed at %.2f GB/s, resident set %ld -> %ld MiB\n",
+                ok ? "PASS" : "FAIL", static_cast<unsigned long long>(received),
+                static_cast<unsigned long long>(total), static_cast<double>(received) / seconds / 1e9,
+                baseline, peak);
+    return ok ? 0 : 1;
+}
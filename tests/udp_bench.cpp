@@ -0,0 +1,185 @@
+// Datagrams per second over loopback into a UdpServer. Client threads send
+// bursts of -b datagrams of -s bytes with sendmmsg(). One-way, they send as
+// fast as they can and the server only counts; what the kernel drops when
+// the receive buffer fills is reported as lost. Echo mode waits for each
+// burst to come back (100 ms at most) before sending the next.
+// Usage: udp_bench [-c clients=2] [-s size=64] [-b burst=32] [-d seconds=3]
+//                  [-t serverThreads=1] [-r (SO_REUSEPORT socket per loop)]
+#include <arpa/inet.h>
+#include <getopt.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <muduo/EventLoopThread.hpp>
+#include <muduo/Logger.hpp>
+#include <muduo/UdpServer.hpp>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+int connectUdp(uint16_t port) {
+    const int fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        ::close(fd);
+        return -1;
+    }
+    timeval timeout{0, 100 * 1000};
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    return fd;
+}
+
+// A UDP port nothing is bound to right now
+uint16_t unusedPort() {
+    const int fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    ::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    ::getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &len);
+    ::close(fd);
+    return ntohs(addr.sin_port);
+}
+
+struct ClientCounts {
+    uint64_t sent = 0;
+    uint64_t echoed = 0;
+};
+
+// Sends bursts until stop; in echo mode reads each burst back before the next
+ClientCounts blast(uint16_t port, size_t size, int burst, bool echo, const std::atomic<bool>& stop) {
+    ClientCounts counts;
+    const int fd = connectUdp(port);
+    if (fd < 0) return counts;
+    std::string payload(size, 'u');
+    std::vector<iovec> iovecs(burst, iovec{payload.data(), payload.size()});
+    std::vector<mmsghdr> msgs(burst);
+    for (int i = 0; i < burst; ++i) {
+        msgs[i].msg_hdr.msg_iov = &iovecs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    std::vector<char> in(size + 1);
+    while (!stop.load(std::memory_order_relaxed)) {
+        const int n = ::sendmmsg(fd, msgs.data(), static_cast<unsigned>(burst), 0);
+        if (n <= 0) continue;
+        counts.sent += static_cast<uint64_t>(n);
+        for (int i = 0; echo && i < n; ++i) {
+            if (::recv(fd, in.data(), in.size(), 0) <= 0) break;
+            ++counts.echoed;
+        }
+    }
+    ::close(fd);
+    return counts;
+}
+
+void run(bool echo, int clients, size_t size, int burst, int seconds, int serverThreads, bool reusePort) {
+    EventLoopThread serverThread;
+    EventLoop* loop = serverThread.startLoop();
+    std::unique_ptr<UdpServer> server;
+    const uint16_t port = unusedPort();
+    std::promise<void> started;
+    loop->runInLoop([&] {
+        server = std::make_unique<UdpServer>(loop, InetAddress(port), "udp_bench",
+                                             reusePort ? UdpServer::Option::kReusePort
+                                                       : UdpServer::Option::kNoReusePort);
+        server->setThreadNum(static_cast<size_t>(serverThreads));
+        if (echo) {
+            server->setMessageCallback([](UdpSocket& socket, std::string_view data, const sockaddr_in& peer, Timestamp) {
+                socket.sendTo(peer, data);
+            });
+        }
+        server->start();
+        started.set_value();
+    });
+    started.get_future().wait();
+
+    std::atomic<bool> stop{false};
+    std::vector<ClientCounts> counts(clients);
+    std::vector<std::thread> threads;
+    const Clock::time_point start = Clock::now();
+    for (int i = 0; i < clients; ++i) {
+        threads.emplace_back([&, i] { counts[i] = blast(port, size, burst, echo, stop); });
+    }
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    stop = true;
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    const double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    // Let the server drain what is still in its receive buffer
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    ClientCounts total;
+    for (const ClientCounts& c : counts) {
+        total.sent += c.sent;
+        total.echoed += c.echoed;
+    }
+    const uint64_t received = server->datagramsReceived();
+    std::promise<void> stopped;
+    loop->runInLoop([&] {
+        server.reset();
+        stopped.set_value();
+    });
+    stopped.get_future().wait();
+
+    const double lost = total.sent ? 100.0 * static_cast<double>(total.sent - std::min(total.sent, received)) /
+                                         static_cast<double>(total.sent)
+                                   : 0.0;
+    std::printf("  %-8s sent %9llu, received %9llu (%8.0f/s, %4.1f%% lost)",
+                echo ? "echo" : "one-way", static_cast<unsigned long long>(total.sent),
+                static_cast<unsigned long long>(received), static_cast<double>(received) / elapsed, lost);
+    if (echo) {
+        std::printf(", echoed %9llu (%8.0f/s)", static_cast<unsigned long long>(total.echoed),
+                    static_cast<double>(total.echoed) / elapsed);
+    }
+    std::printf("\n");
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int clients = 2;
+    size_t size = 64;
+    int burst = 32;
+    int seconds = 3;
+    int serverThreads = 1;
+    bool reusePort = false;
+    for (int opt; (opt = ::getopt(argc, argv, "c:s:b:d:t:r")) != -1;) {
+        switch (opt) {
+        case 'c': clients = std::max(1, std::atoi(optarg)); break;
+        case 's': size = std::clamp<size_t>(std::strtoull(optarg, nullptr, 10), 1, UdpSocket::kDefaultMaxDatagramSize); break;
+        case 'b': burst = std::clamp(std::atoi(optarg), 1, 1024); break;
+        case 'd': seconds = std::max(1, std::atoi(optarg)); break;
+        case 't': serverThreads = std::max(0, std::atoi(optarg)); break;
+        case 'r': reusePort = true; break;
+        default:
+            std::fprintf(stderr, "usage: %s [-c clients] [-s size] [-b burst] [-d seconds] [-t serverThreads] [-r]\n",
+                         argv[0]);
+            return 2;
+        }
+    }
+    Logger::instance().set_level(LogLevel::Error);
+
+    std::printf("%d clients, %zu-byte datagrams in bursts of %d, %d server IO loops%s, %d s per run\n",
+                clients, size, burst, serverThreads, reusePort ? " with SO_REUSEPORT" : "", seconds);
+    run(false, clients, size, burst, seconds, serverThreads, reusePort);
+    run(true, clients, size, burst, seconds, serverThreads, reusePort);
+    return 0;
+}